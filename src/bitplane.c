@@ -0,0 +1,163 @@
+#include <pebble.h>
+#include "bitplane.h"
+
+// word i of a row (memcpy keeps unaligned row starts and type punning well defined, it compiles to one load)
+static inline uint32_t load_word(const uint8_t *row, int i) {
+  uint32_t word;
+  memcpy(&word, row + 4 * i, 4);
+  return word;
+}
+
+static inline void store_word(uint8_t *row, int i, uint32_t word) {
+  memcpy(row + 4 * i, &word, 4);
+}
+
+// low n bits set, n in 1..32
+static inline uint32_t low_bits(int n) {
+  return n < 32 ? (1u << n) - 1 : 0xFFFFFFFF;
+}
+
+int bitplane_popcount(uint32_t bits) {
+  bits = bits - ((bits >> 1) & 0x55555555);
+  bits = (bits & 0x33333333) + ((bits >> 2) & 0x33333333);
+  return (((bits + (bits >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+uint32_t bitplane_get(const uint8_t *row, int x, int n) {
+  int i = x >> 5, shift = x & 31;
+  uint32_t bits = load_word(row, i) >> shift;
+  if (shift + n > 32) bits |= load_word(row, i + 1) << (32 - shift);
+  return bits & low_bits(n);
+}
+
+// masked edge words, whole words in between
+void bitplane_apply(uint8_t *row, int x0, int x1, bool and_bit, bool xor_bit) {
+  if (x1 <= x0) return;
+  uint32_t and_word = and_bit ? 0xFFFFFFFF : 0, xor_word = xor_bit ? 0xFFFFFFFF : 0;
+  int first = x0 >> 5, last = (x1 - 1) >> 5;
+  uint32_t head = 0xFFFFFFFF << (x0 & 31), tail = 0xFFFFFFFF >> (31 - ((x1 - 1) & 31));
+
+  if (first == last) head &= tail;
+  store_word(row, first, (load_word(row, first) & (and_word | ~head)) ^ (xor_word & head));
+  if (first == last) return;
+
+  for (int i = first + 1; i < last; ++i) store_word(row, i, (load_word(row, i) & and_word) ^ xor_word);
+  store_word(row, last, (load_word(row, last) & (and_word | ~tail)) ^ (xor_word & tail));
+}
+
+void bitplane_apply_rect(uint8_t *data, int bytes_per_row, GRect rect, bool and_bit, bool xor_bit) {
+  if (and_bit && !xor_bit) return;
+  uint8_t *row = data + rect.origin.y * bytes_per_row;
+  for (int y = 0; y < rect.size.h; y++, row += bytes_per_row)
+    bitplane_apply(row, rect.origin.x, rect.origin.x + rect.size.w, and_bit, xor_bit);
+}
+
+// combines bits (already in place) into word i of dst, pixels outside mask are kept
+static inline void combine_word(uint8_t *dst, int i, uint32_t bits, uint32_t mask, BitplaneOp op) {
+  uint32_t word = load_word(dst, i);
+  switch (op) {
+    case BitplaneCopy:  word = (word & ~mask) | bits; break;
+    case BitplaneAnd:   word &= bits | ~mask;         break;
+    case BitplaneOr:    word |= bits;                 break;
+    case BitplaneXor:   word ^= bits;                 break;
+    case BitplaneClear: word &= ~bits;                break;
+  }
+  store_word(dst, i, word);
+}
+
+// whole destination words i.. from source words j.. shifted down by shift (1..31, 0 reads them as they are),
+// one source load per word; the loop is repeated per op so the op is not decided for every word
+#define BLIT_WORDS(COMBINE) \
+  if (shift == 0) { \
+    for (; n >= 32; n -= 32, ++i, ++j) { \
+      uint32_t bits = load_word(src, j); \
+      store_word(dst, i, COMBINE); \
+    } \
+  } else { \
+    uint32_t next = load_word(src, j); \
+    for (; n >= 32; n -= 32, ++i, ++j) { \
+      uint32_t bits = next >> shift; \
+      next = load_word(src, j + 1); \
+      bits |= next << (32 - shift); \
+      store_word(dst, i, COMBINE); \
+    } \
+  }
+
+// masked first and last destination words, whole words in between
+void bitplane_blit(uint8_t *dst, int dst_x, const uint8_t *src, int src_x, int n, BitplaneOp op) {
+  if (n <= 0) return;
+  int shift = dst_x & 31;
+  if (shift || n < 32) {
+    int k = 32 - shift < n ? 32 - shift : n;
+    combine_word(dst, dst_x >> 5, bitplane_get(src, src_x, k) << shift, low_bits(k) << shift, op);
+    dst_x += k;
+    src_x += k;
+    n -= k;
+  }
+
+  int i = dst_x >> 5, j = src_x >> 5;
+  shift = src_x & 31;
+  switch (op) {
+    case BitplaneCopy:  BLIT_WORDS(bits);                     break;
+    case BitplaneAnd:   BLIT_WORDS(load_word(dst, i) & bits);  break;
+    case BitplaneOr:    BLIT_WORDS(load_word(dst, i) | bits);  break;
+    case BitplaneXor:   BLIT_WORDS(load_word(dst, i) ^ bits);  break;
+    case BitplaneClear: BLIT_WORDS(load_word(dst, i) & ~bits); break;
+  }
+
+  if (n > 0) combine_word(dst, i, bitplane_get(src, 32 * j + shift, n), low_bits(n), op);
+}
+#undef BLIT_WORDS
+
+// exchanges the pixels of word i of a and b inside mask
+static inline void swap_word(uint8_t *a, uint8_t *b, int i, uint32_t mask) {
+  uint32_t wa = load_word(a, i), wb = load_word(b, i), diff = (wa ^ wb) & mask;
+  store_word(a, i, wa ^ diff);
+  store_word(b, i, wb ^ diff);
+}
+
+void bitplane_swap(uint8_t *a, uint8_t *b, int x0, int x1) {
+  if (x1 <= x0) return;
+  int first = x0 >> 5, last = (x1 - 1) >> 5;
+  uint32_t head = 0xFFFFFFFF << (x0 & 31), tail = 0xFFFFFFFF >> (31 - ((x1 - 1) & 31));
+
+  if (first == last) head &= tail;
+  swap_word(a, b, first, head);
+  if (first == last) return;
+
+  for (int i = first + 1; i < last; ++i) swap_word(a, b, i, 0xFFFFFFFF);
+  swap_word(a, b, last, tail);
+}
+
+// reverses the bits of a word
+static inline uint32_t reverse_word(uint32_t bits) {
+  bits = ((bits >> 1) & 0x55555555) | ((bits & 0x55555555) << 1);
+  bits = ((bits >> 2) & 0x33333333) | ((bits & 0x33333333) << 2);
+  bits = ((bits >> 4) & 0x0F0F0F0F) | ((bits & 0x0F0F0F0F) << 4);
+  return __builtin_bswap32(bits);
+}
+
+// like bitplane_blit, the k pixels of a destination word are read from the other end of src and reversed
+void bitplane_reverse(uint8_t *dst, int dst_x, const uint8_t *src, int src_x, int n) {
+  int src_end = src_x + n;
+  while (n > 0) {
+    int shift = dst_x & 31;
+    int k = 32 - shift < n ? 32 - shift : n;
+    src_end -= k;
+    uint32_t bits = reverse_word(bitplane_get(src, src_end, k)) >> (32 - k);
+    combine_word(dst, dst_x >> 5, bits << shift, low_bits(k) << shift, BitplaneCopy);
+    dst_x += k;
+    n -= k;
+  }
+}
+
+int bitplane_count(const uint8_t *row, int x0, int x1) {
+  if (x1 <= x0) return 0;
+  int first = x0 >> 5, last = (x1 - 1) >> 5;
+  uint32_t head = 0xFFFFFFFF << (x0 & 31), tail = 0xFFFFFFFF >> (31 - ((x1 - 1) & 31));
+
+  if (first == last) return bitplane_popcount(load_word(row, first) & head & tail);
+  int count = bitplane_popcount(load_word(row, first) & head) + bitplane_popcount(load_word(row, last) & tail);
+  for (int i = first + 1; i < last; ++i) count += bitplane_popcount(load_word(row, i));
+  return count;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <pebble.h>
+
+// 1bit bitplane operations, 32 pixels per step.
+// Rows use the Aplite framebuffer layout: pixel x is bit x%8 of byte x/8 (LSB first), 1 is white. uint32_t
+// bitsets with bit x%32 of word x/32 for pixel x are the same thing on the (little endian) watch.
+// Rows are read and written as whole 32bit words, so a row buffer must extend to the end of the word holding
+// its last pixel (framebuffer and 1bit GBitmap rows do). Pixels outside the given range are never changed.
+
+// how bitplane_blit combines source pixels into the destination
+typedef enum {
+  BitplaneCopy,   // dst = src
+  BitplaneAnd,    // dst &= src
+  BitplaneOr,     // dst |= src
+  BitplaneXor,    // dst ^= src
+  BitplaneClear,  // dst &= ~src
+} BitplaneOp;
+
+// pixel = (pixel & and_bit) ^ xor_bit on pixels [x0, x1): and 1/xor 1 inverts, and 0/xor 0 fills black,
+// and 0/xor 1 fills white, and 1/xor 0 leaves the row alone
+void bitplane_apply(uint8_t *row, int x0, int x1, bool and_bit, bool xor_bit);
+
+// bitplane_apply on every row of rect
+void bitplane_apply_rect(uint8_t *data, int bytes_per_row, GRect rect, bool and_bit, bool xor_bit);
+
+// combines n pixels of src starting at src_x into dst starting at dst_x; the offsets are independent, so a
+// blit with src_x = dst_x - shift shifts a row. dst and src may be the same row only when dst_x <= src_x
+void bitplane_blit(uint8_t *dst, int dst_x, const uint8_t *src, int src_x, int n, BitplaneOp op);
+
+// exchanges pixels [x0, x1) of rows a and b
+void bitplane_swap(uint8_t *a, uint8_t *b, int x0, int x1);
+
+// dst pixel dst_x + k = src pixel src_x + n - 1 - k for k < n (dst and src must not overlap)
+void bitplane_reverse(uint8_t *dst, int dst_x, const uint8_t *src, int src_x, int n);
+
+// n (<= 32) pixels starting at x, first pixel in bit 0
+uint32_t bitplane_get(const uint8_t *row, int x, int n);
+
+// number of white pixels in [x0, x1)
+int bitplane_count(const uint8_t *row, int x0, int x1);
+
+// number of set bits of a word
+int bitplane_popcount(uint32_t bits);
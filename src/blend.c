@@ -0,0 +1,132 @@
+#include <pebble.h>
+
+#include "effects.h"
+#include "bitplane.h"
+#include "colors4.h"
+
+#ifdef PBL_COLOR
+// n (1..4) 8bit pixels as a word, pixel k in byte k (a whole word is one load)
+static inline uint32_t load_pixels(const uint8_t *pixels, int n) {
+  uint32_t word = 0;
+  if (n == 4) memcpy(&word, pixels, 4);
+  else memcpy(&word, pixels, n);
+  return word;
+}
+
+static inline void store_pixels(uint8_t *pixels, uint32_t word, int n) {
+  if (n == 4) memcpy(pixels, &word, 4);
+  else memcpy(pixels, &word, n);
+}
+
+// faded pixels: the screen scaled by 16 - level plus the color scaled by level (once), per channel
+static inline uint32_t fade_pixels(uint32_t pixels, uint32_t faded_color, uint8_t level) {
+  return colors4_add(colors4_scale(pixels, 16 - level), faded_color);
+}
+
+static void fade_rect(uint8_t *bitmap_data, int bytes_per_row, GRect position, GColor color, uint8_t level) {
+  uint32_t faded_color = colors4_scale(colors4_splat(color), level) & ~COLORS4_ALPHA;
+  uint8_t *row = bitmap_data + position.origin.y * bytes_per_row + position.origin.x;
+  for (int y = 0; y < position.size.h; y++, row += bytes_per_row) {
+    for (int x = 0, n = 4; x < position.size.w; x += 4) {
+      if (position.size.w - x < 4) n = position.size.w - x;
+      store_pixels(row + x, fade_pixels(load_pixels(row + x, n), faded_color, level), n);
+    }
+  }
+}
+#endif
+
+uint8_t effect_blend_weight(const EffectBlend *blend) {
+  uint8_t opacity = blend->opacity > 16 ? 16 : blend->opacity;
+  return (opacity * blend->color.a + 1) / 3;
+}
+
+void effect_palette_add_fade(EffectPalette *palette, EffectFade *fade) {
+  uint8_t level = fade->level > 16 ? 16 : fade->level;
+  #ifdef PBL_COLOR // the table as 64 words of 4 entries
+    uint32_t faded_color = colors4_scale(colors4_splat(fade->color), level) & ~COLORS4_ALPHA;
+    for (int i = 0; i < 256; i += 4) {
+      uint32_t entries;
+      memcpy(&entries, palette->lut + i, 4);
+      entries = fade_pixels(entries, faded_color, level);
+      memcpy(palette->lut + i, &entries, 4);
+    }
+  #else // see effect_fade
+    if (level >= 8) memset(palette->lut, fade->color.argb, 256);
+  #endif
+}
+
+// fade effect.
+// see struct EffectFade for parameter description
+void effect_fade(GContext* ctx, GRect position, void* param) {
+  EffectFade *fade = (EffectFade *)param;
+  uint8_t level = fade->level > 16 ? 16 : fade->level;
+  if (level == 0 || position.size.w <= 0 || position.size.h <= 0) return;
+  #ifndef PBL_COLOR
+    if (level < 8) return;
+  #endif
+
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  if (!effect_clip(fb, &position)) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+
+  #ifdef PBL_COLOR
+    fade_rect(gbitmap_get_data(fb), gbitmap_get_bytes_per_row(fb), position, fade->color, level);
+  #else
+    bool white = gcolor_equal(fade->color, GColorWhite);
+    bitplane_apply_rect(gbitmap_get_data(fb), gbitmap_get_bytes_per_row(fb), position, 0, white);
+  #endif
+
+  effect_release_frame_buffer(ctx, fb);
+}
+
+// blend effect.
+// see struct EffectBlend for parameter description
+// Bitmap pixels are composited with colors4_over, 4 per step; at lower opacity the result is mixed back
+// with the screen. A color overlay is a fade by its weight
+void effect_blend(GContext* ctx, GRect position, void* param) {
+  EffectBlend *blend = (EffectBlend *)param;
+  uint8_t opacity = blend->opacity > 16 ? 16 : blend->opacity;
+  if (opacity == 0 || position.size.w <= 0 || position.size.h <= 0) return;
+  if (!blend->bitmap) {
+    effect_fade(ctx, position, &(EffectFade){ .color = blend->color, .level = effect_blend_weight(blend) });
+    return;
+  }
+  #ifdef PBL_COLOR
+    if (gbitmap_get_format(blend->bitmap) != GBitmapFormat8Bit) return;
+  #else
+    if (opacity < 8 || gbitmap_get_format(blend->bitmap) != GBitmapFormat1Bit) return;
+  #endif
+
+  // the overlay's top left corner sits at the rect origin, only the part covered by both is drawn
+  GSize size = gbitmap_get_bounds(blend->bitmap).size;
+  GPoint origin = position.origin;
+  if (position.size.w > size.w) position.size.w = size.w;
+  if (position.size.h > size.h) position.size.h = size.h;
+
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  if (!effect_clip(fb, &position)) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+
+  uint8_t *row = gbitmap_get_data(fb) + position.origin.y * gbitmap_get_bytes_per_row(fb);
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb), src_bytes_per_row = gbitmap_get_bytes_per_row(blend->bitmap);
+  int src_x = position.origin.x - origin.x;
+  const uint8_t *src = gbitmap_get_data(blend->bitmap) + (position.origin.y - origin.y) * src_bytes_per_row;
+  for (int y = 0; y < position.size.h; y++, row += bytes_per_row, src += src_bytes_per_row) {
+    #ifdef PBL_COLOR
+      uint8_t *dst = row + position.origin.x;
+      for (int x = 0, n = 4; x < position.size.w; x += 4) {
+        if (position.size.w - x < 4) n = position.size.w - x;
+        uint32_t pixels = load_pixels(dst + x, n), over = colors4_over(pixels, load_pixels(src + src_x + x, n));
+        store_pixels(dst + x, opacity < 16 ? colors4_mix(pixels, over, opacity) : over, n);
+      }
+    #else // drawn as is from half opacity on
+      bitplane_blit(row, position.origin.x, src, src_x, position.size.w, BitplaneCopy);
+    #endif
+  }
+
+  effect_release_frame_buffer(ctx, fb);
+}
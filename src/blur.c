@@ -1,75 +1,262 @@
 #include <pebble.h>
 
 #include "effects.h"
+#include "bitplane.h"
+#include "dither.h"
 
 #ifdef PBL_COLOR
-static void blur_(uint8_t *bitmap_data, int bytes_per_row, GRect position, uint16_t line, uint8_t *dest, uint8_t radius){
+// adds (sign = 1) or removes (sign = -1) one row to the per-column r/g/b totals.
+// Horizontal window [x - radius, x + radius] is clipped to the row and kept as a running sum,
+// so the cost does not depend on the radius
+static void blur_row_(const uint8_t *row, uint16_t width, uint8_t radius, int32_t sign, uint32_t *totals) {
+  int32_t sum[3] = {0,0,0};
+  GColor8 color;
+
+  for (uint16_t x = 0; x < width && x < radius; ++x) {
+    color.argb = row[x];
+    sum[0] += color.r; sum[1] += color.g; sum[2] += color.b;
+  }
+
+  for (uint16_t x = 0; x < width; ++x, totals += 3) {
+    if (x + radius < width) { // pixel entering the window
+      color.argb = row[x + radius];
+      sum[0] += color.r; sum[1] += color.g; sum[2] += color.b;
+    }
+    totals[0] += sign * sum[0];
+    totals[1] += sign * sum[1];
+    totals[2] += sign * sum[2];
+    if (x >= radius) { // pixel leaving the window
+      color.argb = row[x - radius];
+      sum[0] -= color.r; sum[1] -= color.g; sum[2] -= color.b;
+    }
+  }
+}
+
+// one box blur pass: vertical running sums of the horizontal running sums.
+// Output rows are held in a ring of radius+1 rows until their source row has left the window
+// Output pixels whose whole window has one color keep it, so tiles whose neighbourhood (tiles within radius)
+// is uniform are filled with that color instead of averaging their totals (safe: per tile color or
+// EFFECT_TILE_MIXED, cols tiles per row, NULL to average everything)
+static void blur_(uint8_t *bitmap_data, int bytes_per_row, GRect position, uint8_t radius, uint8_t *ring, uint32_t *totals, const uint16_t *safe, int cols){
   uint8_t (*fb_a)[bytes_per_row] = (uint8_t (*)[bytes_per_row])bitmap_data;
-  uint16_t total[3] = {0,0,0};
-  uint8_t  nb_points = 0;
-  GPoint p = {0,0};
-  for (uint16_t x = 0; x < position.size.w; ++x) {
-    total[0] = total[1] = total[2] = 0;
-    nb_points = 0;
-    p.y = position.origin.y + line - radius;
-    for (uint8_t ky = 0; ky <= 2*radius; ++ky){
-      p.x = position.origin.x + x - radius;
-      for (uint8_t kx = 0; kx <= 2*radius; ++kx){
-        if(grect_contains_point(&position, &p)){
-          GColor8 color = (GColor8)fb_a[p.y][p.x];
-          total[0] += color.r;
-          total[1] += color.g;
-          total[2] += color.b;
-          nb_points++;
-        }
-        p.x++;
+  uint16_t offset_x = position.origin.x;
+  uint16_t offset_y = position.origin.y;
+  uint16_t width    = position.size.w;
+  uint16_t height   = position.size.h;
+  uint16_t ring_rows = radius + 1;
+  int16_t  y;
+
+  memset(totals, 0, width * 3 * sizeof(uint32_t));
+  for (y = 0; y < radius && y < height; ++y) {
+    blur_row_(&fb_a[offset_y + y][offset_x], width, radius, 1, totals);
+  }
+
+  for (y = 0; y < height; ++y) {
+    int16_t leaving = y - radius - 1;
+    if (leaving >= 0) {
+      blur_row_(&fb_a[offset_y + leaving][offset_x], width, radius, -1, totals);
+      memcpy(&fb_a[offset_y + leaving][offset_x], ring + (leaving % ring_rows) * width, width);
+    }
+    if (y + radius < height) {
+      blur_row_(&fb_a[offset_y + y + radius][offset_x], width, radius, 1, totals);
+    }
+
+    // same normalization as before: number of window points inside position
+    uint16_t count_y = (y + radius < height ? y + radius : height - 1) - (y > radius ? y - radius : 0) + 1;
+    uint8_t *dest = ring + (y % ring_rows) * width;
+    const uint16_t *tile = safe ? safe + ((offset_y + y) / EFFECT_TILE - offset_y / EFFECT_TILE) * cols : NULL;
+    for (uint16_t x = 0, end; x < width; x = end) {
+      end = ((offset_x + x) / EFFECT_TILE + 1) * EFFECT_TILE - offset_x;
+      if (end > width) end = width;
+      if (tile && *tile++ != EFFECT_TILE_MIXED) {
+        memset(dest + x, tile[-1] | 0xC0, end - x);
+        continue;
+      }
+      uint32_t *total = totals + 3 * x;
+      for (; x < end; ++x, total += 3) {
+        uint16_t count_x = (x + radius < width ? x + radius : width - 1) - (x > radius ? x - radius : 0) + 1;
+        uint32_t nb_points = count_x * count_y;
+        // same packing as GColorFromRGB(total * 0x55 / nb_points)
+        dest[x] = 0xC0 | ((total[0] * 0x55 / nb_points) >> 6) << 4
+                       | ((total[1] * 0x55 / nb_points) >> 6) << 2
+                       | ((total[2] * 0x55 / nb_points) >> 6);
+      }
+    }
+  }
+
+  for (y = (height > ring_rows ? height - ring_rows : 0); y < height; ++y) {
+    memcpy(&fb_a[offset_y + y][offset_x], ring + (y % ring_rows) * width, width);
+  }
+}
+#else
+// white pixels of a row of the rect before pixel k: prefix sum of the whole words plus the popcount of the
+// masked next one
+static inline int count_before(const uint32_t *chunks, const uint16_t *prefix, int k) {
+  return prefix[k >> 5] + ((k & 31) ? bitplane_popcount(chunks[k >> 5] & ((1u << (k & 31)) - 1)) : 0);
+}
+
+// adds (sign = 1) or removes (sign = -1) one row to the per-column totals: the white pixels of the row in
+// [x - radius, x + radius] (clipped to the rect). Each window count is the difference of two prefix counts,
+// so the cost does not depend on the radius
+static void blur_row_1bit(const uint8_t *row, GRect position, uint8_t radius, int32_t sign, int32_t *totals, uint32_t *chunks, uint16_t *prefix) {
+  int width = position.size.w;
+  prefix[0] = 0;
+  for (int i = 0; 32 * i < width; ++i) {
+    chunks[i] = bitplane_get(row, position.origin.x + 32 * i, width - 32 * i < 32 ? width - 32 * i : 32);
+    prefix[i + 1] = prefix[i] + bitplane_popcount(chunks[i]);
+  }
+  for (int x = 0; x < width; ++x) {
+    int lo = x > radius ? x - radius : 0, hi = x + radius + 1 < width ? x + radius + 1 : width;
+    totals[x] += sign * (count_before(chunks, prefix, hi) - count_before(chunks, prefix, lo));
+  }
+}
+
+// one box blur of the 1bit rect, dithered back to black and white: a pixel turns white when the share of
+// white pixels in its window is above its Bayer threshold (uniform windows keep their color).
+// Output rows (bits from bit 0, one word aligned row per ring slot) wait in a ring of radius+1 rows until
+// their source row has left the window, like blur_
+static void blur_1bit(uint8_t *bitmap_data, int bytes_per_row, GRect position, uint8_t radius, uint8_t *ring, int32_t *totals, uint32_t *chunks, uint16_t *prefix) {
+  uint16_t width = position.size.w, height = position.size.h;
+  uint16_t ring_rows = radius + 1, ring_stride = ((width + 31) >> 5) * 4;
+  uint8_t *rows = bitmap_data + position.origin.y * bytes_per_row;
+  int16_t y;
+
+  memset(totals, 0, width * sizeof(int32_t));
+  for (y = 0; y < radius && y < height; ++y) {
+    blur_row_1bit(rows + y * bytes_per_row, position, radius, 1, totals, chunks, prefix);
+  }
+
+  for (y = 0; y < height; ++y) {
+    int16_t leaving = y - radius - 1;
+    if (leaving >= 0) {
+      blur_row_1bit(rows + leaving * bytes_per_row, position, radius, -1, totals, chunks, prefix);
+      bitplane_blit(rows + leaving * bytes_per_row, position.origin.x, ring + (leaving % ring_rows) * ring_stride, 0, width, BitplaneCopy);
+    }
+    if (y + radius < height) {
+      blur_row_1bit(rows + (y + radius) * bytes_per_row, position, radius, 1, totals, chunks, prefix);
+    }
+
+    // white when totals / nb_points > (threshold + 1/2) / 16
+    uint16_t count_y = (y + radius < height ? y + radius : height - 1) - (y > radius ? y - radius : 0) + 1;
+    const uint8_t *bayer = dither_bayer4[(position.origin.y + y) & 3];
+    uint8_t *dest = ring + (y % ring_rows) * ring_stride;
+    uint32_t word = 0;
+    for (uint16_t x = 0; x < width; ++x) {
+      uint16_t count_x = (x + radius < width ? x + radius : width - 1) - (x > radius ? x - radius : 0) + 1;
+      int32_t threshold = (2 * bayer[(position.origin.x + x) & 3] + 1) * count_x * count_y;
+      word |= (uint32_t)(32 * totals[x] > threshold) << (x & 31);
+      if ((x & 31) == 31 || x == width - 1) {
+        memcpy(dest + 4 * (x >> 5), &word, 4);
+        word = 0;
       }
-      p.y++;
     }
-    total[0] = (total[0] * 0x55) / nb_points;
-    total[1] = (total[1] * 0x55) / nb_points;
-    total[2] = (total[2] * 0x55) / nb_points;
-    dest[x] = GColorFromRGB(total[0], total[1], total[2]).argb; 
+  }
+
+  for (y = (height > ring_rows ? height - ring_rows : 0); y < height; ++y) {
+    bitplane_blit(rows + y * bytes_per_row, position.origin.x, ring + (y % ring_rows) * ring_stride, 0, width, BitplaneCopy);
   }
 }
 #endif
 
-void effect_blur(GContext* ctx,  GRect position, void* param){
+static void blur_apply(GContext* ctx, GRect position, uint8_t radius, uint8_t passes){
+  if (passes == 0) passes = 1;
+  if (radius == 0 || position.size.w <= 0 || position.size.h <= 0) return;
+
+  //capturing framebuffer bitmap, the window never reaches past the (clipped) rect
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  if (!effect_clip(fb, &position)) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+
+  // a window wider than the rect in both directions averages the same points
+  uint16_t max_radius = (position.size.w > position.size.h ? position.size.w : position.size.h) - 1;
+#ifndef PBL_COLOR
+  // dithered output can't go through another pass: one box of the same variance as the passes instead
+  // (a box of radius r has variance r*(r+1)/3, passes add up)
+  uint16_t box_radius = radius;
+  while (box_radius < max_radius && box_radius * (box_radius + 1) < passes * radius * (radius + 1)) ++box_radius;
+  if (box_radius > max_radius) box_radius = max_radius;
+  radius = box_radius;
+  passes = 1;
+#endif
+  if (radius > max_radius) radius = max_radius;
+  if (radius == 0) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+
 #ifdef PBL_COLOR
-  //capturing framebuffer bitmap
-  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+  uint16_t width = position.size.w;
+  size_t ring_size = (width * (radius + 1) + 3) & ~3;
+  size_t safe_tiles = (width / EFFECT_TILE + 2) * (position.size.h / EFFECT_TILE + 2);
+  uint8_t *ring = effect_scratch(ring_size + width * 3 * sizeof(uint32_t) + safe_tiles * sizeof(uint16_t));
+  if (!ring) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  uint32_t *totals = (uint32_t*)(ring + ring_size);
+  uint16_t *safe = (uint16_t*)(totals + width * 3);
+
   uint8_t *bitmap_data =  gbitmap_get_data(fb);
   int bytes_per_row = gbitmap_get_bytes_per_row(fb);
 
-  
-  
-  uint8_t radius = (uint8_t)(uint32_t)param; // Not very elegant... sorry
-  uint8_t (*fb_a)[bytes_per_row] = (uint8_t (*)[bytes_per_row])bitmap_data;
-  uint16_t offset_x = position.origin.x;
-  uint16_t offset_y = position.origin.y;
-  uint16_t width    = position.size.w;
-  uint16_t height   = position.size.h;
- 
-  uint8_t *buffer = malloc(width * (radius + 1));
- 
-  uint16_t h=0;
-  for(; h<(radius+1); h++){
-    blur_(bitmap_data, bytes_per_row, position, h, buffer + h*width, radius);
+  while (passes--) {
+    // tiles whose neighbours within radius all share their color
+    int cols, rows, reach = (radius + EFFECT_TILE - 1) / EFFECT_TILE, skipped = 0;
+    uint16_t *tiles = effect_tile_summary(bitmap_data, bytes_per_row, position, &cols, &rows);
+    if (tiles) {
+      for (int j = 0; j < rows; j++)
+        for (int i = 0; i < cols; i++) {
+          uint16_t color = tiles[j * cols + i];
+          for (int n = j - reach; n <= j + reach && color != EFFECT_TILE_MIXED; n++)
+            for (int m = i - reach; m <= i + reach; m++)
+              if (n >= 0 && n < rows && m >= 0 && m < cols && tiles[n * cols + m] != color) {
+                color = EFFECT_TILE_MIXED;
+                break;
+              }
+          safe[j * cols + i] = color;
+          skipped += color != EFFECT_TILE_MIXED;
+        }
+      effect_count_tiles(effect_blur, cols * rows, skipped);
+    }
+    blur_(bitmap_data, bytes_per_row, position, radius, ring, totals, tiles ? safe : NULL, cols);
   }
- 
-  for(; h<height; h++){
-    memcpy(&fb_a[offset_y + h - (radius + 1)][offset_x], buffer, width);
-    memcpy(buffer, buffer + width, radius * width);
-    blur_(bitmap_data, bytes_per_row, position, h, buffer + radius*width, radius);
+#else
+  int words = (position.size.w + 31) >> 5;
+  size_t ring_size = (radius + 1) * words * sizeof(uint32_t);
+  uint8_t *ring = effect_scratch(ring_size + position.size.w * sizeof(int32_t) + words * (sizeof(uint32_t) + sizeof(uint16_t)) + sizeof(uint16_t));
+  if (!ring) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
   }
+  int32_t *totals = (int32_t*)(ring + ring_size);
+  uint32_t *chunks = (uint32_t*)(totals + position.size.w);
+  uint16_t *prefix = (uint16_t*)(chunks + words);
 
-  h=0;
-  for(; h<radius; h++){
-    memcpy(&fb_a[offset_y + height - (radius + 1) + h][offset_x] , buffer + h*width, width);
-  }
-  
-  free(buffer);
-  
-  graphics_release_frame_buffer(ctx, fb);
+  blur_1bit(gbitmap_get_data(fb), gbitmap_get_bytes_per_row(fb), position, radius, ring, totals, chunks, prefix);
 #endif
+
+  effect_release_frame_buffer(ctx, fb);
 }
+
+void effect_blur(GContext* ctx,  GRect position, void* param){
+  blur_apply(ctx, position, (uint32_t)param & 0xFF, (uint32_t)param >> 8 & 0xFF);
+}
+
+static void blur_type_apply(GContext *ctx, GRect position, const void *param, void *state) {
+  const EffectBlurParams *blur = (const EffectBlurParams *)param;
+  blur_apply(ctx, position, blur->radius, blur->passes);
+}
+
+static int16_t blur_type_halo(const void *param) {
+  const EffectBlurParams *blur = (const EffectBlurParams *)param;
+  return blur->radius * (blur->passes ? blur->passes : 1);
+}
+
+// the ring and running totals live in the shared scratch memory, so blur has nothing to prepare
+const EffectType effect_type_blur = {
+  .param_size = sizeof(EffectBlurParams),
+  .apply = blur_type_apply,
+  .halo = blur_type_halo,
+};
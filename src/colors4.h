@@ -0,0 +1,68 @@
+#pragma once
+#include <pebble.h>
+
+// GColor8 arithmetic on 4 pixels at a time: a uint32_t holds 4 argb bytes (pixel k in byte k, as loaded from
+// an 8bit row on the little endian watch) and every 2bit channel is worked on in place, with no unpacking.
+// Unless noted the alpha channel is treated like the colour channels. Small enough to be inlined in pixel loops
+
+#define COLORS4_LOW   0x55555555u // low bit of every channel
+#define COLORS4_HIGH  0xAAAAAAAAu // high bit of every channel
+#define COLORS4_ALPHA 0xC0C0C0C0u // alpha channels
+#define COLORS4_LANE  0x03030303u // one channel per byte, after shifting it down to bits 0-1
+
+// the same color in all 4 pixels
+static inline uint32_t colors4_splat(GColor8 color) {
+  return color.argb * 0x01010101u;
+}
+
+// a + b per channel, saturating at 3
+static inline uint32_t colors4_add(uint32_t a, uint32_t b) {
+  uint32_t sum = ((a & COLORS4_LOW) + (b & COLORS4_LOW)) ^ ((a ^ b) & COLORS4_HIGH);
+  uint32_t carry = ((a & b) | ((a | b) & ~sum)) & COLORS4_HIGH;
+  return sum | carry | (carry >> 1);
+}
+
+// a - b per channel, saturating at 0
+static inline uint32_t colors4_sub(uint32_t a, uint32_t b) {
+  uint32_t diff = ((a | COLORS4_HIGH) - (b & COLORS4_LOW)) ^ ((a ^ ~b) & COLORS4_HIGH);
+  uint32_t borrow = ((~a & b) | (~(a ^ b) & diff)) & COLORS4_HIGH;
+  return diff & ~(borrow | (borrow >> 1));
+}
+
+// (a + b) / 2 per channel, rounded down
+static inline uint32_t colors4_avg(uint32_t a, uint32_t b) {
+  return (a & b) + (((a ^ b) >> 1) & COLORS4_LOW);
+}
+
+// colour channels times weight/16 (weight 0..16, rounded to nearest), alpha kept: 16 is the identity, 0 black
+static inline uint32_t colors4_scale(uint32_t a, uint8_t weight) {
+  uint32_t result = a & COLORS4_ALPHA;
+  for (int shift = 0; shift < 6; shift += 2)
+    result |= ((((a >> shift) & COLORS4_LANE) * weight + 0x08080808u) >> 4 & COLORS4_LANE) << shift;
+  return result;
+}
+
+// a * (16 - weight)/16 + b * weight/16 per colour channel (weight 0..16, rounded to nearest), result opaque
+static inline uint32_t colors4_mix(uint32_t a, uint32_t b, uint8_t weight) {
+  uint32_t result = COLORS4_ALPHA;
+  for (int shift = 0; shift < 6; shift += 2)
+    result |= ((((a >> shift) & COLORS4_LANE) * (16 - weight) + ((b >> shift) & COLORS4_LANE) * weight +
+                0x08080808u) >> 4 & COLORS4_LANE) << shift;
+  return result;
+}
+
+// src drawn over dst using the alpha of each src pixel (3 opaque, 2 two thirds, 1 one third, 0 invisible),
+// result opaque. Per channel src * alpha + dst * (3 - alpha) is at most 9, so it stays in its byte; the
+// products are built from the alpha bits with masks and x/3 is rounded as (11 * x + 16) / 32
+static inline uint32_t colors4_over(uint32_t dst, uint32_t src) {
+  uint32_t alpha = (src >> 6) & COLORS4_LANE;
+  uint32_t a1 = (alpha & 0x01010101u) * 0xFF, a2 = ((alpha >> 1) & 0x01010101u) * 0xFF; // lanes with bit 0 / bit 1
+  uint32_t result = COLORS4_ALPHA;
+  for (int shift = 0; shift < 6; shift += 2) {
+    uint32_t s = (src >> shift) & COLORS4_LANE, d = (dst >> shift) & COLORS4_LANE;
+    // s * alpha + d * (3 - alpha), with 3 - alpha = ~alpha & 3
+    uint32_t sum = (s & a1) + ((s & a2) << 1) + (d & ~a1) + ((d & ~a2) << 1);
+    result |= (((sum * 11 + 0x10101010u) >> 5) & COLORS4_LANE) << shift;
+  }
+  return result;
+}
@@ -0,0 +1,156 @@
+#include <pebble.h>
+
+#include "dither.h"
+#include "bitplane.h"
+
+const uint8_t dither_bayer4[4][4] = {
+  { 0,  8,  2, 10},
+  {12,  4, 14,  6},
+  { 3, 11,  1,  9},
+  {15,  7, 13,  5},
+};
+
+const uint8_t dither_bayer8[8][8] = {
+  { 0, 32,  8, 40,  2, 34, 10, 42},
+  {48, 16, 56, 24, 50, 18, 58, 26},
+  {12, 44,  4, 36, 14, 46,  6, 38},
+  {60, 28, 52, 20, 62, 30, 54, 22},
+  { 3, 35, 11, 43,  1, 33,  9, 41},
+  {51, 19, 59, 27, 49, 17, 57, 25},
+  {15, 47,  7, 39, 13, 45,  5, 37},
+  {63, 31, 55, 23, 61, 29, 53, 21},
+};
+
+uint8_t dither_luminance(GColor8 color) {
+  return ((color.r * 77 + color.g * 150 + color.b * 29) * 85) >> 8;
+}
+
+// threshold rows of an ordered method: row y (of 8) holds 12 bytes, byte i for column i & 7, so the 4
+// thresholds of any 4 adjacent pixels are one word load at x & 7. A 7bit gray g is white when g >= threshold:
+// t * 128 / levels + 1 (levels 16 or 64), so 0 stays black and 255 white
+static void threshold_rows(DitherMethod method, uint8_t thresholds[8][12]) {
+  for (int y = 0; y < 8; y++)
+    for (int i = 0; i < 12; i++)
+      thresholds[y][i] = method == DitherBayer4 ? 8 * dither_bayer4[y & 3][i & 3] + 1 : 2 * dither_bayer8[y][i & 7] + 1;
+}
+
+// n (1..4) bytes as a word, byte k in bits 8k..8k+7 (missing bytes are 0, black)
+static inline uint32_t load_bytes(const uint8_t *bytes, int n) {
+  uint32_t word = 0;
+  if (n == 4) memcpy(&word, bytes, 4);
+  else memcpy(&word, bytes, n);
+  return word;
+}
+
+// ordered dithering of a gray row into bits (bit x for pixel x), 4 pixels per step: a per byte
+// compare (7bit values, the borrow of each byte stays in its top bit) and the 4 top bits gathered by a multiply
+static void ordered_row(const uint8_t *gray, int width, const uint8_t *thresholds, int x0, uint32_t *bits) {
+  memset(bits, 0, ((width + 31) >> 5) * sizeof(uint32_t));
+  for (int x = 0; x < width; x += 4) {
+    uint32_t pixels = load_bytes(gray + x, width - x < 4 ? width - x : 4), limits;
+    memcpy(&limits, thresholds + ((x0 + x) & 7), 4);
+    uint32_t white = ((((pixels >> 1) & 0x7F7F7F7F) | 0x80808080) - limits) & 0x80808080;
+    bits[x >> 5] |= (((white >> 7) * 0x01020408) >> 24) << (x & 31);
+  }
+}
+
+// Floyd-Steinberg on one row: errors[x + 1] holds the error pushed down to pixel x from the row above and
+// is replaced by the error for the row below as the scan passes; the error for the pixel on the right and
+// the 1/16 for the one below right (still waiting to be read) are carried in variables
+static void diffusion_row(const uint8_t *gray, int width, int16_t *errors, uint32_t *bits) {
+  memset(bits, 0, ((width + 31) >> 5) * sizeof(uint32_t));
+  int right = 0, below_right = 0;
+  for (int x = 0; x < width; x++) {
+    int value = gray[x] + errors[x + 1] + right;
+    bool white = value >= 128;
+    int error = value - (white ? 255 : 0);
+    bits[x >> 5] |= (uint32_t)white << (x & 31);
+    errors[x] += error * 3 / 16;
+    errors[x + 1] = error * 5 / 16 + below_right;
+    below_right = error / 16;
+    right = error * 7 / 16;
+  }
+}
+
+bool dither_rows(const uint8_t *src, int src_bytes_per_row, DitherSource format, uint8_t *dst, int dst_bytes_per_row, GRect rect, DitherMethod method) {
+  int width = rect.size.w, words = (width + 31) >> 5;
+  if (width <= 0 || rect.size.h <= 0) return true;
+
+  // scratch: one row of bits, errors (diffusion) and gray pixels (color sources)
+  uint8_t *scratch = effect_scratch(words * sizeof(uint32_t) + (width + 1) * sizeof(int16_t) + width);
+  if (!scratch) return false;
+  uint32_t *bits = (uint32_t*)scratch;
+  int16_t *errors = (int16_t*)(bits + words);
+  uint8_t *gray_row = (uint8_t*)(errors + width + 1);
+
+  uint8_t thresholds[8][12];
+  if (method == DitherDiffusion) memset(errors, 0, (width + 1) * sizeof(int16_t));
+  else threshold_rows(method, thresholds);
+
+  uint8_t *row = dst + rect.origin.y * dst_bytes_per_row;
+  for (int y = 0; y < rect.size.h; y++, src += src_bytes_per_row, row += dst_bytes_per_row) {
+    const uint8_t *gray = src;
+    if (format == DitherSourceColor8) {
+      for (int x = 0; x < width; x++) gray_row[x] = dither_luminance((GColor8){.argb = src[x]});
+      gray = gray_row;
+    }
+    if (method == DitherDiffusion) diffusion_row(gray, width, errors, bits);
+    else ordered_row(gray, width, thresholds[(rect.origin.y + y) & 7], rect.origin.x, bits);
+    bitplane_blit(row, rect.origin.x, (const uint8_t*)bits, 0, width, BitplaneCopy);
+  }
+  return true;
+}
+
+GBitmap* dither_create_bitmap(const uint8_t *src, int src_bytes_per_row, DitherSource format, GSize size, DitherMethod method) {
+  GBitmap *bitmap = gbitmap_create_blank(size, GBitmapFormat1Bit);
+  if (!bitmap) return NULL;
+  if (!dither_rows(src, src_bytes_per_row, format, gbitmap_get_data(bitmap), gbitmap_get_bytes_per_row(bitmap),
+                   GRect(0, 0, size.w, size.h), method)) {
+    gbitmap_destroy(bitmap);
+    return NULL;
+  }
+  return bitmap;
+}
+
+// dither effect.
+// see struct EffectDither for parameter description
+void effect_dither(GContext* ctx, GRect position, void* param) {
+  EffectDither *dither = (EffectDither *)param;
+  if (position.size.w <= 0 || position.size.h <= 0) return;
+
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  GPoint origin = position.origin;
+  if (!effect_clip(fb, &position)) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  uint8_t *bitmap_data = gbitmap_get_data(fb);
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb);
+
+  // source pixel for the clipped rect's origin; an even gray is one row of repeated bytes (on the stack, the
+  // scratch memory belongs to dither_rows)
+  const uint8_t *src = dither->data;
+  int src_bytes_per_row = dither->bytes_per_row;
+  DitherSource format = dither->format;
+  uint8_t gray_row[src ? 1 : position.size.w];
+  if (src) {
+    src += (position.origin.y - origin.y) * src_bytes_per_row + (position.origin.x - origin.x);
+  } else {
+    memset(gray_row, dither->gray, position.size.w);
+    src = gray_row;
+    src_bytes_per_row = 0;
+    format = DitherSourceGray8;
+  }
+
+  #ifdef PBL_COLOR
+    uint8_t *row = bitmap_data + position.origin.y * bytes_per_row + position.origin.x;
+    for (int y = 0; y < position.size.h; y++, src += src_bytes_per_row, row += bytes_per_row) {
+      if (format == DitherSourceColor8) memcpy(row, src, position.size.w);
+      else for (int x = 0; x < position.size.w; x++) row[x] = GColorBlackARGB8 | ((src[x] * 3 + 127) / 255) * 0x15;
+    }
+  #else
+    dither_rows(src, src_bytes_per_row, format, bitmap_data, bytes_per_row, position, dither->method);
+  #endif
+
+  effect_release_frame_buffer(ctx, fb);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <pebble.h>
+#include "effects.h"
+
+// Dithering of shaded content (GColor8 or 8bit gray pixels) to 1bit black & white, in the Aplite framebuffer
+// layout (see bitplane.h). Ordered dithering compares 4 pixels at a time against threshold rows of a Bayer
+// matrix (anchored to the destination coordinates, so patterns line up across calls); error diffusion
+// (Floyd-Steinberg) keeps a single row of pending errors
+
+typedef enum {
+  DitherBayer4,    // 4x4 ordered, 17 levels, coarse regular pattern
+  DitherBayer8,    // 8x8 ordered, 65 levels
+  DitherDiffusion, // Floyd-Steinberg error diffusion: finest detail, but the pattern shifts when the content moves
+} DitherMethod;
+
+typedef enum {
+  DitherSourceColor8, // GColor8 pixels (GBitmapFormat8Bit), turned to gray by their luminance
+  DitherSourceGray8,  // one byte per pixel, 0 black .. 255 white
+} DitherSource;
+
+// Bayer threshold matrices (values 0..15 / 0..63), by row and column
+extern const uint8_t dither_bayer4[4][4];
+extern const uint8_t dither_bayer8[8][8];
+
+// luminance (0..255) of a GColor8
+uint8_t dither_luminance(GColor8 color);
+
+// dithers rect.size source pixels (src: first source pixel, rows src_bytes_per_row apart) into the 1bit rows
+// at dst (rows dst_bytes_per_row apart), at rect.origin. False when out of memory
+bool dither_rows(const uint8_t *src, int src_bytes_per_row, DitherSource format, uint8_t *dst, int dst_bytes_per_row, GRect rect, DitherMethod method);
+
+// resource load time conversion: a new GBitmapFormat1Bit bitmap of size from the source pixels (NULL when
+// out of memory), to be freed with gbitmap_destroy
+GBitmap* dither_create_bitmap(const uint8_t *src, int src_bytes_per_row, DitherSource format, GSize size, DitherMethod method);
+
+// dither effect: draws shaded content into the rect, dithered to black & white on Aplite. The source is data
+// (its first pixel at the rect origin, at least the rect size) or, when data is NULL, an even gray.
+// On Basalt colors are drawn as they are and gray becomes the nearest of the 4 GColor8 grays
+typedef struct {
+  const uint8_t *data;
+  int bytes_per_row;
+  DitherSource format;
+  DitherMethod method;
+  uint8_t gray; // level when data is NULL: 0 black .. 255 white
+} EffectDither;
+
+effect_cb effect_dither;
@@ -0,0 +1,157 @@
+#include <pebble.h>
+
+#include "effects.h"
+
+// one remembered result: pixels of region after running effect on an input that hashed to key
+typedef struct EffectCacheEntry {
+  struct EffectCacheEntry *next;
+  effect_cb *effect;
+  GRect region;
+  uint32_t key[2];
+  uint32_t last_used;
+  uint8_t data[]; // effect_saved_size(region) bytes
+} EffectCacheEntry;
+
+static struct {
+  EffectCacheEntry *entries;
+  size_t budget;
+  uint32_t clock; // bumped on every lookup, orders entries for LRU eviction
+  EffectCacheStats stats;
+} s_cache = { NULL, EFFECT_CACHE_DEFAULT_BUDGET, 0, {0, 0, 0, 0} };
+
+// two independent 32 bit hashes over n bytes, a word at a time
+static void hash_bytes(uint32_t key[2], const uint8_t *data, int n) {
+  uint32_t word;
+  for (; n >= 4; n -= 4, data += 4) {
+    memcpy(&word, data, 4);
+    key[0] = (key[0] ^ word) * 0x01000193;
+    key[1] = ((key[1] << 5 | key[1] >> 27) ^ word) * 0x9E3779B1;
+  }
+  for (; n > 0; --n, ++data) {
+    key[0] = (key[0] ^ *data) * 0x01000193;
+    key[1] = ((key[1] << 5 | key[1] >> 27) ^ *data) * 0x9E3779B1;
+  }
+}
+
+// first byte and number of bytes of a row covering pixels [x, x + w)
+static void row_bytes(GBitmapFormat format, GRect region, int *first, int *count) {
+  if (format == GBitmapFormat8Bit) {
+    *first = region.origin.x;
+    *count = region.size.w;
+  } else {
+    *first = region.origin.x >> 3;
+    *count = ((region.origin.x + region.size.w + 7) >> 3) - *first;
+  }
+}
+
+static void unlink_entry(EffectCacheEntry *entry) {
+  for (EffectCacheEntry **link = &s_cache.entries; *link; link = &(*link)->next) {
+    if (*link == entry) {
+      *link = entry->next;
+      s_cache.stats.bytes -= sizeof(EffectCacheEntry) + effect_saved_size(entry->region);
+      free(entry);
+      return;
+    }
+  }
+}
+
+// drops least recently used entries until size more bytes fit in the budget
+static bool make_room(size_t size) {
+  if (size > s_cache.budget) return false;
+  while (s_cache.entries && s_cache.stats.bytes + size > s_cache.budget) {
+    EffectCacheEntry *oldest = s_cache.entries;
+    for (EffectCacheEntry *entry = s_cache.entries; entry; entry = entry->next)
+      if (entry->last_used < oldest->last_used) oldest = entry;
+    unlink_entry(oldest);
+    ++s_cache.stats.evictions;
+  }
+  return true;
+}
+
+void effect_cache_set_budget(size_t bytes) {
+  s_cache.budget = bytes;
+  make_room(0);
+}
+
+void effect_cache_clear(void) {
+  while (s_cache.entries) unlink_entry(s_cache.entries);
+}
+
+void effect_cache_get_stats(EffectCacheStats *stats) {
+  *stats = s_cache.stats;
+}
+
+// cached effect: runs cached->effect only when the pixels it reads or the parameters changed since a
+// remembered run, otherwise copies that run's output back
+void effect_cached(GContext* ctx, GRect position, void* param) {
+  EffectCached *cached = (EffectCached *)param;
+  if (position.size.w <= 0 || position.size.h <= 0) return;
+  if (!s_cache.budget) { // caching disabled (Aplite default)
+    effect_call(cached->effect, ctx, position, cached->param);
+    return;
+  }
+
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  uint8_t *bitmap_data = gbitmap_get_data(fb);
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  GBitmapFormat format = gbitmap_get_format(fb);
+  GRect bounds = gbitmap_get_bounds(fb);
+
+  // region the effect reads and writes: the rect grown by its halo. Effects that depend on more than that
+  // (EFFECT_HALO_FRAME: lens reads around its rect, unknown effects anywhere) are keyed on the whole screen
+  GRect region = position;
+  int16_t halo = effect_halo(cached->effect, cached->param);
+  if (halo > 0) {
+    region.origin.x -= halo;
+    region.origin.y -= halo;
+    region.size.w += 2 * halo;
+    region.size.h += 2 * halo;
+  }
+  grect_clip(&region, &bounds);
+  GRect input = halo == EFFECT_HALO_FRAME ? bounds : region;
+  int first, count;
+  row_bytes(format, input, &first, &count);
+
+  // key: parameters, rect and the input pixels
+  uint32_t key[2] = { 0x811C9DC5, 0x2545F491 };
+  if (cached->param_size) hash_bytes(key, cached->param, cached->param_size);
+  else hash_bytes(key, (const uint8_t*)&cached->param, sizeof(cached->param));
+  hash_bytes(key, (const uint8_t*)&position, sizeof(position));
+  const uint8_t *row = bitmap_data + input.origin.y * bytes_per_row + first;
+  for (int y = 0; y < input.size.h; y++, row += bytes_per_row) hash_bytes(key, row, count);
+
+  ++s_cache.clock;
+  for (EffectCacheEntry *entry = s_cache.entries; entry; entry = entry->next) {
+    if (entry->effect == cached->effect && grect_equal(&entry->region, &region) &&
+        entry->key[0] == key[0] && entry->key[1] == key[1]) {
+      effect_restore_rect(fb, region, entry->data);
+      entry->last_used = s_cache.clock;
+      ++s_cache.stats.hits;
+      effect_release_frame_buffer(ctx, fb);
+      return;
+    }
+  }
+  ++s_cache.stats.misses;
+
+  // the effect captures the framebuffer itself
+  effect_release_frame_buffer(ctx, fb);
+  effect_call(cached->effect, ctx, position, cached->param);
+
+  size_t size = sizeof(EffectCacheEntry) + effect_saved_size(region);
+  if (!make_room(size)) return;
+  EffectCacheEntry *entry = malloc(size);
+  if (!entry) return;
+
+  fb = effect_capture_frame_buffer(ctx);
+  effect_save_rect(fb, region, entry->data);
+  effect_release_frame_buffer(ctx, fb);
+
+  entry->effect = cached->effect;
+  entry->region = region;
+  entry->key[0] = key[0];
+  entry->key[1] = key[1];
+  entry->last_used = s_cache.clock;
+  entry->next = s_cache.entries;
+  s_cache.entries = entry;
+  s_cache.stats.bytes += size;
+}
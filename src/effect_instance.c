@@ -0,0 +1,73 @@
+#include <pebble.h>
+
+#include "effects.h"
+
+void effect_instance_init(EffectInstance *instance, const EffectType *type, const void *param) {
+  memset(instance, 0, sizeof(*instance));
+  instance->type = type;
+  instance->param = param;
+}
+
+void effect_instance_destroy(EffectInstance *instance) {
+  if (instance->state && instance->type->destroy) instance->type->destroy(instance->state);
+  free(instance->state);
+  free(instance->prepared_param);
+  instance->state = instance->prepared_param = NULL;
+  instance->prepared = false;
+}
+
+// prepares the instance unless it already is for these parameters (and, for rect sized types, this rect size)
+bool effect_instance_prepare(EffectInstance *instance, GRect position) {
+  const EffectType *type = instance->type;
+  if (instance->prepared && memcmp(instance->prepared_param, instance->param, type->param_size) == 0 &&
+      (!type->rect_sized || (instance->prepared_size.w == position.size.w && instance->prepared_size.h == position.size.h)))
+    return true;
+
+  if (!instance->state && type->state_size) {
+    instance->state = calloc(1, type->state_size);
+    if (!instance->state) return false;
+  }
+  if (!instance->prepared_param && type->param_size) {
+    instance->prepared_param = malloc(type->param_size);
+    if (!instance->prepared_param) return false;
+  }
+
+  // prepare keeps what it can reuse from the previous parameters (it is handed the same state)
+  instance->prepared = !type->prepare || type->prepare(instance->state, instance->param, position);
+  if (!instance->prepared) return false;
+  if (type->param_size) memcpy(instance->prepared_param, instance->param, type->param_size);
+  instance->prepared_size = position.size;
+  return true;
+}
+
+// types of this library capture with effect_capture_frame_buffer (callback ones go through effect_call)
+static bool library_type(const EffectType *type) {
+  return type == &effect_type_callback || type == &effect_type_colorize || type == &effect_type_colorswap ||
+         type == &effect_type_invert_brightness || type == &effect_type_blur || type == &effect_type_zoom ||
+         type == &effect_type_lens;
+}
+
+// runs an EffectInstance (param), preparing it first when its parameters changed
+// (the shared framebuffer capture is released before types from outside this library, see effect_call)
+void effect_run(GContext* ctx, GRect position, void* param) {
+  EffectInstance *instance = (EffectInstance *)param;
+  if (!effect_instance_prepare(instance, position)) return;
+  if (!library_type(instance->type)) effect_frame_flush(ctx);
+  instance->type->apply(ctx, position, instance->param, instance->state);
+}
+
+static void callback_apply(GContext *ctx, GRect position, const void *param, void *state) {
+  const EffectCallback *callback = (const EffectCallback *)param;
+  effect_call(callback->effect, ctx, position, callback->param);
+}
+
+static int16_t callback_halo(const void *param) {
+  const EffectCallback *callback = (const EffectCallback *)param;
+  return effect_halo(callback->effect, callback->param);
+}
+
+const EffectType effect_type_callback = {
+  .param_size = sizeof(EffectCallback),
+  .apply = callback_apply,
+  .halo = callback_halo,
+};
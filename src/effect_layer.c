@@ -1,6 +1,35 @@
 #include <pebble.h>
 #include "effect_layer.h"
 #include "effects.h"  
+#include "bitplane.h"
+
+// entry of the effect list of an effect layer
+typedef struct {
+  effect_cb*  effect;
+  void*       param;
+  GRect       rect; // part of the layer (in layer coordinates) the effect runs on, empty for the whole layer
+  bool        enabled; // disabled effects are skipped
+  EffectRunPolicy policy;
+  uint16_t    policy_arg; // n of EffectRunEveryNFrames, TimeUnits of EffectRunOnTimeUnits
+  uint16_t    skipped; // updates skipped since the last run
+  time_t      last_run;
+  uint8_t*    saved; // output of the last run (effect_saved_size(saved_rect) bytes), NULL when there is none
+  GRect       saved_rect; // screen area of saved
+} EffectEntry;
+  
+// structure of effect layer
+struct EffectLayer {
+  Layer*      layer;
+  EffectEntry* entries; // effect list, applied in order (grown as needed)
+  uint8_t     count;
+  uint8_t     capacity;
+  GRect       dirty; // screen area invalidated since the last update (empty: the whole frame)
+  GPoint      parent_origin; // absolute origin of the parent layer, valid when parent_origin_valid
+  bool        parent_origin_valid;
+  bool        keep_input; // set by the first marked rect: chains with a halo keep a copy of their input
+  uint8_t*    input; // input of the last update over input_rect (framebuffer rows), NULL when there is none
+  GRect       input_rect;
+};
 
 // Find the offset of parent layer pointer  
 static uint8_t find_parent_offset() {
@@ -11,9 +40,9 @@ static uint8_t find_parent_offset() {
   uint8_t i=0;
   while(i<16 && *(((Layer**)(void*)l)+i)!=p) ++i;
 
-  if(*(((Layer**)(void*)l)+i)!=p) {
+  if(i==16) {
     i=0xff;
-    APP_LOG(APP_LOG_LEVEL_ERROR,"EffectLayer library was unable to find the parent layer offset! Your app will probably crash (sorry) :(");
+    APP_LOG(APP_LOG_LEVEL_ERROR,"EffectLayer library was unable to find the parent layer offset! Layer frames are used as screen coordinates");
   }
 
   layer_destroy(l);
@@ -21,25 +50,300 @@ static uint8_t find_parent_offset() {
   return i;
 }
 
-// on layer update - apply effect
-static void effect_layer_update_proc(Layer *me, GContext* ctx) {
-  static uint8_t parent_layer_offset = 0xff;
-  if(parent_layer_offset == 0xff) {
+// absolute origin of the layer's parent: sum of the frames of all ancestors
+// (when the parent pointer can't be found the layer is assumed to sit at the screen origin)
+static GPoint find_parent_origin(Layer *me) {
+  static uint8_t parent_layer_offset = 0;
+  static bool probed = false;
+  if(!probed) {
     parent_layer_offset = find_parent_offset();
+    probed = true;
   }
-  
-  // retrieving layer and its real coordinates
-  EffectLayer* effect_layer = (EffectLayer*)(layer_get_data(me));
-  GRect layer_frame = layer_get_frame(me);
+
+  GPoint origin = GPoint(0, 0);
+  if(parent_layer_offset == 0xff) return origin;
+
   Layer* l = me;
   while((l=((Layer**)(void*)l)[parent_layer_offset])) {
     GRect parent_frame = layer_get_frame(l);
-    layer_frame.origin.x += parent_frame.origin.x;
-    layer_frame.origin.y += parent_frame.origin.y;
+    origin.x += parent_frame.origin.x;
+    origin.y += parent_frame.origin.y;
   }
-  
-  // Applying effects
-  for(uint8_t i=0; effect_layer->effects[i] && i<MAX_EFFECTS;++i) effect_layer->effects[i](ctx, layer_frame, effect_layer->params[i]);
+  return origin;
+}
+
+// an entry's sub-rect of the frame (the whole frame when it has none)
+static GRect entry_frame(GRect frame, EffectEntry* entry) {
+  if(entry->rect.size.w > 0 && entry->rect.size.h > 0) {
+    GRect sub = entry->rect;
+    sub.origin.x += frame.origin.x;
+    sub.origin.y += frame.origin.y;
+    grect_clip(&sub, &frame);
+    frame = sub;
+  }
+  return frame;
+}
+
+// area an entry runs on: its sub-rect of the frame, narrowed to area
+static GRect effect_rect(GRect frame, EffectEntry* entry, GRect area) {
+  frame = entry_frame(frame, entry);
+  grect_clip(&area, &frame);
+  return area;
+}
+
+// rect grown by margin on every side
+static GRect grow_rect(GRect rect, int16_t margin) {
+  return GRect(rect.origin.x - margin, rect.origin.y - margin, rect.size.w + 2 * margin, rect.size.h + 2 * margin);
+}
+
+// halo of the chain: the sum of the halos of the entries that run every frame, EFFECT_HALO_FRAME when one of
+// them depends on the whole rect or reads around the pixels it changes other than by casting them (blur
+// and the like read pixels they changed on an earlier update)
+static int16_t chain_halo(EffectLayer* effect_layer) {
+  int16_t sum = 0;
+  for(uint8_t i=0; i<effect_layer->count; ++i) {
+    EffectEntry *entry = &effect_layer->entries[i];
+    if(!entry->enabled || entry->policy != EffectRunEveryFrame) continue;
+    int16_t halo = effect_halo(entry->effect, entry->param);
+    if(halo == EFFECT_HALO_FRAME) return EFFECT_HALO_FRAME;
+    if(halo > 0 && entry->effect != effect_shadow && entry->effect != effect_outline) return EFFECT_HALO_FRAME;
+    sum += halo;
+  }
+  return sum;
+}
+
+// copies rect (inside input_rect) from the framebuffer into the input copy, or back when to_fb
+static void copy_input(EffectLayer* effect_layer, GBitmap* fb, GRect rect, bool to_fb) {
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  uint8_t *row = gbitmap_get_data(fb) + rect.origin.y * bytes_per_row;
+  uint8_t *copy = effect_layer->input + (rect.origin.y - effect_layer->input_rect.origin.y) * bytes_per_row;
+  for(int y=0; y<rect.size.h; ++y, row += bytes_per_row, copy += bytes_per_row) {
+    #ifdef PBL_COLOR
+      if(to_fb) memcpy(row + rect.origin.x, copy + rect.origin.x, rect.size.w);
+      else memcpy(copy + rect.origin.x, row + rect.origin.x, rect.size.w);
+    #else
+      if(to_fb) bitplane_blit(row, rect.origin.x, copy, rect.origin.x, rect.size.w, BitplaneCopy);
+      else bitplane_blit(copy, rect.origin.x, row, rect.origin.x, rect.size.w, BitplaneCopy);
+    #endif
+  }
+}
+
+// brings the input copy up to date before the chain runs: the marked area, or the whole frame when none is
+// marked. A copy that is missing or was made for another frame is (re)made from the whole frame, which
+// only holds input when the whole frame was drawn; false then, so the update runs on the whole frame
+static bool update_input(EffectLayer* effect_layer, GBitmap* fb, GRect frame, GRect dirty) {
+  if(!effect_clip(fb, &frame)) return false;
+  bool valid = effect_layer->input && grect_equal(&effect_layer->input_rect, &frame);
+  if(!valid) {
+    free(effect_layer->input);
+    effect_layer->input = malloc(gbitmap_get_bytes_per_row(fb) * frame.size.h);
+    effect_layer->input_rect = frame;
+    if(!effect_layer->input) return false;
+  }
+  if(!valid || dirty.size.w == 0) {
+    copy_input(effect_layer, fb, frame, false);
+    return valid;
+  }
+  grect_clip(&dirty, &frame);
+  if(dirty.size.w > 0 && dirty.size.h > 0) copy_input(effect_layer, fb, dirty, false);
+  return true;
+}
+
+// the strips of outer (clipped to the framebuffer) above, below, left and right of inner, which lies inside
+// outer; returns the bytes they take with effect_save_rect
+static size_t band_rects(GBitmap* fb, GRect outer, GRect inner, GRect band[4]) {
+  band[0] = GRect(outer.origin.x, outer.origin.y, outer.size.w, inner.origin.y - outer.origin.y);
+  band[1] = GRect(outer.origin.x, inner.origin.y + inner.size.h, outer.size.w, outer.origin.y + outer.size.h - inner.origin.y - inner.size.h);
+  band[2] = GRect(outer.origin.x, inner.origin.y, inner.origin.x - outer.origin.x, inner.size.h);
+  band[3] = GRect(inner.origin.x + inner.size.w, inner.origin.y, outer.origin.x + outer.size.w - inner.origin.x - inner.size.w, inner.size.h);
+  size_t size = 0;
+  for(int i=0; i<4; ++i) {
+    if(band[i].size.w > 0 && band[i].size.h > 0 && effect_clip(fb, &band[i])) size += effect_saved_size(band[i]);
+    else band[i].size.w = 0;
+  }
+  return size;
+}
+
+// true when a in any of units differs from b (a unit changes with any coarser one)
+static bool time_units_changed(time_t a, time_t b, TimeUnits units) {
+  struct tm ta = *localtime(&a), tb = *localtime(&b);
+  bool year = ta.tm_year != tb.tm_year;
+  bool month = year || ta.tm_mon != tb.tm_mon;
+  bool day = month || ta.tm_mday != tb.tm_mday;
+  bool hour = day || ta.tm_hour != tb.tm_hour;
+  bool minute = hour || ta.tm_min != tb.tm_min;
+  bool second = minute || ta.tm_sec != tb.tm_sec;
+  return ((units & YEAR_UNIT) && year) || ((units & MONTH_UNIT) && month) || ((units & DAY_UNIT) && day) ||
+         ((units & HOUR_UNIT) && hour) || ((units & MINUTE_UNIT) && minute) || ((units & SECOND_UNIT) && second);
+}
+
+// whether an entry with a run policy has to run on this update (rect: its area on screen)
+static bool entry_due(EffectLayer* effect_layer, EffectEntry* entry, GRect rect) {
+  switch(entry->policy) {
+    case EffectRunEveryNFrames:
+      return entry->skipped + 1 >= entry->policy_arg;
+    case EffectRunOnTimeUnits:
+      return time_units_changed(entry->last_run, time(NULL), (TimeUnits)entry->policy_arg);
+    case EffectRunWhenDirty: {
+      GRect dirty = effect_layer->dirty;
+      grect_clip(&dirty, &rect);
+      return dirty.size.w > 0 && dirty.size.h > 0;
+    }
+    default:
+      return true;
+  }
+}
+
+// runs an entry with a run policy when it is due and keeps its output, otherwise copies the kept output back
+static void run_timed(EffectLayer* effect_layer, GContext* ctx, EffectEntry* entry, GRect rect) {
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  GRect clip = rect;
+  if(!effect_clip(fb, &clip)) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  if(entry->saved && grect_equal(&entry->saved_rect, &clip) && !entry_due(effect_layer, entry, clip)) {
+    effect_restore_rect(fb, clip, entry->saved);
+    effect_release_frame_buffer(ctx, fb);
+    ++entry->skipped;
+    return;
+  }
+  effect_release_frame_buffer(ctx, fb);
+
+  effect_call(entry->effect, ctx, rect, entry->param);
+  entry->skipped = 0;
+  entry->last_run = time(NULL);
+
+  if(!entry->saved || !grect_equal(&entry->saved_rect, &clip)) {
+    free(entry->saved);
+    entry->saved = malloc(effect_saved_size(clip));
+    entry->saved_rect = clip;
+  }
+  if(entry->saved) {
+    fb = effect_capture_frame_buffer(ctx);
+    effect_save_rect(fb, clip, entry->saved);
+    effect_release_frame_buffer(ctx, fb);
+  }
+}
+
+// runs a merged run of pixel-local entries (a lone one still runs its own kernel)
+static void run_fused(EffectLayer* effect_layer, GContext* ctx, EffectPalette* palette, uint8_t fused, uint8_t first, GRect rect) {
+  if(fused == 1) effect_call(effect_layer->entries[first].effect, ctx, rect, effect_layer->entries[first].param);
+  else if(fused > 1) effect_call(effect_palette_map, ctx, rect, palette);
+}
+
+// runs the enabled entries in order with the shared framebuffer capture, each on its part of area (entries
+// with a run policy on their whole rect). Runs of pixel-local effects over the same rect are merged into
+// one palette so they cost a single pass
+static void run_chain(EffectLayer* effect_layer, GContext* ctx, GRect frame, GRect area) {
+  static EffectPalette palette;
+  uint8_t fused = 0, first = 0;
+  GRect fused_rect = GRect(0, 0, 0, 0);
+  for(uint8_t i=0; i<effect_layer->count; ++i) {
+    EffectEntry *entry = &effect_layer->entries[i];
+    if(!entry->enabled) continue;
+    if(entry->policy != EffectRunEveryFrame) { // run alone on its whole rect, so its output can be kept
+      run_fused(effect_layer, ctx, &palette, fused, first, fused_rect);
+      fused = 0;
+      run_timed(effect_layer, ctx, entry, entry_frame(frame, entry));
+      continue;
+    }
+    GRect rect = effect_rect(frame, entry, area);
+    if(rect.size.w <= 0 || rect.size.h <= 0) continue;
+
+    if(fused > 0 && !grect_equal(&rect, &fused_rect)) {
+      run_fused(effect_layer, ctx, &palette, fused, first, fused_rect);
+      fused = 0;
+    }
+    if(fused == 0) effect_palette_init(&palette);
+    if(effect_palette_add_effect(&palette, entry->effect, entry->param)) {
+      if(fused++ == 0) {
+        first = i;
+        fused_rect = rect;
+      }
+      continue;
+    }
+    run_fused(effect_layer, ctx, &palette, fused, first, fused_rect);
+    fused = 0;
+    effect_call(entry->effect, ctx, rect, entry->param);
+  }
+  run_fused(effect_layer, ctx, &palette, fused, first, fused_rect);
+}
+
+// runs a chain of pixel-local effects, shadows and outlines (halo: the sum of theirs) after dirty changed.
+// Output can change up to halo around dirty and depends on the input up to twice that far, so the input
+// copy is put back there and the chain runs on it; what the chain wrote outside the changed area (up to
+// halo further out) is put back afterwards. Without memory for that it redraws the whole frame
+static void run_cast(EffectLayer* effect_layer, GContext* ctx, GRect frame, GRect dirty, int16_t halo) {
+  GRect changed = grow_rect(dirty, halo), run = grow_rect(dirty, 2 * halo);
+  grect_clip(&run, &frame);
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  GRect band[4];
+  size_t size = band_rects(fb, grow_rect(run, halo), changed, band);
+  uint8_t *saved = size ? malloc(size) : NULL;
+  if(size && !saved) {
+    copy_input(effect_layer, fb, effect_layer->input_rect, true);
+    effect_release_frame_buffer(ctx, fb);
+    run_chain(effect_layer, ctx, frame, frame);
+    return;
+  }
+  uint8_t *data = saved;
+  for(int i=0; i<4; ++i) {
+    if(!band[i].size.w) continue;
+    effect_save_rect(fb, band[i], data);
+    data += effect_saved_size(band[i]);
+  }
+  GRect input = run;
+  if(effect_clip(fb, &input)) copy_input(effect_layer, fb, input, true);
+  effect_release_frame_buffer(ctx, fb);
+
+  run_chain(effect_layer, ctx, frame, run);
+
+  fb = effect_capture_frame_buffer(ctx);
+  data = saved;
+  for(int i=0; i<4; ++i) {
+    if(!band[i].size.w) continue;
+    effect_restore_rect(fb, band[i], data);
+    data += effect_saved_size(band[i]);
+  }
+  effect_release_frame_buffer(ctx, fb);
+  free(saved);
+}
+
+// on layer update - apply effect
+static void effect_layer_update_proc(Layer *me, GContext* ctx) {
+  // retrieving layer and its real coordinates (parent origin is only resolved again after an invalidate)
+  EffectLayer* effect_layer = (EffectLayer*)(layer_get_data(me));
+  if(!effect_layer->parent_origin_valid) {
+    effect_layer->parent_origin = find_parent_origin(me);
+    effect_layer->parent_origin_valid = true;
+  }
+  GRect layer_frame = layer_get_frame(me);
+  layer_frame.origin.x += effect_layer->parent_origin.x;
+  layer_frame.origin.y += effect_layer->parent_origin.y;
+
+  // Applying enabled effects with a single framebuffer capture. With a marked area pixel-local chains only
+  // redo that area; chains that read around it run on the input copy (see effect_layer_mark_dirty_rect)
+  GRect dirty = effect_layer->dirty;
+  bool marked = dirty.size.w > 0 && dirty.size.h > 0;
+  int16_t halo = chain_halo(effect_layer);
+  bool whole = !marked || halo == EFFECT_HALO_FRAME;
+  effect_frame_begin(ctx);
+  if(effect_layer->keep_input && (halo != 0 || effect_layer->input)) {
+    GBitmap *fb = effect_capture_frame_buffer(ctx);
+    if(!update_input(effect_layer, fb, layer_frame, dirty)) whole = true;
+    else if(marked && halo == EFFECT_HALO_FRAME) copy_input(effect_layer, fb, effect_layer->input_rect, true);
+    effect_release_frame_buffer(ctx, fb);
+  }
+  if(whole) {
+    run_chain(effect_layer, ctx, layer_frame, layer_frame);
+  } else {
+    grect_clip(&dirty, &layer_frame);
+    if(halo == 0 || dirty.size.w <= 0 || dirty.size.h <= 0) run_chain(effect_layer, ctx, layer_frame, dirty);
+    else run_cast(effect_layer, ctx, layer_frame, dirty, halo);
+  }
+  effect_frame_end(ctx);
+  effect_layer->dirty = GRect(0, 0, 0, 0);
 }  
 
 // create effect layer
@@ -57,11 +361,12 @@ EffectLayer* effect_layer_create(GRect frame) {
 
 //destroy effect layer
 void effect_layer_destroy(EffectLayer *effect_layer) {
-  // precaution
+  // precaution (effect_layer lives in the layer's data, so it is gone after layer_destroy)
   if (effect_layer != NULL && effect_layer->layer != NULL) {
+    for(uint8_t i=0; i<effect_layer->count; ++i) free(effect_layer->entries[i].saved);
+    free(effect_layer->entries);
+    free(effect_layer->input);
     layer_destroy(effect_layer->layer);  
-    effect_layer->layer = NULL;
-    effect_layer = NULL;
   }
   
 }
@@ -74,22 +379,108 @@ Layer* effect_layer_get_layer(EffectLayer *effect_layer){
 //sets frame for effect layer
 void effect_layer_set_frame(EffectLayer *effect_layer, GRect frame) {
   layer_set_frame(effect_layer->layer, frame);
+  effect_layer->parent_origin_valid = false;
 }
 
-//adds effect to the layer
-void effect_layer_add_effect(EffectLayer *effect_layer, effect_cb* effect, void* param) {
-  if(effect_layer->next_effect < MAX_EFFECTS) {
-    effect_layer->effects[effect_layer->next_effect] = effect;
-    effect_layer->params[effect_layer->next_effect] = param;  
-    ++effect_layer->next_effect;
+//drops the cached parent origin
+void effect_layer_invalidate_frame(EffectLayer *effect_layer) {
+  effect_layer->parent_origin_valid = false;
+  layer_mark_dirty(effect_layer->layer);
+}
+
+//marks part of the screen as changed since the last update
+void effect_layer_mark_dirty_rect(EffectLayer *effect_layer, GRect rect) {
+  if(rect.size.w <= 0 || rect.size.h <= 0) return;
+
+  GRect *dirty = &effect_layer->dirty;
+  if(dirty->size.w > 0 && dirty->size.h > 0) { // union of both rects
+    int16_t x1 = dirty->origin.x + dirty->size.w, y1 = dirty->origin.y + dirty->size.h;
+    if(rect.origin.x + rect.size.w > x1) x1 = rect.origin.x + rect.size.w;
+    if(rect.origin.y + rect.size.h > y1) y1 = rect.origin.y + rect.size.h;
+    if(dirty->origin.x < rect.origin.x) rect.origin.x = dirty->origin.x;
+    if(dirty->origin.y < rect.origin.y) rect.origin.y = dirty->origin.y;
+    rect.size.w = x1 - rect.origin.x;
+    rect.size.h = y1 - rect.origin.y;
   }
+  *dirty = rect;
+  effect_layer->keep_input = true;
+  layer_mark_dirty(effect_layer->layer);
+}
+
+//adds effect at the end of the list
+int effect_layer_add_effect(EffectLayer *effect_layer, effect_cb* effect, void* param) {
+  return effect_layer_insert_effect(effect_layer, effect_layer->count, effect, param);
+}
+
+//inserts effect before position index (enabled, on the whole layer)
+int effect_layer_insert_effect(EffectLayer *effect_layer, uint8_t index, effect_cb* effect, void* param) {
+  if(effect_layer->count >= MAX_EFFECTS || !effect) return -1;
+  if(index > effect_layer->count) index = effect_layer->count;
+
+  if(effect_layer->count == effect_layer->capacity) {
+    int capacity = effect_layer->capacity ? effect_layer->capacity * 2 : 4;
+    if(capacity > MAX_EFFECTS) capacity = MAX_EFFECTS;
+    EffectEntry *entries = realloc(effect_layer->entries, capacity * sizeof(EffectEntry));
+    if(!entries) return -1;
+    effect_layer->entries = entries;
+    effect_layer->capacity = capacity;
+  }
+
+  EffectEntry *entry = &effect_layer->entries[index];
+  memmove(entry + 1, entry, (effect_layer->count - index) * sizeof(EffectEntry));
+  memset(entry, 0, sizeof(EffectEntry));
+  entry->effect = effect;
+  entry->param = param;
+  entry->enabled = true;
+  ++effect_layer->count;
+  layer_mark_dirty(effect_layer->layer);
+  return index;
 }
 
 //removes last added effect
 void effect_layer_remove_effect(EffectLayer *effect_layer) {
-  if(effect_layer->next_effect > 0) {
-    effect_layer->effects[effect_layer->next_effect - 1] = NULL;
-    effect_layer->params[effect_layer->next_effect - 1] = NULL;  
-    --effect_layer->next_effect;
-  }
-}
\ No newline at end of file
+  if(effect_layer->count > 0) effect_layer_remove_effect_at(effect_layer, effect_layer->count - 1);
+}
+
+//removes effect at position index
+void effect_layer_remove_effect_at(EffectLayer *effect_layer, uint8_t index) {
+  if(index >= effect_layer->count) return;
+  EffectEntry *entry = &effect_layer->entries[index];
+  free(entry->saved);
+  memmove(entry, entry + 1, (effect_layer->count - index - 1) * sizeof(EffectEntry));
+  --effect_layer->count;
+  layer_mark_dirty(effect_layer->layer);
+}
+
+//number of effects in the list
+uint8_t effect_layer_get_effect_count(EffectLayer *effect_layer) {
+  return effect_layer->count;
+}
+
+//enables or disables effect at position index
+void effect_layer_set_effect_enabled(EffectLayer *effect_layer, uint8_t index, bool enabled) {
+  if(index >= effect_layer->count || effect_layer->entries[index].enabled == enabled) return;
+  effect_layer->entries[index].enabled = enabled;
+  free(effect_layer->entries[index].saved); // what it covered may have changed meanwhile
+  effect_layer->entries[index].saved = NULL;
+  layer_mark_dirty(effect_layer->layer);
+}
+
+//restricts effect at position index to rect (in layer coordinates)
+void effect_layer_set_effect_rect(EffectLayer *effect_layer, uint8_t index, GRect rect) {
+  if(index >= effect_layer->count) return;
+  effect_layer->entries[index].rect = rect;
+  layer_mark_dirty(effect_layer->layer);
+}
+
+//sets when effect at position index runs; its kept output is dropped so it runs on the next update
+void effect_layer_set_effect_policy(EffectLayer *effect_layer, uint8_t index, EffectRunPolicy policy, uint16_t arg) {
+  if(index >= effect_layer->count) return;
+  EffectEntry *entry = &effect_layer->entries[index];
+  entry->policy = policy;
+  entry->policy_arg = arg;
+  entry->skipped = 0;
+  free(entry->saved);
+  entry->saved = NULL;
+  layer_mark_dirty(effect_layer->layer);
+}
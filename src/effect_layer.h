@@ -3,15 +3,20 @@
 #include "effects.h"
   
 //number of supported effects on a single effect_layer (must be <= 255)
-#define MAX_EFFECTS 4
-  
-// structure of effect layer
-typedef struct {
-  Layer*      layer;
-  effect_cb*  effects[MAX_EFFECTS];
-  void*       params[MAX_EFFECTS];
-  uint8_t     next_effect;
-} EffectLayer;
+#define MAX_EFFECTS 255
+
+// when an entry of the effect list runs. On the frames it is skipped its output of the last run is copied
+// back instead, so only use a policy when the pixels under the effect change no more often than that
+typedef enum {
+  EffectRunEveryFrame,   // default
+  EffectRunEveryNFrames, // every n-th update of the layer
+  EffectRunOnTimeUnits,  // when one of the given TimeUnits changed since the last run (like a tick handler)
+  EffectRunWhenDirty,    // when effect_layer_mark_dirty_rect marked part of its rect since the last update
+} EffectRunPolicy;
+
+// effect layer: a layer that runs a list of effects over what is drawn under it. Its fields are private to
+// effect_layer.c (they no longer match the old public struct), use the functions below
+typedef struct EffectLayer EffectLayer;
 
 
 //creates effect layer
@@ -20,18 +25,50 @@ EffectLayer* effect_layer_create(GRect frame);
 //destroys effect layer
 void effect_layer_destroy(EffectLayer *effect_layer);
 
-//adds effect for the layer
-void effect_layer_add_effect(EffectLayer *effect_layer, effect_cb* effect, void* param);
+//adds effect for the layer, returns its position in the list (-1 if it couldn't be added)
+int effect_layer_add_effect(EffectLayer *effect_layer, effect_cb* effect, void* param);
+
+//inserts effect before position index, returns its position (-1 if it couldn't be added)
+int effect_layer_insert_effect(EffectLayer *effect_layer, uint8_t index, effect_cb* effect, void* param);
 
 //removes last added effect
 void effect_layer_remove_effect(EffectLayer *effect_layer);
 
+//removes effect at position index
+void effect_layer_remove_effect_at(EffectLayer *effect_layer, uint8_t index);
+
+//number of effects in the list
+uint8_t effect_layer_get_effect_count(EffectLayer *effect_layer);
+
+//enables or disables effect at position index (disabled effects cost nothing when drawing)
+void effect_layer_set_effect_enabled(EffectLayer *effect_layer, uint8_t index, bool enabled);
+
+//restricts effect at position index to rect (in layer coordinates, GRectZero for the whole layer)
+void effect_layer_set_effect_rect(EffectLayer *effect_layer, uint8_t index, GRect rect);
+
+//sets when effect at position index runs (arg: n for EffectRunEveryNFrames, TimeUnits for EffectRunOnTimeUnits).
+//Skipped updates copy back its last output, which costs a buffer of the effect's rect
+void effect_layer_set_effect_policy(EffectLayer *effect_layer, uint8_t index, EffectRunPolicy policy, uint16_t arg);
+
 //gets layer
 Layer* effect_layer_get_layer(EffectLayer *effect_layer);
 
 //sets effect layer frame
 void effect_layer_set_frame(EffectLayer *effect_layer, GRect frame);
 
+//the absolute position of the layer is cached: call this after moving one of its ancestors
+//(or adding it to another parent) so it gets resolved again
+void effect_layer_invalidate_frame(EffectLayer *effect_layer);
+
+//marks part of the screen (in screen coordinates) as redrawn: until the next update the output only changes
+//around the union of the marked areas. Only use this when the rest of the framebuffer keeps the previous
+//output between frames. Chains of pixel-local effects only redo the marked area. Chains with shadows or
+//outlines redo it grown by their halos from a copy of the layer's input, other chains (blur, mirrors,
+//rotation, zoom, lens, mask...) the whole frame from that copy. The copy (a framebuffer sized buffer over
+//the frame) is made on the first update after the first marked rect, which runs on the whole frame as drawn,
+//so draw all of it then; without memory for the copy updates run on the whole frame as drawn
+void effect_layer_mark_dirty_rect(EffectLayer *effect_layer, GRect rect);
+
 // Recreate inverter_layer for BASALT
 #ifndef PBL_PLATFORM_APLITE
   #define InverterLayer EffectLayer
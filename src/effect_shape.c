@@ -0,0 +1,106 @@
+#include <pebble.h>
+
+#include "effects.h"
+
+void effect_shape_destroy(EffectShape *shape) {
+  free(shape->spans);
+  shape->spans = NULL;
+  shape->count = shape->capacity = 0;
+}
+
+// appends span [x0, x1) of row y (empty spans are dropped)
+static bool add_span(EffectShape *shape, int y, int x0, int x1) {
+  if (x1 <= x0) return true;
+  if (shape->count == shape->capacity) {
+    uint16_t capacity = shape->capacity ? 2 * shape->capacity : 32;
+    EffectSpan *spans = realloc(shape->spans, capacity * sizeof(EffectSpan));
+    if (!spans) return false;
+    shape->spans = spans;
+    shape->capacity = capacity;
+  }
+  shape->spans[shape->count++] = (EffectSpan){ y, x0, x1 };
+  return true;
+}
+
+// half width of a circle row: largest x with x*x+dy*dy < r*r, -1 when the row misses the circle
+static int half_width(int r, int dy) {
+  int x = -1;
+  while ((x + 1) * (x + 1) + dy * dy < r * r) ++x;
+  return x;
+}
+
+// pixels with (x-centre.x)^2 + (y-centre.y)^2 < radius^2, the same test effect_lens uses
+bool effect_shape_circle(EffectShape *shape, GPoint centre, uint16_t radius) {
+  return effect_shape_annulus(shape, centre, 0, radius);
+}
+
+// circle of outer_radius without the circle of inner_radius: two spans on the rows crossing the hole
+bool effect_shape_annulus(EffectShape *shape, GPoint centre, uint16_t inner_radius, uint16_t outer_radius) {
+  shape->count = 0;
+  int outer = outer_radius > 0 ? half_width(outer_radius, 0) : -1;
+  for (int dy = -outer; dy <= outer; dy++) {
+    int w = half_width(outer_radius, dy), hole = half_width(inner_radius, dy);
+    int y = centre.y + dy;
+    if (w < 0) continue;
+    if (hole < 0) {
+      if (!add_span(shape, y, centre.x - w, centre.x + w + 1)) return false;
+    } else if (!add_span(shape, y, centre.x - w, centre.x - hole) ||
+               !add_span(shape, y, centre.x + hole + 1, centre.x + w + 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// rect with quarter circle corners: a corner row is inset by the first pixel whose centre is inside the
+// corner circle (centre corner_radius from both edges)
+bool effect_shape_round_rect(EffectShape *shape, GRect rect, uint16_t corner_radius) {
+  shape->count = 0;
+  int r = corner_radius;
+  if (2 * r > rect.size.w) r = rect.size.w / 2;
+  if (2 * r > rect.size.h) r = rect.size.h / 2;
+  for (int i = 0; i < rect.size.h; i++) {
+    // distance of the row from the nearest corner centre, in half pixels
+    int row = i < r ? i : rect.size.h - 1 - i;
+    int inset = 0;
+    if (row < r) {
+      int dy = 2 * r - 2 * row - 1;
+      while (inset < r && (2 * r - 2 * inset - 1) * (2 * r - 2 * inset - 1) + dy * dy >= 4 * r * r) ++inset;
+    }
+    if (!add_span(shape, rect.origin.y + i, rect.origin.x + inset, rect.origin.x + rect.size.w - inset)) return false;
+  }
+  return true;
+}
+
+// polygon filled with the even-odd rule: pixels whose centre lies between a pair of edge crossings of its row
+bool effect_shape_polygon(EffectShape *shape, const GPoint *points, uint16_t num_points) {
+  shape->count = 0;
+  if (num_points < 3) return true;
+  int32_t *crossings = effect_scratch(num_points * sizeof(int32_t));
+  if (!crossings) return false;
+
+  int y_min = points[0].y, y_max = points[0].y;
+  for (int i = 1; i < num_points; i++) {
+    if (points[i].y < y_min) y_min = points[i].y;
+    if (points[i].y > y_max) y_max = points[i].y;
+  }
+
+  for (int y = y_min; y < y_max; y++) {
+    // crossings of the row centre (y + 1/2) as 16.16 x, sorted
+    int count = 0, yc = 2 * y + 1;
+    for (int i = 0; i < num_points; i++) {
+      GPoint a = points[i], b = points[(i + 1) % num_points];
+      if ((2 * a.y <= yc) == (2 * b.y <= yc)) continue;
+      int32_t x = (a.x << 16) + (int32_t)(((int64_t)(yc - 2 * a.y) * (b.x - a.x) << 15) / (b.y - a.y));
+      int k = count++;
+      for (; k > 0 && crossings[k - 1] > x; k--) crossings[k] = crossings[k - 1];
+      crossings[k] = x;
+    }
+    // pixel x is covered when x + 1/2 is in [left, right)
+    for (int k = 0; k + 1 < count; k += 2) {
+      int x0 = (crossings[k] + 0x7FFF) >> 16, x1 = (crossings[k + 1] + 0x7FFF) >> 16;
+      if (!add_span(shape, y, x0, x1)) return false;
+    }
+  }
+  return true;
+}
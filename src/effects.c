@@ -1,5 +1,7 @@
 #include <pebble.h>
 #include "effects.h"
+#include "bitplane.h"
+#include "dither.h"
 #include "math.h"
   
   
@@ -7,34 +9,55 @@
   
    
 
+// per-format pixel access through row pointers. Kernels are written once against GET/SET and expanded per
+// bitmap format, so the format is resolved once per call and rows advance by bytes_per_row instead of
+// recomputing y*bytes_per_row per pixel. 1bit values are 0/1 (1bit is LSB first, 1bit palette MSB first)
+#define PIXEL_GET_1BIT(row, x) (((row)[(x) >> 3] >> ((x) & 7)) & 1)
+#define PIXEL_SET_1BIT(row, x, v) ((row)[(x) >> 3] = ((row)[(x) >> 3] & ~(1 << ((x) & 7))) | (((v) & 1) << ((x) & 7)))
+#define PIXEL_GET_1BIT_PALETTE(row, x) (((row)[(x) >> 3] >> (7 - ((x) & 7))) & 1)
+#define PIXEL_SET_1BIT_PALETTE(row, x, v) ((row)[(x) >> 3] = ((row)[(x) >> 3] & ~(0x80 >> ((x) & 7))) | (((v) & 1) << (7 - ((x) & 7))))
+#define PIXEL_GET_8BIT(row, x) ((row)[x])
+#define PIXEL_SET_8BIT(row, x, v) ((row)[x] = (v))
+
+// framebuffer format of the platform
+#ifdef PBL_COLOR
+  #define FB_GET PIXEL_GET_8BIT
+  #define FB_SET PIXEL_SET_8BIT
+#else
+  #define FB_GET PIXEL_GET_1BIT
+  #define FB_SET PIXEL_SET_1BIT
+#endif
+
 // set pixel color at given coordinates 
 void set_pixel(BitmapInfo bitmap_info, int y, int x, uint8_t color) {
+  uint8_t *row = bitmap_info.bitmap_data + y * bitmap_info.bytes_per_row;
   
 #ifdef PBL_PLATFORM_BASALT  
-  if (bitmap_info.bitmap_format == GBitmapFormat1BitPalette) { // for 1bit palette bitmap on Basalt --- verify if it needs to be different
-     bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x / 8] ^= (-color ^ bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x / 8]) & (1 << (x % 8)); 
+  if (bitmap_info.bitmap_format == GBitmapFormat1BitPalette) { // for 1bit palette bitmap on Basalt (any non zero value sets the bit)
+     PIXEL_SET_1BIT_PALETTE(row, x, color != 0);
 #else
-  if (bitmap_info.bitmap_format == GBitmapFormat1Bit) { // for 1 bit bitmap on Aplite  --- verify if it needs to be different
-     bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x / 8] ^= (-color ^ bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x / 8]) & (1 << (x % 8)); 
+  if (bitmap_info.bitmap_format == GBitmapFormat1Bit) { // for 1 bit bitmap on Aplite
+     PIXEL_SET_1BIT(row, x, color);
 #endif
   } else { // othersise (assuming GBitmapFormat8Bit) going byte-wise
-     bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x] = color;
+     PIXEL_SET_8BIT(row, x, color);
   }
       
 }
 
 // get pixel color at given coordinates 
 uint8_t get_pixel(BitmapInfo bitmap_info, int y, int x) {
+  const uint8_t *row = bitmap_info.bitmap_data + y * bitmap_info.bytes_per_row;
 
 #ifdef PBL_PLATFORM_BASALT  
-  if (bitmap_info.bitmap_format == GBitmapFormat1BitPalette) { // for 1bit palette bitmap on Basalt shifting left to get correct bit
-    return (bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x / 8] << (x % 8)) & 128;
+  if (bitmap_info.bitmap_format == GBitmapFormat1BitPalette) { // for 1bit palette bitmap on Basalt returning 128 for a set bit
+    return PIXEL_GET_1BIT_PALETTE(row, x) << 7;
 #else
-  if (bitmap_info.bitmap_format == GBitmapFormat1Bit) { // for 1 bit bitmap on Aplite - shifting right to get bit
-    return (bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x / 8] >> (x % 8)) & 1;
+  if (bitmap_info.bitmap_format == GBitmapFormat1Bit) { // for 1 bit bitmap on Aplite
+    return PIXEL_GET_1BIT(row, x);
 #endif
   } else {  // othersise (assuming GBitmapFormat8Bit) going byte-wise
-    return bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x]; 
+    return PIXEL_GET_8BIT(row, x); 
   }
   
 }
@@ -52,127 +75,499 @@ uint8_t PalColor(uint8_t in_color, GBitmapFormat in_format, GBitmapFormat out_fo
 }
  
 
-// THE EXTREMELY FAST LINE ALGORITHM Variation E (Addition Fixed Point PreCalc Small Display)
-// Small Display (256x256) resolution.
-// based on algorythm by Po-Han Lin at http://www.edepot.com
-void set_line(BitmapInfo bitmap_info, int y, int x, int y2, int x2, uint8_t draw_color, uint8_t skip_color, uint8_t *visited) {
-  bool yLonger = false;	int shortLen=y2-y; int longLen=x2-x;
-  uint8_t temp_pixel;  int temp_x, temp_y;
-  
-	if (abs(shortLen)>abs(longLen)) {
-		int swap=shortLen;
-		shortLen=longLen;	longLen=swap;	yLonger=true;
-	}
-  
-	int decInc;
-	if (longLen==0) decInc=0;
-	else decInc = (shortLen << 8) / longLen;
-
-	if (yLonger) {
-		if (longLen>0) {
-			longLen+=y;
-			for (int j=0x80+(x<<8);y<=longLen;++y) {
-        temp_y = y; temp_x = j >> 8;
-        if (temp_y >=0 && temp_y<168 && temp_x >=0 && temp_x < 144) {
-          temp_pixel = get_pixel(bitmap_info,  temp_y, temp_x);
-          #ifdef PBL_COLOR // for Basalt drawing pixel if it is not of original color or already drawn color
-            if (temp_pixel != skip_color && temp_pixel != draw_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color);
-          #else
-            if (get_pixel(bitmap_info,  temp_y, temp_x) != 1) { // for Aplite first check if pixel isn't already marked as set in user-defined array
-              if (temp_pixel != skip_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color); // if pixel isn't of original color - set it
-              draw_color = 1 - draw_color; // revers pixel for "lined" effect
-              set_pixel(bitmap_info, temp_y, temp_x, 1); //mark pixel as set
-            }
-          #endif
+// scratch memory shared by effects that need temporary rows/tables, kept between calls and only grown when needed
+// (effects run one after another, so a single buffer is enough)
+void* effect_scratch(size_t size) {
+  static void *scratch = NULL;
+  static size_t scratch_size = 0;
+
+  if (size > scratch_size) {
+    free(scratch);
+    scratch = malloc(size);
+    scratch_size = scratch ? size : 0;
+  }
+  return scratch;
+}
+
+// framebuffer capture shared by a chain of effects (see effect_frame_begin)
+static struct {
+  GContext *ctx; // context of the running chain, NULL outside of one
+  GBitmap *fb; // capture held for the chain, NULL until an effect needs it
+} s_frame;
+
+static uint32_t s_capture_count = 0;
+static uint32_t s_pass_count = 0;
+
+void effect_frame_begin(GContext *ctx) {
+  s_frame.ctx = ctx;
+  s_frame.fb = NULL;
+}
+
+void effect_frame_flush(GContext *ctx) {
+  if (s_frame.ctx == ctx && s_frame.fb) {
+    graphics_release_frame_buffer(ctx, s_frame.fb);
+    s_frame.fb = NULL;
+  }
+}
+
+void effect_frame_end(GContext *ctx) {
+  effect_frame_flush(ctx);
+  s_frame.ctx = NULL;
+}
+
+GBitmap* effect_capture_frame_buffer(GContext *ctx) {
+  if (s_frame.ctx == ctx && s_frame.fb) return s_frame.fb;
+  ++s_capture_count;
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+  if (s_frame.ctx == ctx) s_frame.fb = fb;
+  return fb;
+}
+
+void effect_release_frame_buffer(GContext *ctx, GBitmap *fb) {
+  if (s_frame.ctx != ctx) graphics_release_frame_buffer(ctx, fb);
+}
+
+// effects of this library: they capture with effect_capture_frame_buffer, or flush before drawing
+static bool library_effect(effect_cb *effect) {
+  static effect_cb *const effects[] = {
+    effect_invert, effect_colorize, effect_colorswap, effect_invert_bw_only, effect_invert_brightness,
+    effect_palette_map, effect_fade, effect_blend, effect_run, effect_mirror_vertical, effect_mirror_horizontal,
+    effect_rotate_90_degrees, effect_blur, effect_zoom, effect_lens, effect_mask, effect_fps, effect_shadow,
+    effect_cached, effect_shaped, effect_outline, effect_dither,
+  };
+  for (size_t i = 0; i < sizeof(effects) / sizeof(effects[0]); ++i)
+    if (effects[i] == effect) return true;
+  return false;
+}
+
+void effect_call(effect_cb *effect, GContext *ctx, GRect position, void *param) {
+  if (!library_effect(effect)) effect_frame_flush(ctx);
+  if (effect != effect_cached && effect != effect_run) ++s_pass_count; // those count the effect they call
+  effect(ctx, position, param);
+}
+
+bool effect_clip(GBitmap *fb, GRect *position) {
+  GRect bounds = gbitmap_get_bounds(fb);
+  int x0 = position->origin.x > bounds.origin.x ? position->origin.x : bounds.origin.x;
+  int y0 = position->origin.y > bounds.origin.y ? position->origin.y : bounds.origin.y;
+  int x1 = position->origin.x + position->size.w, y1 = position->origin.y + position->size.h;
+  if (x1 > bounds.origin.x + bounds.size.w) x1 = bounds.origin.x + bounds.size.w;
+  if (y1 > bounds.origin.y + bounds.size.h) y1 = bounds.origin.y + bounds.size.h;
+  if (x1 <= x0 || y1 <= y0) return false;
+  *position = GRect(x0, y0, x1 - x0, y1 - y0);
+  return true;
+}
+
+uint32_t effect_get_capture_count(void) {
+  return s_capture_count;
+}
+
+void effect_reset_capture_count(void) {
+  s_capture_count = 0;
+}
+
+uint32_t effect_get_pass_count(void) {
+  return s_pass_count;
+}
+
+void effect_reset_pass_count(void) {
+  s_pass_count = 0;
+}
+
+#ifdef PBL_COLOR
+// inverts width 8bit pixels starting at row, 4 pixels per word once aligned (alpha bits are kept opaque)
+static void invert_row_8bit(uint8_t *row, int width) {
+  while (width > 0 && ((uintptr_t)row & 3)) { *row = ~*row | 0xC0; ++row; --width; }
+
+  uint32_t *word = (uint32_t*)row;
+  for (; width >= 4; width -= 4, ++word) *word = ~*word | 0xC0C0C0C0;
+
+  row = (uint8_t*)word;
+  while (width-- > 0) { *row = ~*row | 0xC0; ++row; }
+}
+#else
+// transposes an 8x8 bit matrix, byte i = row i, bit j = column j
+static uint64_t transpose8x8(uint64_t x) {
+  uint64_t t;
+  t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;  x ^= t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL; x ^= t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL; x ^= t ^ (t << 28);
+  return x;
+}
+#endif
+
+// saved copies of screen areas (rect inside the framebuffer): rows one after the other, on Aplite the words
+// covering each row so the bits keep their place and restoring leaves the pixels beside rect alone
+static int saved_row_bytes(GRect rect) {
+  #ifdef PBL_COLOR
+    return rect.size.w;
+  #else
+    return (((rect.origin.x & 31) + rect.size.w + 31) >> 5) * 4;
+  #endif
+}
+
+size_t effect_saved_size(GRect rect) {
+  return saved_row_bytes(rect) * rect.size.h;
+}
+
+void effect_save_rect(GBitmap *fb, GRect rect, uint8_t *data) {
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb), count = saved_row_bytes(rect);
+  #ifdef PBL_COLOR
+    const uint8_t *row = gbitmap_get_data(fb) + rect.origin.y * bytes_per_row + rect.origin.x;
+  #else
+    const uint8_t *row = gbitmap_get_data(fb) + rect.origin.y * bytes_per_row + (rect.origin.x >> 5) * 4;
+  #endif
+  for (int y = 0; y < rect.size.h; y++, row += bytes_per_row, data += count) memcpy(data, row, count);
+}
+
+void effect_restore_rect(GBitmap *fb, GRect rect, const uint8_t *data) {
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb), count = saved_row_bytes(rect);
+  #ifdef PBL_COLOR
+    uint8_t *row = gbitmap_get_data(fb) + rect.origin.y * bytes_per_row + rect.origin.x;
+    for (int y = 0; y < rect.size.h; y++, row += bytes_per_row, data += count) memcpy(row, data, count);
+  #else
+    uint8_t *row = gbitmap_get_data(fb) + rect.origin.y * bytes_per_row + (rect.origin.x >> 5) * 4;
+    int x0 = rect.origin.x & 31;
+    for (int y = 0; y < rect.size.h; y++, row += bytes_per_row, data += count) bitplane_blit(row, x0, data, x0, rect.size.w, BitplaneCopy);
+  #endif
+}
+
+// true when pixels [x0, x1) of a row all have color (argb on Basalt, black/white on Aplite)
+static bool row_is_uniform(const uint8_t *row, int x0, int x1, uint8_t color) {
+  #ifdef PBL_COLOR
+    while (x0 < x1 && ((uintptr_t)(row + x0) & 3)) if (row[x0++] != color) return false;
+    uint32_t word = color * 0x01010101u;
+    for (; x0 + 4 <= x1; x0 += 4) if (*(const uint32_t*)(row + x0) != word) return false;
+    while (x0 < x1) if (row[x0++] != color) return false;
+  #else
+    int white = bitplane_count(row, x0, x1);
+    if (white != (gcolor_equal((GColor8){.argb = color}, GColorWhite) ? x1 - x0 : 0)) return false;
+  #endif
+  return true;
+}
+
+uint16_t* effect_tile_summary(const uint8_t *bitmap_data, int bytes_per_row, GRect position, int *cols, int *rows) {
+  static uint16_t *summary = NULL;
+  static int summary_size = 0;
+
+  int tx0 = position.origin.x / EFFECT_TILE, ty0 = position.origin.y / EFFECT_TILE;
+  *cols = (position.origin.x + position.size.w - 1) / EFFECT_TILE - tx0 + 1;
+  *rows = (position.origin.y + position.size.h - 1) / EFFECT_TILE - ty0 + 1;
+  if (*cols * *rows > summary_size) {
+    free(summary);
+    summary = malloc(*cols * *rows * sizeof(uint16_t));
+    summary_size = summary ? *cols * *rows : 0;
+    if (!summary) return NULL;
+  }
+
+  uint16_t *tile = summary;
+  for (int j = 0; j < *rows; j++) {
+    int y0 = (ty0 + j) * EFFECT_TILE, y1 = y0 + EFFECT_TILE;
+    if (y0 < position.origin.y) y0 = position.origin.y;
+    if (y1 > position.origin.y + position.size.h) y1 = position.origin.y + position.size.h;
+    for (int i = 0; i < *cols; i++, tile++) {
+      int x0 = (tx0 + i) * EFFECT_TILE, x1 = x0 + EFFECT_TILE;
+      if (x0 < position.origin.x) x0 = position.origin.x;
+      if (x1 > position.origin.x + position.size.w) x1 = position.origin.x + position.size.w;
+
+      const uint8_t *row = bitmap_data + y0 * bytes_per_row;
+      #ifdef PBL_COLOR
+        uint8_t color = row[x0];
+      #else
+        uint8_t color = bitplane_get(row, x0, 1) ? GColorWhiteARGB8 : GColorBlackARGB8;
+      #endif
+      *tile = color;
+      for (int y = y0; y < y1; y++, row += bytes_per_row) {
+        if (!row_is_uniform(row, x0, x1, color)) {
+          *tile = EFFECT_TILE_MIXED;
+          break;
         }
-				j+=decInc;
-			}
-			return;
-		}
-		longLen+=y;
-		for (int j=0x80+(x<<8);y>=longLen;--y) {
-      temp_y = y; temp_x = j >> 8;
-      if (temp_y >=0 && temp_y<168 && temp_x >=0 && temp_x < 144) {
-        temp_pixel = get_pixel(bitmap_info,  temp_y, temp_x);
-          #ifdef PBL_COLOR // for Basalt drawing pixel if it is not of original color or already drawn color
-            if (temp_pixel != skip_color && temp_pixel != draw_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color);
-          #else
-            if (get_pixel(bitmap_info,  temp_y, temp_x) != 1) { // for Aplite first check if pixel isn't already marked as set in user-defined array
-              if (temp_pixel != skip_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color); // if pixel isn't of original color - set it
-              draw_color = 1 - draw_color; // revers pixel for "lined" effect
-              set_pixel(bitmap_info, temp_y, temp_x, 1); //mark pixel as set
-            }
-          #endif
       }
-			j-=decInc;
-		}
-		return;	
-	}
-
-	if (longLen>0) {
-		longLen+=x;
-		for (int j=0x80+(y<<8);x<=longLen;++x) {
-      temp_y = j >> 8; temp_x =  x;
-      if (temp_y >=0 && temp_y<168 && temp_x >=0 && temp_x < 144) {
-        temp_pixel = get_pixel(bitmap_info, temp_y, temp_x);
-          #ifdef PBL_COLOR // for Basalt drawing pixel if it is not of original color or already drawn color
-            if (temp_pixel != skip_color && temp_pixel != draw_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color);
-          #else
-            if (get_pixel(bitmap_info,  temp_y, temp_x) != 1) { // for Aplite first check if pixel isn't already marked as set in user-defined array
-              if (temp_pixel != skip_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color); // if pixel isn't of original color - set it
-              draw_color = 1 - draw_color; // revers pixel for "lined" effect
-              set_pixel(bitmap_info, temp_y, temp_x, 1); //mark pixel as set
-            }
-          #endif
-      }  
-			j+=decInc;
-		}
-		return;
-	}
-	longLen+=x;
-	for (int j=0x80+(y<<8);x>=longLen;--x) {
-	  temp_y = j >> 8; temp_x =  x;
-    if (temp_y >=0 && temp_y<168 && temp_x >=0 && temp_x < 144) {
-      temp_pixel = get_pixel(bitmap_info, temp_y, temp_x);
-          #ifdef PBL_COLOR // for Basalt drawing pixel if it is not of original color or already drawn color
-            if (temp_pixel != skip_color && temp_pixel != draw_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color);
-          #else
-            if (get_pixel(bitmap_info,  temp_y, temp_x) != 1) { // for Aplite first check if pixel isn't already marked as set in user-defined array
-              if (temp_pixel != skip_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color); // if pixel isn't of original color - set it
-              draw_color = 1 - draw_color; // revers pixel for "lined" effect
-              set_pixel(bitmap_info, temp_y, temp_x, 1); //mark pixel as set
-            }
-          #endif
-    }  
-		j-=decInc;
-	}
+    }
+  }
+  return summary;
+}
+
+// tile counters of the effects that use tile summaries
+static struct {
+  effect_cb *effect;
+  EffectTileStats stats;
+} s_tile_stats[8];
 
+void effect_count_tiles(effect_cb *effect, uint32_t tiles, uint32_t skipped) {
+  for (unsigned i = 0; i < sizeof(s_tile_stats) / sizeof(s_tile_stats[0]); i++) {
+    if (s_tile_stats[i].effect == effect || !s_tile_stats[i].effect) {
+      s_tile_stats[i].effect = effect;
+      s_tile_stats[i].stats.tiles += tiles;
+      s_tile_stats[i].stats.skipped += skipped;
+      return;
+    }
+  }
+}
+
+void effect_get_tile_stats(effect_cb *effect, EffectTileStats *stats) {
+  stats->tiles = stats->skipped = 0;
+  for (unsigned i = 0; i < sizeof(s_tile_stats) / sizeof(s_tile_stats[0]); i++)
+    if (s_tile_stats[i].effect == effect) *stats = s_tile_stats[i].stats;
+}
+
+void effect_reset_tile_stats(void) {
+  memset(s_tile_stats, 0, sizeof(s_tile_stats));
 }
 
 //  ********* Graphics utility functions (probablu should be seaparated into anothe file?) ********* }
 
-  
+
 
 // inverter effect.
 void effect_invert(GContext* ctx,  GRect position, void* param) {
+  if (position.size.w <= 0 || position.size.h <= 0) return;
+
   //capturing framebuffer bitmap
-  GBitmap *fb = graphics_capture_frame_buffer(ctx);
-  
-  BitmapInfo bitmap_info;
-  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
-  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
-  bitmap_info.bitmap_format = gbitmap_get_format(fb);
-  
-  for (int y = 0; y < position.size.h; y++)
-     for (int x = 0; x < position.size.w; x++)
-        #ifdef PBL_COLOR // on Basalt simple doing NOT on entire returned byte/pixel
-          set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, (~get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x))|11000000);
-        #else // on Aplite since only 1 and 0 is returning, doing "not" by 1 - pixel
-          set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, 1 - get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x));
-        #endif
- 
-  graphics_release_frame_buffer(ctx, fb);          
-          
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  if (!effect_clip(fb, &position)) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+
+  uint8_t *row = gbitmap_get_data(fb);
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb);
+
+  #ifdef PBL_COLOR // on Basalt doing NOT on 4 bytes/pixels at a time
+    row += position.origin.y * bytes_per_row + position.origin.x;
+    for (int y = 0; y < position.size.h; y++, row += bytes_per_row)
+      invert_row_8bit(row, position.size.w);
+  #else // on Aplite XOR-ing 32 pixels at a time
+    bitplane_apply_rect(row, bytes_per_row, position, 1, 1);
+  #endif
+
+  effect_release_frame_buffer(ctx, fb);
+
+}
+
+// on Aplite the framebuffer only keeps black and white between two effects, so before another effect is
+// appended the entries become what the pixels read back as (anything but white is black, see effect_palette_map)
+static void palette_snap(EffectPalette *palette) {
+#ifndef PBL_COLOR
+  for (int i = 0; i < 256; i++) palette->lut[i] = palette->lut[i] == GColorWhiteARGB8 ? GColorWhiteARGB8 : GColorBlackARGB8;
+#endif
+}
+
+// builds identity palette (every color maps to itself)
+void effect_palette_init(EffectPalette *palette) {
+  for (int i = 0; i < 256; i++) palette->lut[i] = i;
+}
+
+// appends another palette: result maps color to next->lut[palette->lut[color]]
+void effect_palette_compose(EffectPalette *palette, const EffectPalette *next) {
+  palette_snap(palette);
+  for (int i = 0; i < 256; i++) palette->lut[i] = next->lut[palette->lut[i]];
+}
+
+// appends effect_invert (keeps colors opaque like the framebuffer version)
+void effect_palette_add_invert(EffectPalette *palette) {
+  palette_snap(palette);
+  for (int i = 0; i < 256; i++) palette->lut[i] = ~palette->lut[i] | 0xC0;
+}
+
+// appends effect_colorize
+void effect_palette_add_colorize(EffectPalette *palette, EffectColorpair *paint) {
+  palette_snap(palette);
+  for (int i = 0; i < 256; i++)
+    if (gcolor_equal((GColor8){.argb = palette->lut[i]}, paint->firstColor)) palette->lut[i] = paint->secondColor.argb;
+}
+
+// appends effect_colorswap
+void effect_palette_add_colorswap(EffectPalette *palette, EffectColorpair *swap) {
+  palette_snap(palette);
+  for (int i = 0; i < 256; i++) {
+    GColor8 color = {.argb = palette->lut[i]};
+    if (gcolor_equal(color, swap->firstColor))
+      palette->lut[i] = swap->secondColor.argb;
+    else if (gcolor_equal(color, swap->secondColor))
+      palette->lut[i] = swap->firstColor.argb;
+  }
+}
+
+// appends effect_invert_bw_only
+void effect_palette_add_invert_bw_only(EffectPalette *palette) {
+  EffectColorpair bw = {GColorBlack, GColorWhite};
+  effect_palette_add_colorswap(palette, &bw);
+}
+
+// Color spread is not even, so need to handcraft the opposing brightness of colors,
+// which is probably subjective and open for improvement. Indexed by the rgb bits of an opaque color
+static const uint8_t s_invert_brightness[64] = {
+  [GColorOxfordBlueARGB8 & 0x3F] = GColorCelesteARGB8,
+  [GColorDukeBlueARGB8 & 0x3F] = GColorVividCeruleanARGB8,
+  [GColorBlueARGB8 & 0x3F] = GColorPictonBlueARGB8,
+  [GColorDarkGreenARGB8 & 0x3F] = GColorMintGreenARGB8,
+  [GColorMidnightGreenARGB8 & 0x3F] = GColorMediumSpringGreenARGB8,
+  [GColorCobaltBlueARGB8 & 0x3F] = GColorCyanARGB8,
+  [GColorBlueMoonARGB8 & 0x3F] = GColorElectricBlueARGB8,
+  [GColorIslamicGreenARGB8 & 0x3F] = GColorMalachiteARGB8,
+  [GColorJaegerGreenARGB8 & 0x3F] = GColorScreaminGreenARGB8,
+  [GColorTiffanyBlueARGB8 & 0x3F] = GColorCadetBlueARGB8,
+  [GColorVividCeruleanARGB8 & 0x3F] = GColorDukeBlueARGB8,
+  [GColorGreenARGB8 & 0x3F] = GColorMayGreenARGB8,
+  [GColorMalachiteARGB8 & 0x3F] = GColorIslamicGreenARGB8,
+  [GColorMediumSpringGreenARGB8 & 0x3F] = GColorMidnightGreenARGB8,
+  [GColorCyanARGB8 & 0x3F] = GColorCobaltBlueARGB8,
+  [GColorBulgarianRoseARGB8 & 0x3F] = GColorMelonARGB8,
+  [GColorImperialPurpleARGB8 & 0x3F] = GColorRichBrilliantLavenderARGB8,
+  [GColorIndigoARGB8 & 0x3F] = GColorLavenderIndigoARGB8,
+  [GColorElectricUltramarineARGB8 & 0x3F] = GColorVeryLightBlueARGB8,
+  [GColorArmyGreenARGB8 & 0x3F] = GColorBrassARGB8,
+  [GColorDarkGrayARGB8 & 0x3F] = GColorLightGrayARGB8,
+  [GColorLibertyARGB8 & 0x3F] = GColorBabyBlueEyesARGB8,
+  [GColorVeryLightBlueARGB8 & 0x3F] = GColorElectricUltramarineARGB8,
+  [GColorKellyGreenARGB8 & 0x3F] = GColorGreenARGB8,
+  [GColorMayGreenARGB8 & 0x3F] = GColorMediumAquamarineARGB8,
+  [GColorCadetBlueARGB8 & 0x3F] = GColorTiffanyBlueARGB8,
+  [GColorPictonBlueARGB8 & 0x3F] = GColorBlueARGB8,
+  [GColorBrightGreenARGB8 & 0x3F] = GColorIslamicGreenARGB8,
+  [GColorScreaminGreenARGB8 & 0x3F] = GColorKellyGreenARGB8,
+  [GColorMediumAquamarineARGB8 & 0x3F] = GColorMayGreenARGB8,
+  [GColorElectricBlueARGB8 & 0x3F] = GColorBlueMoonARGB8,
+  [GColorDarkCandyAppleRedARGB8 & 0x3F] = GColorMelonARGB8,
+  [GColorJazzberryJamARGB8 & 0x3F] = GColorBrilliantRoseARGB8,
+  [GColorPurpleARGB8 & 0x3F] = GColorShockingPinkARGB8,
+  [GColorVividVioletARGB8 & 0x3F] = GColorPurpureusARGB8,
+  [GColorWindsorTanARGB8 & 0x3F] = GColorRoseValeARGB8,
+  [GColorRoseValeARGB8 & 0x3F] = GColorWindsorTanARGB8,
+  [GColorPurpureusARGB8 & 0x3F] = GColorVividVioletARGB8,
+  [GColorLavenderIndigoARGB8 & 0x3F] = GColorIndigoARGB8,
+  [GColorLimerickARGB8 & 0x3F] = GColorPastelYellowARGB8,
+  [GColorBrassARGB8 & 0x3F] = GColorArmyGreenARGB8,
+  [GColorLightGrayARGB8 & 0x3F] = GColorDarkGrayARGB8,
+  [GColorBabyBlueEyesARGB8 & 0x3F] = GColorLibertyARGB8,
+  [GColorSpringBudARGB8 & 0x3F] = GColorDarkGreenARGB8,
+  [GColorInchwormARGB8 & 0x3F] = GColorMidnightGreenARGB8,
+  [GColorMintGreenARGB8 & 0x3F] = GColorDarkGreenARGB8,
+  [GColorCelesteARGB8 & 0x3F] = GColorOxfordBlueARGB8,
+  [GColorRedARGB8 & 0x3F] = GColorSunsetOrangeARGB8,
+  [GColorFollyARGB8 & 0x3F] = GColorMelonARGB8,
+  [GColorFashionMagentaARGB8 & 0x3F] = GColorMagentaARGB8,
+  [GColorMagentaARGB8 & 0x3F] = GColorFashionMagentaARGB8,
+  [GColorOrangeARGB8 & 0x3F] = GColorRajahARGB8,
+  [GColorSunsetOrangeARGB8 & 0x3F] = GColorRedARGB8,
+  [GColorBrilliantRoseARGB8 & 0x3F] = GColorJazzberryJamARGB8,
+  [GColorShockingPinkARGB8 & 0x3F] = GColorPurpleARGB8,
+  [GColorChromeYellowARGB8 & 0x3F] = GColorWindsorTanARGB8,
+  [GColorRajahARGB8 & 0x3F] = GColorOrangeARGB8,
+  [GColorMelonARGB8 & 0x3F] = GColorDarkCandyAppleRedARGB8,
+  [GColorRichBrilliantLavenderARGB8 & 0x3F] = GColorImperialPurpleARGB8,
+  [GColorYellowARGB8 & 0x3F] = GColorChromeYellowARGB8,
+  [GColorIcterineARGB8 & 0x3F] = GColorChromeYellowARGB8,
+  [GColorPastelYellowARGB8 & 0x3F] = GColorChromeYellowARGB8
+};
+
+// appends effect_invert_brightness (only opaque colors other than black and white are changed)
+void effect_palette_add_invert_brightness(EffectPalette *palette) {
+  palette_snap(palette);
+  for (int i = 0; i < 256; i++) {
+    uint8_t color = palette->lut[i];
+    if ((color & 0xC0) == 0xC0 && s_invert_brightness[color & 0x3F]) palette->lut[i] = s_invert_brightness[color & 0x3F];
+  }
+}
+
+// appends a pixel-local effect to the palette, returns false for effects that can't be expressed as one
+// (colorize, colorswap and invert_brightness only do something on Basalt, so on Aplite they add nothing)
+bool effect_palette_add_effect(EffectPalette *palette, effect_cb *effect, void *param) {
+  if (effect == effect_invert) {
+    effect_palette_add_invert(palette);
+  } else if (effect == effect_invert_bw_only) {
+    effect_palette_add_invert_bw_only(palette);
+  } else if (effect == effect_palette_map) {
+    effect_palette_compose(palette, (EffectPalette *)param);
+  } else if (effect == effect_colorize || effect == effect_colorswap || effect == effect_invert_brightness) {
+    #ifdef PBL_COLOR
+      if (effect == effect_colorize) effect_palette_add_colorize(palette, (EffectColorpair *)param);
+      else if (effect == effect_colorswap) effect_palette_add_colorswap(palette, (EffectColorpair *)param);
+      else effect_palette_add_invert_brightness(palette);
+    #endif
+  } else if (effect == effect_fade) {
+    effect_palette_add_fade(palette, (EffectFade *)param);
+  } else if (effect == effect_blend && !((EffectBlend *)param)->bitmap) {
+    EffectBlend *blend = (EffectBlend *)param;
+    effect_palette_add_fade(palette, &(EffectFade){ .color = blend->color, .level = effect_blend_weight(blend) });
+  } else if (effect == effect_run && ((EffectInstance *)param)->type->palette) {
+    EffectInstance *instance = (EffectInstance *)param;
+    if (!effect_instance_prepare(instance, GRect(0, 0, 0, 0))) return false;
+    effect_palette_compose(palette, (EffectPalette *)instance->state);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// margin of neighbouring pixels an effect reads around the pixels it changes (see effect_halo in effects.h)
+int16_t effect_halo(effect_cb *effect, void *param) {
+  if (effect == effect_invert || effect == effect_invert_bw_only || effect == effect_palette_map ||
+      effect == effect_colorize || effect == effect_colorswap || effect == effect_invert_brightness ||
+      effect == effect_fade) {
+    return 0;
+  } else if (effect == effect_blend) { // a bitmap overlay is anchored at the rect origin
+    return ((EffectBlend *)param)->bitmap ? EFFECT_HALO_FRAME : 0;
+  } else if (effect == effect_blur) {
+    uint8_t passes = (uint32_t)param >> 8 & 0xFF;
+    return ((uint32_t)param & 0xFF) * (passes ? passes : 1);
+  } else if (effect == effect_outline || effect == effect_shadow) {
+    // a cascade (see offset_cascade) carries on from pixel to pixel, as far as the rect goes
+    EffectOffset *offset = (EffectOffset *)param;
+    bool cascade = gcolor_equal(offset->orig_color, offset->offset_color) &&
+                   (effect == effect_shadow || (offset->option != 4 && offset->option != 8));
+    #ifndef PBL_COLOR
+      cascade |= effect == effect_shadow && offset->option == 1;
+    #endif
+    if (cascade) return EFFECT_HALO_FRAME;
+    return abs(offset->offset_x) > abs(offset->offset_y) ? abs(offset->offset_x) : abs(offset->offset_y);
+  } else if (effect == effect_dither) {
+    // data is anchored at the rect origin and diffusion depends on the whole rect; the Bayer phase follows
+    // screen coordinates, so only an even gray with an ordered method can be narrowed
+    EffectDither *dither = (EffectDither *)param;
+    return dither->data || dither->method == DitherDiffusion ? EFFECT_HALO_FRAME : 0;
+  } else if (effect == effect_cached) {
+    return effect_halo(((EffectCached *)param)->effect, ((EffectCached *)param)->param);
+  } else if (effect == effect_run) {
+    EffectInstance *instance = (EffectInstance *)param;
+    return instance->type->halo ? instance->type->halo(instance->param) : EFFECT_HALO_FRAME;
+  }
+  return EFFECT_HALO_FRAME; // mirrors, rotation, zoom, lens, mask, fps and unknown effects depend on the whole rect
+}
+
+// palette map effect: one table lookup per pixel
+// on Aplite only the mapping of black and white matters, so rows are cleared, set or inverted a word at a time
+void effect_palette_map(GContext* ctx, GRect position, void* param) {
+  EffectPalette *palette = (EffectPalette *)param;
+  if (position.size.w <= 0 || position.size.h <= 0) return;
+
+#ifndef PBL_COLOR
+  uint8_t black = gcolor_equal((GColor8){.argb = palette->lut[GColorBlack.argb]}, GColorWhite)? 1 : 0;
+  uint8_t white = gcolor_equal((GColor8){.argb = palette->lut[GColorWhite.argb]}, GColorWhite)? 1 : 0;
+  if (black == 0 && white == 1) return; // identity
+#endif
+
+  //capturing framebuffer bitmap
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  if (!effect_clip(fb, &position)) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+
+  uint8_t *row = gbitmap_get_data(fb);
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb);
+
+  #ifdef PBL_COLOR
+    row += position.origin.y * bytes_per_row + position.origin.x;
+    for (int y = 0; y < position.size.h; y++, row += bytes_per_row)
+      for (int x = 0; x < position.size.w; x++)
+        row[x] = palette->lut[row[x]];
+  #else // new pixel = (pixel & (black ^ white)) ^ black
+    bitplane_apply_rect(row, bytes_per_row, position, black ^ white, black);
+  #endif
+
+  effect_release_frame_buffer(ctx, fb);
 }
 
 // colorize effect - given a target color, replace it with a new color
@@ -180,24 +575,10 @@ void effect_invert(GContext* ctx,  GRect position, void* param) {
 // Parameter:  GColor firstColor, GColor secondColor
 void effect_colorize(GContext* ctx,  GRect position, void* param) {
 #ifdef PBL_COLOR // only logical to do anything on Basalt - otherwise you're just ... drawing a black|white GRect
-  //capturing framebuffer bitmap
-  GBitmap *fb = graphics_capture_frame_buffer(ctx);
-  
-  BitmapInfo bitmap_info;
-  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
-  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
-  bitmap_info.bitmap_format = gbitmap_get_format(fb);
-  
-  EffectColorpair *paint = (EffectColorpair *)param;
-
-  for (int y = 0; y < position.size.h; y++){
-     for (int x = 0; x < position.size.w; x++){
-        if (gcolor_equal((GColor)get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x), paint->firstColor)){
-           set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, (uint8_t)paint->secondColor.argb);
-        }
-     }
-  graphics_release_frame_buffer(ctx, fb);
-  }
+  EffectPalette palette;
+  effect_palette_init(&palette);
+  effect_palette_add_colorize(&palette, (EffectColorpair *)param);
+  effect_palette_map(ctx, position, &palette);
 #endif
 }
 
@@ -207,388 +588,761 @@ void effect_colorize(GContext* ctx,  GRect position, void* param) {
 // Parameter:  GColor firstColor, GColor secondColor
 void effect_colorswap(GContext* ctx,  GRect position, void* param) {
 #ifdef PBL_COLOR // only logical to do anything on Basalt - otherwise you're just ... doing an invert
-  //capturing framebuffer bitmap
-  GBitmap *fb = graphics_capture_frame_buffer(ctx);
- 
-  BitmapInfo bitmap_info;
-  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
-  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
-  bitmap_info.bitmap_format = gbitmap_get_format(fb);
-  
-  EffectColorpair *swap = (EffectColorpair *)param;
-  GColor pixel;
-
-  for (int y = 0; y < position.size.h; y++){
-     for (int x = 0; x < position.size.w; x++){
-          pixel.argb = get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x);
-          if (gcolor_equal(pixel, swap->firstColor))
-            set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, swap->secondColor.argb);
-          else if (gcolor_equal(pixel, swap->secondColor))
-            set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, swap->firstColor.argb);
-     }
-  graphics_release_frame_buffer(ctx, fb);
-  }
+  EffectPalette palette;
+  effect_palette_init(&palette);
+  effect_palette_add_colorswap(&palette, (EffectColorpair *)param);
+  effect_palette_map(ctx, position, &palette);
 #endif
 }
 
 // invert black and white only (leaves all other colors intact).
 void effect_invert_bw_only(GContext* ctx,  GRect position, void* param) {
-  //capturing framebuffer bitmap
-  GBitmap *fb = graphics_capture_frame_buffer(ctx);
-  
-  BitmapInfo bitmap_info;
-  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
-  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
-  bitmap_info.bitmap_format = gbitmap_get_format(fb);
-
-#ifdef PBL_COLOR
-  GColor pixel;
-#endif
-  
-  for (int y = 0; y < position.size.h; y++) {
-     for (int x = 0; x < position.size.w; x++) {
-        #ifdef PBL_COLOR // on Basalt invert only black or white
-          pixel.argb = get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x);
-          if (gcolor_equal(pixel, GColorBlack))
-            set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, GColorWhite.argb);
-          else if (gcolor_equal(pixel, GColorWhite))
-            set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, GColorBlack.argb);
-        #else // on Aplite since only 1 and 0 is returning, doing "not" by 1 - pixel
-          set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, 1 - get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x));
-        #endif
-     }
-  }
- 
-  graphics_release_frame_buffer(ctx, fb);          
-          
+  EffectPalette palette;
+  effect_palette_init(&palette);
+  effect_palette_add_invert_bw_only(&palette);
+  effect_palette_map(ctx, position, &palette);
 }
 
 // invert brightness of colors (leaves hue more or less intact and does not apply to black and white).
 void effect_invert_brightness(GContext* ctx,  GRect position, void* param) {
 #ifdef PBL_COLOR
-  //capturing framebuffer bitmap
-  GBitmap *fb = graphics_capture_frame_buffer(ctx);
- 
-  BitmapInfo bitmap_info;
-  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
-  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
-  bitmap_info.bitmap_format = gbitmap_get_format(fb);
-
-  GColor pixel;
-  GColor pixel_new;
-  
-  for (int y = 0; y < position.size.h; y++) {
-     for (int x = 0; x < position.size.w; x++) {
-         pixel.argb = get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x);
-         
-         if (!gcolor_equal(pixel, GColorBlack) && !gcolor_equal(pixel, GColorWhite)) {
-           // Only apply if not black/white (add effect_invert_bw_only for that too)
-           
-           // Color spread is not even, so need to handcraft the opposing brightness of colors,
-           // which is probably subjective and open for improvement
-           if (gcolor_equal(pixel, GColorOxfordBlue))
-             pixel_new = GColorCeleste;
-           else if (gcolor_equal(pixel, GColorDukeBlue))
-             pixel_new = GColorVividCerulean;
-           else if (gcolor_equal(pixel, GColorBlue))
-             pixel_new = GColorPictonBlue;
-           else if (gcolor_equal(pixel, GColorDarkGreen))
-             pixel_new = GColorMintGreen;
-           else if (gcolor_equal(pixel, GColorMidnightGreen))
-             pixel_new = GColorMediumSpringGreen;
-           else if (gcolor_equal(pixel, GColorCobaltBlue))
-             pixel_new = GColorCyan;
-           else if (gcolor_equal(pixel, GColorBlueMoon))
-             pixel_new = GColorElectricBlue;
-           else if (gcolor_equal(pixel, GColorIslamicGreen))
-             pixel_new = GColorMalachite;
-           else if (gcolor_equal(pixel, GColorJaegerGreen))
-             pixel_new = GColorScreaminGreen;
-           else if (gcolor_equal(pixel, GColorTiffanyBlue))
-             pixel_new = GColorCadetBlue;
-           else if (gcolor_equal(pixel, GColorVividCerulean))
-             pixel_new = GColorDukeBlue;
-           else if (gcolor_equal(pixel, GColorGreen))
-             pixel_new = GColorMayGreen;
-           else if (gcolor_equal(pixel, GColorMalachite))
-             pixel_new = GColorIslamicGreen;
-           else if (gcolor_equal(pixel, GColorMediumSpringGreen))
-             pixel_new = GColorMidnightGreen;
-           else if (gcolor_equal(pixel, GColorCyan))
-             pixel_new = GColorCobaltBlue;
-           else if (gcolor_equal(pixel, GColorBulgarianRose))
-             pixel_new = GColorMelon;
-           else if (gcolor_equal(pixel, GColorImperialPurple))
-             pixel_new = GColorRichBrilliantLavender;
-           else if (gcolor_equal(pixel, GColorIndigo))
-             pixel_new = GColorLavenderIndigo;
-           else if (gcolor_equal(pixel, GColorElectricUltramarine))
-             pixel_new = GColorVeryLightBlue;
-           else if (gcolor_equal(pixel, GColorArmyGreen))
-             pixel_new = GColorBrass;
-           else if (gcolor_equal(pixel, GColorDarkGray))
-             pixel_new = GColorLightGray;
-           else if (gcolor_equal(pixel, GColorLiberty))
-             pixel_new = GColorBabyBlueEyes;
-           else if (gcolor_equal(pixel, GColorVeryLightBlue))
-             pixel_new = GColorElectricUltramarine;
-           else if (gcolor_equal(pixel, GColorKellyGreen))
-             pixel_new = GColorGreen;
-           else if (gcolor_equal(pixel, GColorMayGreen))
-             pixel_new = GColorMediumAquamarine;
-           else if (gcolor_equal(pixel, GColorCadetBlue))
-             pixel_new = GColorTiffanyBlue;
-           else if (gcolor_equal(pixel, GColorPictonBlue))
-             pixel_new = GColorBlue;
-           else if (gcolor_equal(pixel, GColorBrightGreen))
-             pixel_new = GColorIslamicGreen;
-           else if (gcolor_equal(pixel, GColorScreaminGreen))
-             pixel_new = GColorKellyGreen;
-           else if (gcolor_equal(pixel, GColorMediumAquamarine))
-             pixel_new = GColorMayGreen;
-           else if (gcolor_equal(pixel, GColorElectricBlue))
-             pixel_new = GColorBlueMoon;
-           else if (gcolor_equal(pixel, GColorDarkCandyAppleRed))
-             pixel_new = GColorMelon;
-           else if (gcolor_equal(pixel, GColorJazzberryJam))
-             pixel_new = GColorBrilliantRose;
-           else if (gcolor_equal(pixel, GColorPurple))
-             pixel_new = GColorShockingPink;
-           else if (gcolor_equal(pixel, GColorVividViolet))
-             pixel_new = GColorPurpureus;
-           else if (gcolor_equal(pixel, GColorWindsorTan))
-             pixel_new = GColorRoseVale;
-           else if (gcolor_equal(pixel, GColorRoseVale))
-             pixel_new = GColorWindsorTan;
-           else if (gcolor_equal(pixel, GColorPurpureus))
-             pixel_new = GColorVividViolet;
-           else if (gcolor_equal(pixel, GColorLavenderIndigo))
-             pixel_new = GColorIndigo;
-           else if (gcolor_equal(pixel, GColorLimerick))
-             pixel_new = GColorPastelYellow;
-           else if (gcolor_equal(pixel, GColorBrass))
-             pixel_new = GColorArmyGreen;
-           else if (gcolor_equal(pixel, GColorLightGray))
-             pixel_new = GColorDarkGray;
-           else if (gcolor_equal(pixel, GColorBabyBlueEyes))
-             pixel_new = GColorLiberty;
-           else if (gcolor_equal(pixel, GColorSpringBud))
-             pixel_new = GColorDarkGreen;
-           else if (gcolor_equal(pixel, GColorInchworm))
-             pixel_new = GColorMidnightGreen;
-           else if (gcolor_equal(pixel, GColorMintGreen))
-             pixel_new = GColorDarkGreen;
-           else if (gcolor_equal(pixel, GColorCeleste))
-             pixel_new = GColorOxfordBlue;
-           else if (gcolor_equal(pixel, GColorRed))
-             pixel_new = GColorSunsetOrange;
-           else if (gcolor_equal(pixel, GColorFolly))
-             pixel_new = GColorMelon;
-           else if (gcolor_equal(pixel, GColorFashionMagenta))
-             pixel_new = GColorMagenta ;
-           else if (gcolor_equal(pixel, GColorMagenta))
-             pixel_new = GColorFashionMagenta;
-           else if (gcolor_equal(pixel, GColorOrange))
-             pixel_new = GColorRajah;
-           else if (gcolor_equal(pixel, GColorSunsetOrange))
-             pixel_new = GColorRed;
-           else if (gcolor_equal(pixel, GColorBrilliantRose))
-             pixel_new = GColorJazzberryJam;
-           else if (gcolor_equal(pixel, GColorShockingPink))
-             pixel_new = GColorPurple;
-           else if (gcolor_equal(pixel, GColorChromeYellow))
-             pixel_new = GColorWindsorTan;
-           else if (gcolor_equal(pixel, GColorRajah))
-             pixel_new = GColorOrange;
-           else if (gcolor_equal(pixel, GColorMelon))
-             pixel_new = GColorDarkCandyAppleRed;
-           else if (gcolor_equal(pixel, GColorRichBrilliantLavender))
-             pixel_new = GColorImperialPurple;
-           else if (gcolor_equal(pixel, GColorYellow))
-             pixel_new = GColorChromeYellow;
-           else if (gcolor_equal(pixel, GColorIcterine))
-             pixel_new = GColorChromeYellow;
-           else if (gcolor_equal(pixel, GColorPastelYellow))
-             pixel_new = GColorChromeYellow;
-           
-           set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, pixel_new.argb);
-         }
-     }
-  }
- 
-  graphics_release_frame_buffer(ctx, fb);          
-          
+  EffectPalette palette;
+  effect_palette_init(&palette);
+  effect_palette_add_invert_brightness(&palette);
+  effect_palette_map(ctx, position, &palette);
 #endif
 }
 
+// colour effect types: prepare builds the palette once, each frame is a single palette_map pass
+// (on Aplite these effects do nothing, like their effect_cb versions, so the palette stays the identity)
+static bool colorize_type_prepare(void *state, const void *param, GRect position) {
+  effect_palette_init((EffectPalette *)state);
+  #ifdef PBL_COLOR
+    effect_palette_add_colorize((EffectPalette *)state, (EffectColorpair *)param);
+  #endif
+  return true;
+}
+
+static bool colorswap_type_prepare(void *state, const void *param, GRect position) {
+  effect_palette_init((EffectPalette *)state);
+  #ifdef PBL_COLOR
+    effect_palette_add_colorswap((EffectPalette *)state, (EffectColorpair *)param);
+  #endif
+  return true;
+}
+
+static bool invert_brightness_type_prepare(void *state, const void *param, GRect position) {
+  effect_palette_init((EffectPalette *)state);
+  #ifdef PBL_COLOR
+    effect_palette_add_invert_brightness((EffectPalette *)state);
+  #endif
+  return true;
+}
+
+static void palette_type_apply(GContext *ctx, GRect position, const void *param, void *state) {
+  effect_palette_map(ctx, position, state);
+}
+
+static int16_t palette_type_halo(const void *param) {
+  return 0;
+}
+
+const EffectType effect_type_colorize = {
+  .param_size = sizeof(EffectColorpair),
+  .state_size = sizeof(EffectPalette),
+  .palette = true,
+  .prepare = colorize_type_prepare,
+  .apply = palette_type_apply,
+  .halo = palette_type_halo,
+};
+
+const EffectType effect_type_colorswap = {
+  .param_size = sizeof(EffectColorpair),
+  .state_size = sizeof(EffectPalette),
+  .palette = true,
+  .prepare = colorswap_type_prepare,
+  .apply = palette_type_apply,
+  .halo = palette_type_halo,
+};
+
+const EffectType effect_type_invert_brightness = {
+  .state_size = sizeof(EffectPalette),
+  .palette = true,
+  .prepare = invert_brightness_type_prepare,
+  .apply = palette_type_apply,
+  .halo = palette_type_halo,
+};
+
 // vertical mirror effect.
+// swaps whole rows: memcpy on Basalt, masked byte copies on Aplite
 void effect_mirror_vertical(GContext* ctx, GRect position, void* param) {
-  uint8_t temp_pixel;  
-  
+  if (position.size.w <= 0 || position.size.h <= 1) return;
+
   //capturing framebuffer bitmap
-  GBitmap *fb = graphics_capture_frame_buffer(ctx);
-  
-  BitmapInfo bitmap_info;
-  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
-  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
-  bitmap_info.bitmap_format = gbitmap_get_format(fb);
-
-  for (int y = 0; y < position.size.h / 2 ; y++)
-     for (int x = 0; x < position.size.w; x++){
-        temp_pixel = get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x);
-        set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, get_pixel(bitmap_info, position.origin.y + position.size.h - y - 2, x + position.origin.x));
-        set_pixel(bitmap_info, position.origin.y + position.size.h - y - 2, x + position.origin.x, temp_pixel);
-     }
-  
-  graphics_release_frame_buffer(ctx, fb);
-}
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  if (!effect_clip(fb, &position)) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  uint8_t *bitmap_data = gbitmap_get_data(fb);
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb);
 
+  uint8_t *top = bitmap_data + position.origin.y * bytes_per_row;
+  uint8_t *bottom = top + (position.size.h - 1) * bytes_per_row;
+  #ifdef PBL_COLOR
+    uint8_t *temp_row = effect_scratch(bytes_per_row);
+    if (temp_row) {
+      for (; top < bottom; top += bytes_per_row, bottom -= bytes_per_row) {
+        memcpy(temp_row, top + position.origin.x, position.size.w);
+        memcpy(top + position.origin.x, bottom + position.origin.x, position.size.w);
+        memcpy(bottom + position.origin.x, temp_row, position.size.w);
+      }
+    }
+  #else // rows swapped 32 pixels at a time, no temp row needed
+    for (; top < bottom; top += bytes_per_row, bottom -= bytes_per_row)
+      bitplane_swap(top, bottom, position.origin.x, position.origin.x + position.size.w);
+  #endif
+
+  effect_release_frame_buffer(ctx, fb);
+}
 
 // horizontal mirror effect.
+// reverses each row: bytes 4 at a time on Basalt, 32 pixels at a time (bit reversed words) on Aplite
 void effect_mirror_horizontal(GContext* ctx, GRect position, void* param) {
-  uint8_t temp_pixel;  
-  
+  if (position.size.w <= 1 || position.size.h <= 0) return;
+
   //capturing framebuffer bitmap
-  GBitmap *fb = graphics_capture_frame_buffer(ctx);
-  
-  BitmapInfo bitmap_info;
-  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
-  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
-  bitmap_info.bitmap_format = gbitmap_get_format(fb);
-
-  for (int y = 0; y < position.size.h; y++)
-     for (int x = 0; x < position.size.w / 2; x++){
-        temp_pixel = get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x);
-        set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, get_pixel(bitmap_info, y + position.origin.y, position.origin.x + position.size.w - x - 2));
-        set_pixel(bitmap_info, y + position.origin.y, position.origin.x + position.size.w - x - 2, temp_pixel);
-     }
-  
-  graphics_release_frame_buffer(ctx, fb);
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  if (!effect_clip(fb, &position)) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  uint8_t *row = gbitmap_get_data(fb) + position.origin.y * gbitmap_get_bytes_per_row(fb);
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb);
+
+  #ifdef PBL_COLOR
+    for (int y = 0; y < position.size.h; y++, row += bytes_per_row) {
+      uint8_t *left = row + position.origin.x, *right = left + position.size.w - 1;
+      for (; right - left >= 7; left += 4, right -= 4) {
+        uint32_t a, b;
+        memcpy(&a, left, 4);
+        memcpy(&b, right - 3, 4);
+        a = __builtin_bswap32(a);
+        b = __builtin_bswap32(b);
+        memcpy(left, &b, 4);
+        memcpy(right - 3, &a, 4);
+      }
+      for (; left < right; ++left, --right) {
+        uint8_t temp_pixel = *left;
+        *left = *right;
+        *right = temp_pixel;
+      }
+    }
+  #else
+    uint8_t *temp_row = effect_scratch(bytes_per_row);
+    if (temp_row) {
+      int x0 = position.origin.x, n = position.size.w;
+      for (int y = 0; y < position.size.h; y++, row += bytes_per_row) {
+        memcpy(temp_row, row, bytes_per_row);
+        bitplane_reverse(row, x0, temp_row, x0, n);
+      }
+    }
+  #endif
+
+  effect_release_frame_buffer(ctx, fb);
 }
 
+#ifdef PBL_COLOR
+// transposes a 4x4 block of bytes held in 4 words (byte k of a word = column k), result words are columns
+static void transpose4x4(uint32_t *w) {
+  uint32_t t0 = (w[0] & 0x00FF00FF) | ((w[1] << 8) & 0xFF00FF00);
+  uint32_t t1 = ((w[0] >> 8) & 0x00FF00FF) | (w[1] & 0xFF00FF00);
+  uint32_t t2 = (w[2] & 0x00FF00FF) | ((w[3] << 8) & 0xFF00FF00);
+  uint32_t t3 = ((w[2] >> 8) & 0x00FF00FF) | (w[3] & 0xFF00FF00);
+  w[0] = (t0 & 0xFFFF) | (t2 << 16);
+  w[1] = (t1 & 0xFFFF) | (t3 << 16);
+  w[2] = (t0 >> 16) | (t2 & 0xFFFF0000);
+  w[3] = (t1 >> 16) | (t3 & 0xFFFF0000);
+}
+#endif
+
 // Rotate 90 degrees
 // Added by Ron64
 // Parameter:  true: rotate right/clockwise,  false: rotate left/counter_clockwise
+// The rect is rotated into a scratch image (h wide, w tall) tile by tile: 8x8 bit transposes on Aplite,
+// 4x4 byte transposes on Basalt. The image is then written back centered on the rect and clipped to it,
+// so non-square rects keep the pixels the rotated image does not cover
 void effect_rotate_90_degrees(GContext* ctx,  GRect position, void* param){
+  bool right = (bool)param;
+  if (position.size.w <= 0 || position.size.h <= 0) return;
 
   //capturing framebuffer bitmap
-  GBitmap *fb = graphics_capture_frame_buffer(ctx);
-  
-  BitmapInfo bitmap_info;
-  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
-  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
-  bitmap_info.bitmap_format = gbitmap_get_format(fb);
-  
-  bool right = (bool)param;
-  uint8_t qtr, xCn, yCn, temp_pixel;
-  xCn= position.origin.x + position.size.w /2;
-  yCn= position.origin.y + position.size.h /2;
-  qtr=position.size.w;
-  if (position.size.h < qtr)
-    qtr= position.size.h;
-  qtr= qtr/2;
-
-  for (int c1 = 0; c1 < qtr; c1++)
-    for (int c2 = 1; c2 < qtr; c2++){
-      temp_pixel = get_pixel(bitmap_info, yCn +c1, xCn +c2);
-      if (right){
-        set_pixel(bitmap_info, yCn +c1, xCn +c2, get_pixel(bitmap_info, yCn -c2, xCn +c1));
-        set_pixel(bitmap_info, yCn -c2, xCn +c1, get_pixel(bitmap_info, yCn -c1, xCn -c2));
-        set_pixel(bitmap_info, yCn -c1, xCn -c2, get_pixel(bitmap_info, yCn +c2, xCn -c1));
-        set_pixel(bitmap_info, yCn +c2, xCn -c1, temp_pixel);
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  if (!effect_clip(fb, &position)) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  int w = position.size.w, h = position.size.h;
+  uint8_t *bitmap_data = gbitmap_get_data(fb);
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  uint8_t *src = bitmap_data + position.origin.y * bytes_per_row;
+
+  // rotated image: right R(i,j) = S(h-1-j, i), left R(i,j) = S(j, w-1-i)
+#ifdef PBL_COLOR
+  int stride = h;
+  uint8_t *rotated = effect_scratch(w * h);
+  if (!rotated) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  src += position.origin.x;
+
+  int sr, sc;
+  for (sr = 0; sr + 4 <= h; sr += 4) {
+    for (sc = 0; sc + 4 <= w; sc += 4) {
+      uint32_t block[4];
+      for (int k = 0; k < 4; ++k) memcpy(&block[k], src + (right ? sr + 3 - k : sr + k) * bytes_per_row + sc, 4);
+      transpose4x4(block);
+      for (int k = 0; k < 4; ++k) {
+        if (right) memcpy(rotated + (sc + k) * stride + h - 4 - sr, &block[k], 4);
+        else       memcpy(rotated + (w - 1 - sc - k) * stride + sr, &block[k], 4);
       }
-      else{
-        set_pixel(bitmap_info, yCn +c1, xCn +c2, get_pixel(bitmap_info, yCn +c2, xCn -c1));
-        set_pixel(bitmap_info, yCn +c2, xCn -c1, get_pixel(bitmap_info, yCn -c1, xCn -c2));
-        set_pixel(bitmap_info, yCn -c1, xCn -c2, get_pixel(bitmap_info, yCn -c2, xCn +c1));
-        set_pixel(bitmap_info, yCn -c2, xCn +c1, temp_pixel);
+    }
+    for (; sc < w; ++sc)
+      for (int k = 0; k < 4; ++k) {
+        if (right) rotated[sc * stride + h - 1 - sr - k] = src[(sr + k) * bytes_per_row + sc];
+        else       rotated[(w - 1 - sc) * stride + sr + k] = src[(sr + k) * bytes_per_row + sc];
       }
-     }
-  
-  graphics_release_frame_buffer(ctx, fb);
+  }
+  for (; sr < h; ++sr)
+    for (sc = 0; sc < w; ++sc) {
+      if (right) rotated[sc * stride + h - 1 - sr] = src[sr * bytes_per_row + sc];
+      else       rotated[(w - 1 - sc) * stride + sr] = src[sr * bytes_per_row + sc];
+    }
+#else
+  // 1bit image rows are padded to whole words, tiles are aligned on the rotated image so its bytes are written whole
+  int pad_h = (h + 7) & ~7;
+  int stride = ((h + 31) >> 5) * 4;
+  uint8_t *rotated = effect_scratch(w * stride);
+  if (!rotated) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+
+  for (int j = 0; j < pad_h; j += 8) {
+    // rotated columns j..j+7 come from source rows h-1-j.. (right) or j.. (left)
+    for (int sc = 0; sc < w; sc += 8) {
+      int n = w - sc < 8 ? w - sc : 8;
+      uint64_t block = 0;
+      for (int k = 0; k < 8; ++k) {
+        int sr = right ? h - 1 - j - k : j + k;
+        if (sr >= 0 && sr < h) block |= (uint64_t)bitplane_get(src + sr * bytes_per_row, position.origin.x + sc, n) << (8 * k);
+      }
+      block = transpose8x8(block);
+      for (int m = 0; m < n; ++m) {
+        int i = right ? sc + m : w - 1 - sc - m;
+        rotated[i * stride + j / 8] = block >> (8 * m);
+      }
+    }
+  }
+#endif
+
+  // writing the rotated image back, centered on the rect
+  int offset_x = (w - h) >> 1, offset_y = (h - w) >> 1;
+  int j0 = offset_x < 0 ? -offset_x : 0;
+  int j1 = offset_x + h > w ? w - offset_x : h;
+  for (int i = 0; i < w; ++i) {
+    int y = i + offset_y;
+    if (y < 0 || y >= h || j1 <= j0) continue;
+    #ifdef PBL_COLOR
+      memcpy(src + y * bytes_per_row + offset_x + j0, rotated + i * stride + j0, j1 - j0);
+    #else
+      bitplane_blit(src + y * bytes_per_row, position.origin.x + offset_x + j0, rotated + i * stride, j0, j1 - j0, BitplaneCopy);
+    #endif
+  }
+
+  effect_release_frame_buffer(ctx, fb);
+}
+
+#ifdef PBL_COLOR
+// blends two colors per 2bit channel, weight of b in 1/16 (result is opaque)
+static uint8_t blend_2bit(uint8_t a, uint8_t b, uint8_t weight) {
+  if (weight == 0 || a == b) return a;
+  uint8_t wa = 16 - weight;
+  return 0xC0 | (((a >> 4 & 3) * wa + (b >> 4 & 3) * weight + 8) >> 4) << 4
+              | (((a >> 2 & 3) * wa + (b >> 2 & 3) * weight + 8) >> 4) << 2
+              | (((a & 3) * wa + (b & 3) * weight + 8) >> 4);
+}
+#endif
+
+// zoom sampling along one axis: destination offset d from the centre reads source offset (d<<4)/ratio.
+// Quotient and remainder are stepped incrementally instead of dividing, weight is the remainder in 1/16
+static void zoom_axis(int16_t *src, uint8_t *weight, int n, uint8_t ratio) {
+  int q = 0, rem = 0, step_q = 16 / ratio, step_rem = 16 % ratio;
+  for (int d = 0; d <= n; ++d) {
+    src[d] = q;
+    weight[d] = (rem * 16 + ratio / 2) / ratio;
+    q += step_q;
+    rem += step_rem;
+    if (rem >= ratio) { rem -= ratio; ++q; }
+  }
+}
+
+// source index (and its outward neighbour and blend weight) for a destination index on one axis,
+// clamped to [lo, hi] so zooming out never reads outside position (nor outside the framebuffer when
+// position was clipped and the centre lies beyond it)
+static void zoom_sample(int i, int centre, int lo, int hi, const int16_t *src, const uint8_t *weight, int16_t *s0, int16_t *s1, uint8_t *w) {
+  int d = i < centre ? centre - i : i - centre;
+  int n = i < centre ? centre - lo : hi - centre;
+  int q = src[d] < n ? src[d] : n;
+  *w = src[d] < n ? weight[d] : 0;
+  *s0 = i < centre ? centre - q : centre + q;
+  *s1 = q < n ? (i < centre ? *s0 - 1 : *s0 + 1) : *s0;
+  if (*s0 < lo || *s0 > hi) *s0 = *s0 < lo ? lo : hi;
+  if (*s1 < lo || *s1 > hi) *s1 = *s1 < lo ? lo : hi;
+}
+
+// zooms position by ratioX/16 and ratioY/16 around its centre
+static void zoom_apply(GContext* ctx, GRect position, int16_t ratioX, int16_t ratioY, bool bilinear){
+  int16_t xCn, yCn;
+  xCn= position.origin.x + position.size.w /2;
+  yCn= position.origin.y + position.size.h /2;
+
+  if (ratioY == 0 || ratioX == 0 || position.size.w <= 0 || position.size.h <= 0) return;
+  if (ratioY == 16 && ratioX == 16) return;
+
+  // the zoom stays centred on position, only its part inside the framebuffer is sampled and written
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  if (!effect_clip(fb, &position)) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  int16_t x0 = position.origin.x, x1 = position.origin.x + position.size.w - 1;
+  int16_t y0 = position.origin.y, y1 = position.origin.y + position.size.h - 1;
+  int16_t nx = (xCn - x0 > x1 - xCn) ? xCn - x0 : x1 - xCn;
+  int16_t ny = (yCn - y0 > y1 - yCn) ? yCn - y0 : y1 - yCn;
+  int16_t width = position.size.w;
+
+  uint8_t *bitmap_data = gbitmap_get_data(fb);
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb);
+
+  // scratch: axis tables, column map + weights, then one row buffer per half (1bit rows keep the framebuffer bit layout)
+  #ifdef PBL_COLOR
+    int16_t row_size = width;
+  #else
+    int16_t row_size = bytes_per_row;
+  #endif
+  size_t axis_size = (nx + ny + 2) * sizeof(int16_t) + (nx + ny + 2);
+  size_t map_size = width * (2 * sizeof(int16_t) + 1);
+  uint8_t *scratch = effect_scratch(((axis_size + map_size + 3) & ~3) + 2 * row_size);
+  if (!scratch) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  int16_t *qy = (int16_t*)scratch, *qx = qy + ny + 1;
+  int16_t *map0 = qx + nx + 1, *map1 = map0 + width;
+  uint8_t *wy = (uint8_t*)(map1 + width), *wx = wy + ny + 1, *wmap = wx + nx + 1;
+  uint8_t *rows = scratch + ((axis_size + map_size + 3) & ~3);
+  uint8_t *row_a = rows, *row_b = rows + row_size;
+
+  zoom_axis(qy, wy, ny, ratioY);
+  zoom_axis(qx, wx, nx, ratioX);
+  for (int16_t i = 0; i < width; ++i) {
+    zoom_sample(x0 + i, xCn, x0, x1, qx, wx, &map0[i], &map1[i], &wmap[i]);
+  }
+
+  // in-place order: zooming in scans from the edge to the centre (sources are nearer the centre),
+  // zooming out from the centre to the edge. Both halves are interleaved so the centre row is read before it is written
+  int16_t cached[2] = {-1, -1};
+  #ifdef PBL_COLOR
+    uint8_t cached_w[2] = {0, 0};
+  #endif
+  for (int16_t k = 0; k <= ny; ++k) {
+    int16_t dy = ratioY > 16 ? ny - k : k;
+    for (int8_t half = 0; half < 2; ++half) {
+      if (half == 1 && dy == 0) continue;
+      int16_t y = half ? yCn + dy : yCn - dy;
+      if (y < y0 || y > y1) continue;
+
+      int16_t sy0, sy1;
+      uint8_t w;
+      zoom_sample(y, yCn, y0, y1, qy, wy, &sy0, &sy1, &w);
+      uint8_t *dst = bitmap_data + y * bytes_per_row;
+      uint8_t *buf = half ? row_b : row_a;
+
+      #ifdef PBL_COLOR
+        // consecutive rows sampling the same source row (and weight) are replicated with memcpy
+        if (cached[half] != sy0 || cached_w[half] != w) {
+          const uint8_t *src = bitmap_data + sy0 * bytes_per_row;
+          if (!bilinear) {
+            for (int16_t i = 0; i < width; ++i) buf[i] = src[map0[i]];
+          } else {
+            const uint8_t *src1 = bitmap_data + sy1 * bytes_per_row;
+            for (int16_t i = 0; i < width; ++i) {
+              buf[i] = blend_2bit(blend_2bit(src[map0[i]], src[map1[i]], wmap[i]),
+                                  blend_2bit(src1[map0[i]], src1[map1[i]], wmap[i]), w);
+            }
+          }
+          cached[half] = sy0;
+          cached_w[half] = w;
+        }
+        memcpy(dst + x0, buf, width);
+      #else
+        if (cached[half] != sy0) {
+          const uint8_t *src = bitmap_data + sy0 * bytes_per_row;
+          for (int16_t i = 0; i < width; ++i) {
+            int16_t x = x0 + i;
+            PIXEL_SET_1BIT(buf, x, PIXEL_GET_1BIT(src, map0[i]));
+          }
+          cached[half] = sy0;
+        }
+        bitplane_blit(dst, x0, buf, x0, width, BitplaneCopy);
+      #endif
+    }
+  }
+
+  effect_release_frame_buffer(ctx, fb);
 }
 
 // Zoom effect.
 // Added by Ron64
 // Parameter: Y zoom (high byte) X zoom(low byte),  0x10 no zoom 0x20 200% 0x08 50%, 
 // use the percentage macro EL_ZOOM(150,60). In this example: Y- zoom in 150%, X- zoom out to 60% 
+// Sampling is clamped to position. EL_ZOOM_BILINEAR(150,60) interpolates 2bit channels on Basalt
 void effect_zoom(GContext* ctx,  GRect position, void* param){
-  GBitmap *fb = graphics_capture_frame_buffer(ctx);
-  
-  BitmapInfo bitmap_info;
-  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
-  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
-  bitmap_info.bitmap_format = gbitmap_get_format(fb);
+  zoom_apply(ctx, position, (int32_t)param & 0xFF, (int32_t)param >>8 & 0xFF, (uint32_t)param & EL_ZOOM_BILINEAR_FLAG);
+}
 
-  uint8_t xCn, yCn, Y1,X1, ratioY, ratioX;
-  xCn= position.origin.x + position.size.w /2;
-  yCn= position.origin.y + position.size.h /2;
+static void zoom_type_apply(GContext *ctx, GRect position, const void *param, void *state) {
+  const EffectZoomParams *zoom = (const EffectZoomParams *)param;
+  zoom_apply(ctx, position, zoom->ratio_x, zoom->ratio_y, zoom->bilinear);
+}
+
+// the per frame setup of zoom (axis tables and column map of the clipped rect) is a few integer steps per
+// row and column, so there is nothing worth preparing
+const EffectType effect_type_zoom = {
+  .param_size = sizeof(EffectZoomParams),
+  .apply = zoom_type_apply,
+};
+
+// lens displacement table, rebuilt only when focal, object distance or radius change
+typedef struct {
+  uint8_t focal, obj_dis, r;
+  int16_t *shift; // shift[i]: source offset (on either axis) for a pixel i away from the centre
+  uint8_t *span;  // span[y]: pixels x < span[y] of row y are inside the lens (x*x+y*y < r*r)
+} LensTable;
+
+// table of effect_lens (instances of effect_type_lens have their own)
+static LensTable s_lens;
+
+static bool lens_prepare(LensTable *lens, uint8_t focal, uint8_t obj_dis, uint8_t r) {
+  if (lens->shift && lens->focal == focal && lens->obj_dis == obj_dis && lens->r == r) return true;
+
+  free(lens->shift);
+  lens->shift = malloc((r + 1) * (sizeof(int16_t) + sizeof(uint8_t)));
+  if (!lens->shift) return false;
+  lens->span = (uint8_t*)(lens->shift + r + 1);
+  lens->focal = focal;
+  lens->obj_dis = obj_dis;
+  lens->r = r;
+
+  // past the focal point the shift has no meaning (asin of more than 1), it is capped like a huge shift
+  for (int i = 0; i <= r; ++i) {
+    float shift = i < focal ? my_tan(my_asin(i/(float)focal))*obj_dis : INT16_MAX;
+    lens->shift[i] = shift < INT16_MAX ? shift : INT16_MAX;
+  }
+
+  int x = r;
+  for (int y = 0; y <= r; ++y) {
+    while (x > 0 && x*x+y*y >= r*r) --x;
+    lens->span[y] = (x*x+y*y < r*r) ? x + 1 : 0;
+  }
+  return true;
+}
+
+// number of offsets from the centre (0, 1, ...) whose pixels and sources (centre +- shift) are all in [0, size)
+static int lens_safe(const LensTable *lens, int centre, int size) {
+  int n = 0;
+  while (n <= lens->r && centre - n >= 0 && centre + n < size && centre - lens->shift[n] >= 0 && centre + lens->shift[n] < size) ++n;
+  return n;
+}
+
+// lens pixel of the border band: skipped when it is off the framebuffer, its source clamped to the framebuffer
+static void lens_pixel(uint8_t *bitmap_data, int bytes_per_row, GSize size, int x, int y, int sx, int sy) {
+  if (x < 0 || y < 0 || x >= size.w || y >= size.h) return;
+  sx = sx < 0 ? 0 : sx >= size.w ? size.w - 1 : sx;
+  sy = sy < 0 ? 0 : sy >= size.h ? size.h - 1 : sy;
+  FB_SET(bitmap_data + y * bytes_per_row, x, FB_GET(bitmap_data + sy * bytes_per_row, sx));
+}
 
-  ratioY= (int32_t)param >>8 & 0xFF;
-  ratioX= (int32_t)param & 0xFF;
-
-  for (int y = 0; y <= position.size.h>>1; y++)
-    for (int x = 0; x <= position.size.w>>1; x++)
-    {
-      //yS,xS scan source: centre to out or out to centre
-      int8_t yS = (ratioY>16) ? (position.size.h/2)- y: y; 
-      int8_t xS = (ratioX>16) ? (position.size.w/2)- x: x;
-      Y1= (yS<<4) /ratioY;
-      X1= (xS<<4) /ratioX;
-      set_pixel(bitmap_info, yCn +yS, xCn +xS, get_pixel(bitmap_info, yCn +Y1, xCn +X1)); 
-      set_pixel(bitmap_info, yCn +yS, xCn -xS, get_pixel(bitmap_info, yCn +Y1, xCn -X1));
-      set_pixel(bitmap_info, yCn -yS, xCn +xS, get_pixel(bitmap_info, yCn -Y1, xCn +X1));
-      set_pixel(bitmap_info, yCn -yS, xCn -xS, get_pixel(bitmap_info, yCn -Y1, xCn -X1));
+// gathers the four quadrants of the lens through the displacement table, rows from the edge inwards.
+// Pixels within safe_x/safe_y of the centre read and write inside the framebuffer and run unchecked,
+// the band outside them (lens partly off screen, or shifts past its edge) goes through lens_pixel
+static void lens_rows(const LensTable *lens, uint8_t *bitmap_data, int bytes_per_row, GSize size, int xCn, int yCn) {
+  int safe_x = lens_safe(lens, xCn, size.w), safe_y = lens_safe(lens, yCn, size.h);
+  for (int y = lens->r; y >= 0; --y) {
+    int Y1= lens->shift[y];
+    int fast = y < safe_y ? (lens->span[y] < safe_x ? lens->span[y] : safe_x) : 0;
+    for (int x = lens->span[y] - 1; x >= fast; --x) {
+      int X1= lens->shift[x];
+      lens_pixel(bitmap_data, bytes_per_row, size, xCn + x, yCn + y, xCn + X1, yCn + Y1);
+      lens_pixel(bitmap_data, bytes_per_row, size, xCn - x, yCn + y, xCn - X1, yCn + Y1);
+      lens_pixel(bitmap_data, bytes_per_row, size, xCn + x, yCn - y, xCn + X1, yCn - Y1);
+      lens_pixel(bitmap_data, bytes_per_row, size, xCn - x, yCn - y, xCn - X1, yCn - Y1);
     }
-  graphics_release_frame_buffer(ctx, fb);
-//Todo: Should probably reduce Y size on zoom out or limit reading beyond edge of screen.
+    if (fast == 0) continue;
+
+    uint8_t *lower = bitmap_data + (yCn + y) * bytes_per_row, *upper = bitmap_data + (yCn - y) * bytes_per_row;
+    const uint8_t *src_lower = bitmap_data + (yCn + Y1) * bytes_per_row, *src_upper = bitmap_data + (yCn - Y1) * bytes_per_row;
+    for (int x = fast - 1; x >= 0; --x) {
+      int X1= lens->shift[x];
+      FB_SET(lower, xCn + x, FB_GET(src_lower, xCn + X1));
+      FB_SET(lower, xCn - x, FB_GET(src_lower, xCn - X1));
+      FB_SET(upper, xCn + x, FB_GET(src_upper, xCn + X1));
+      FB_SET(upper, xCn - x, FB_GET(src_upper, xCn - X1));
+    }
+  }
+}
+
+// radius of the lens drawn in position
+static uint8_t lens_radius(GRect position) {
+  uint8_t d=position.size.w;
+  if (position.size.h < d)
+    d= position.size.h;
+  return d/2;
+}
+
+static void lens_apply(GContext* ctx, GRect position, const LensTable *lens) {
+  int16_t xCn= position.origin.x + position.size.w /2;
+  int16_t yCn= position.origin.y + position.size.h /2;
+
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  lens_rows(lens, gbitmap_get_data(fb), gbitmap_get_bytes_per_row(fb), gbitmap_get_bounds(fb).size, xCn, yCn);
+  effect_release_frame_buffer(ctx, fb);
 }
 
 // Lens effect.
 // Added by Ron64
 // Parameters: lens focal(high byte) and object distance(low byte)
 void effect_lens(GContext* ctx,  GRect position, void* param){
-  GBitmap *fb = graphics_capture_frame_buffer(ctx);
-  
-  BitmapInfo bitmap_info;
-  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
-  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
-  bitmap_info.bitmap_format = gbitmap_get_format(fb);
-  
-  uint8_t d,r, xCn, yCn;
+  uint8_t focal =   (int32_t)param >>8 & 0xFF;// focal point of lens
+  uint8_t obj_dis = (int32_t)param & 0xFF;//distance of object from focal point.
 
-  xCn= position.origin.x + position.size.w /2;
-  yCn= position.origin.y + position.size.h /2;
-  d=position.size.w;
-  if (position.size.h < d)
-    d= position.size.h;
-  r= d/2; // radius of lens
-  float focal =   (int32_t)param >>8 & 0xFF;// focal point of lens
-  float obj_dis = (int32_t)param & 0xFF;//distance of object from focal point.
-  
-  for (int y = r; y >= 0; --y)
-    for (int x = r; x >= 0; --x)
-      if (x*x+y*y < r*r)
-      {
-        int Y1= my_tan(my_asin(y/focal))*obj_dis;
-        int X1= my_tan(my_asin(x/focal))*obj_dis;
-        set_pixel(bitmap_info, yCn +y, xCn +x, get_pixel(bitmap_info, yCn +Y1, xCn +X1)); 
-        set_pixel(bitmap_info, yCn +y, xCn -x, get_pixel(bitmap_info, yCn +Y1, xCn -X1));
-        set_pixel(bitmap_info, yCn -y, xCn +x, get_pixel(bitmap_info, yCn -Y1, xCn +X1));
-        set_pixel(bitmap_info, yCn -y, xCn -x, get_pixel(bitmap_info, yCn -Y1, xCn -X1));
-      }
-    graphics_release_frame_buffer(ctx, fb);
-//Todo: Change to lock-up arcsin table in the future. (Currently using floating point math library that is relatively big & slow)
+  // float math only runs when the parameters change, each frame just gathers pixels through the table
+  if (!lens_prepare(&s_lens, focal, obj_dis, lens_radius(position))) return;
+  lens_apply(ctx, position, &s_lens);
 }
-  
+
+static bool lens_type_prepare(void *state, const void *param, GRect position) {
+  const EffectLensParams *lens = (const EffectLensParams *)param;
+  return lens_prepare((LensTable *)state, lens->focal, lens->obj_dis, lens_radius(position));
+}
+
+static void lens_type_apply(GContext *ctx, GRect position, const void *param, void *state) {
+  lens_apply(ctx, position, (const LensTable *)state);
+}
+
+static void lens_type_destroy(void *state) {
+  free(((LensTable *)state)->shift);
+}
+
+const EffectType effect_type_lens = {
+  .param_size = sizeof(EffectLensParams),
+  .state_size = sizeof(LensTable),
+  .rect_sized = true,
+  .prepare = lens_type_prepare,
+  .apply = lens_type_apply,
+  .destroy = lens_type_destroy,
+};
+
 // mask effect.
 // see struct EffectMask for parameter description  
+// state kept by effect_mask between frames
+struct EffectMaskCache {
+  // what the spans were built from
+  bool valid;
+  char *text;
+  GFont font;
+  GBitmap *bitmap_mask;
+  GColor mask_color;
+  GColor background_color;
+  GRect rect; // clipped to the framebuffer
+  GTextOverflowMode text_overflow;
+  GTextAlignment text_align;
+  // mask pixels as (y, x0, x1) runs relative to the clipped rect, x1 exclusive
+  int16_t *spans;
+  int span_count, span_capacity;
+  // background in the framebuffer format (bg_converted is owned, otherwise it is the bitmap's own data)
+  GBitmap *background;
+  uint8_t *bg_data, *bg_converted;
+  int bg_bytes_per_row;
+  GSize bg_size;
+};
+
+// stores run [x0, x1) of row y as the span after count ones (unless spans is NULL), returns the new count
+static int mask_add_span(int16_t *spans, int count, int y, int x0, int x1) {
+  if (spans) {
+    spans[3 * count] = y;
+    spans[3 * count + 1] = x0;
+    spans[3 * count + 2] = x1;
+  }
+  return count + 1;
+}
+
+// runs of color pixels inside position as (y, x0, x1) triples relative to it; with spans == NULL only counts them
+static int mask_spans(const uint8_t *bitmap_data, int bytes_per_row, GRect position, GColor color, int16_t *spans) {
+  int count = 0;
+  #ifndef PBL_COLOR
+    uint32_t flip = gcolor_equal(color, GColorWhite) ? 0 : 0xFFFFFFFF;
+  #endif
+  for (int y = 0; y < position.size.h; y++) {
+    const uint8_t *row = bitmap_data + (y + position.origin.y) * bytes_per_row;
+    int start = -1;
+    #ifdef PBL_COLOR
+      for (int x = 0; x < position.size.w; x++) {
+        bool hit = row[x + position.origin.x] == color.argb;
+        if (hit && start < 0) start = x;
+        if (!hit && start >= 0) {
+          count = mask_add_span(spans, count, y, start, x);
+          start = -1;
+        }
+      }
+    #else // 32 pixels at a time, jumping from one run edge to the next
+      for (int x = 0; x < position.size.w; ) {
+        int n = position.size.w - x < 32 ? position.size.w - x : 32;
+        uint32_t hits = bitplane_get(row, x + position.origin.x, n) ^ flip;
+        uint32_t edges = start < 0 ? hits : ~hits;
+        if (n < 32) edges &= (1u << n) - 1;
+        if (!edges) {
+          x += n;
+          continue;
+        }
+        x += __builtin_ctz(edges);
+        if (start < 0) {
+          start = x;
+        } else {
+          count = mask_add_span(spans, count, y, start, x);
+          start = -1;
+        }
+      }
+    #endif
+    if (start >= 0) count = mask_add_span(spans, count, y, start, position.size.w);
+  }
+  return count;
+}
+
+// points the cache at the background in framebuffer format, converting it (once) when the formats differ
+static bool mask_prepare_background(EffectMaskCache *cache, GBitmap *background, GBitmapFormat fb_format) {
+  if (cache->background == background && cache->bg_data) return true;
+
+  free(cache->bg_converted);
+  cache->bg_converted = NULL;
+  cache->bg_data = NULL;
+  cache->background = background;
+  cache->bg_size = gbitmap_get_bounds(background).size;
+
+  BitmapInfo bg_bitmap_info;
+  bg_bitmap_info.bitmap_data = gbitmap_get_data(background);
+  bg_bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(background);
+  bg_bitmap_info.bitmap_format = gbitmap_get_format(background);
+  if (bg_bitmap_info.bitmap_format == fb_format) {
+    cache->bg_data = bg_bitmap_info.bitmap_data;
+    cache->bg_bytes_per_row = bg_bitmap_info.bytes_per_row;
+    return true;
+  }
+
+  // palette of bg bitmap and framebuffer differ: converting it once (same mapping as PalColor)
+  int bytes_per_row = fb_format == GBitmapFormat8Bit ? cache->bg_size.w : (cache->bg_size.w + 31) / 32 * 4;
+  uint8_t *converted = calloc(cache->bg_size.h, bytes_per_row);
+  if (!converted) return false;
+
+  #define CONVERT_ROWS(GET, TO_FB) do { \
+      const uint8_t *src = bg_bitmap_info.bitmap_data; \
+      uint8_t *dst = converted; \
+      for (int y = 0; y < cache->bg_size.h; y++, src += bg_bitmap_info.bytes_per_row, dst += bytes_per_row) \
+        for (int x = 0; x < cache->bg_size.w; x++) FB_SET(dst, x, TO_FB(GET(src, x))); \
+    } while (0)
+  #ifdef PBL_COLOR
+    #define ONE_BIT_TO_FB(v) ((v) ? GColorWhiteARGB8 : GColorBlackARGB8)
+    if (bg_bitmap_info.bitmap_format == GBitmapFormat1Bit) CONVERT_ROWS(PIXEL_GET_1BIT, ONE_BIT_TO_FB);
+    else if (bg_bitmap_info.bitmap_format == GBitmapFormat1BitPalette) CONVERT_ROWS(PIXEL_GET_1BIT_PALETTE, ONE_BIT_TO_FB);
+    #undef ONE_BIT_TO_FB
+  #else
+    #define EIGHT_BIT_TO_FB(v) ((v) == GColorWhiteARGB8)
+    if (bg_bitmap_info.bitmap_format == GBitmapFormat8Bit) CONVERT_ROWS(PIXEL_GET_8BIT, EIGHT_BIT_TO_FB);
+    #undef EIGHT_BIT_TO_FB
+  #endif
+  else { // other palettes are read byte-wise like get_pixel does
+    BitmapInfo bitmap_info = { converted, bytes_per_row, fb_format };
+    for (int y = 0; y < cache->bg_size.h; y++)
+      for (int x = 0; x < cache->bg_size.w; x++)
+        set_pixel(bitmap_info, y, x, PalColor(get_pixel(bg_bitmap_info, y, x), bg_bitmap_info.bitmap_format, fb_format));
+  }
+  #undef CONVERT_ROWS
+
+  cache->bg_data = cache->bg_converted = converted;
+  cache->bg_bytes_per_row = bytes_per_row;
+  return true;
+}
+
+// true when the cached spans were built from the same mask parameters
+static bool mask_cache_matches(EffectMaskCache *cache, EffectMask *mask, GRect rect) {
+  return cache->valid && cache->font == mask->font && cache->bitmap_mask == mask->bitmap_mask &&
+         gcolor_equal(cache->mask_color, mask->mask_color) && gcolor_equal(cache->background_color, mask->background_color) &&
+         grect_equal(&cache->rect, &rect) &&
+         cache->text_overflow == mask->text_overflow && cache->text_align == mask->text_align &&
+         (cache->text && mask->text ? strcmp(cache->text, mask->text) == 0 : cache->text == mask->text);
+}
+
+// remembers the parameters the spans were built from
+static void mask_cache_store_key(EffectMaskCache *cache, EffectMask *mask, GRect rect) {
+  free(cache->text);
+  cache->text = NULL;
+  if (mask->text) {
+    cache->text = malloc(strlen(mask->text) + 1);
+    if (!cache->text) return;
+    strcpy(cache->text, mask->text);
+  }
+  cache->font = mask->font;
+  cache->bitmap_mask = mask->bitmap_mask;
+  cache->mask_color = mask->mask_color;
+  cache->background_color = mask->background_color;
+  cache->rect = rect;
+  cache->text_overflow = mask->text_overflow;
+  cache->text_align = mask->text_align;
+  cache->valid = true;
+}
+
+void effect_mask_reset(EffectMask *mask) {
+  EffectMaskCache *cache = mask->cache;
+  if (!cache) return;
+  free(cache->text);
+  free(cache->spans);
+  free(cache->bg_converted);
+  free(cache);
+  mask->cache = NULL;
+}
+
+// Mask pixels are kept as a span list, rebuilt only when text, font, bitmap, colors or the (clipped) rect
+// change. The mask is still drawn every frame, since its pixels that are not mask_color (antialiasing, other
+// colors of a bitmap) stay on screen; only the scan for mask_color runs and the background conversion are
+// saved. With GColorClear whatever is under the layer can hold mask_color pixels too, so the spans are
+// collected again every frame
 void effect_mask(GContext* ctx, GRect position, void* param) {
-  GColor temp_pixel;  
   EffectMask *mask = (EffectMask *)param;
+  if (position.size.w <= 0 || position.size.h <= 0) return;
+
+  if (!mask->cache) {
+    mask->cache = calloc(1, sizeof(EffectMaskCache));
+    if (!mask->cache) return;
+  }
+  EffectMaskCache *cache = mask->cache;
+  bool opaque = !gcolor_equal(mask->background_color, GColorClear);
+
+  effect_frame_flush(ctx); // drawing through the context below
 
   //drawing background - only if real color is passed
-  if (!gcolor_equal(mask->background_color, GColorClear)) {
+  if (opaque) {
     graphics_context_set_fill_color(ctx, mask->background_color);
     graphics_fill_rect(ctx, GRect(0, 0, position.size.w, position.size.h), 0, GCornerNone); 
   }  
@@ -602,34 +1356,158 @@ void effect_mask(GContext* ctx, GRect position, void* param) {
   }
     
   //capturing framebuffer bitmap
-  GBitmap *fb = graphics_capture_frame_buffer(ctx);
-  
-  BitmapInfo bitmap_info;
-  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
-  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
-  bitmap_info.bitmap_format = gbitmap_get_format(fb);
-  
-  //capturing background bitmap
-  BitmapInfo bg_bitmap_info;
-  bg_bitmap_info.bitmap_data =  gbitmap_get_data(mask->bitmap_background);
-  bg_bitmap_info.bytes_per_row =  gbitmap_get_bytes_per_row(mask->bitmap_background);
-  bg_bitmap_info.bitmap_format = gbitmap_get_format(mask->bitmap_background);
-  
-  //looping throughout layer replacing mask with bg bitmap
-  for (int y = 0; y < position.size.h; y++)
-     for (int x = 0; x < position.size.w; x++) {
-       temp_pixel = (GColor)get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x);
-       if (gcolor_equal(temp_pixel, mask->mask_color)) {
-         // getting pixel from background bitmap (adjusted to pallette by PalColor function because palette of bg bitmap and framebuffer may differ)
-         // *** APP_LOG(APP_LOG_LEVEL_DEBUG, "get_pixel = %d, pal_color = %d", get_pixel(bg_bitmap_info, y + position.origin.y, x + position.origin.x), PalColor(get_pixel(bg_bitmap_info, y + position.origin.y, x + position.origin.x), bg_bitmap_info.bitmap_format, bitmap_info.bitmap_format));
-         set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, PalColor(get_pixel(bg_bitmap_info, y + position.origin.y, x + position.origin.x), bg_bitmap_info.bitmap_format, bitmap_info.bitmap_format));
-       } 
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  if (!effect_clip(fb, &position)) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  uint8_t *bitmap_data = gbitmap_get_data(fb);
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  bool cached = opaque && mask_cache_matches(cache, mask, position);
+
+  if (!mask_prepare_background(cache, mask->bitmap_background, gbitmap_get_format(fb))) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+
+  int16_t *spans = cache->spans;
+  int count = cache->span_count;
+  if (!cached) {
+    count = mask_spans(bitmap_data, bytes_per_row, position, mask->mask_color, NULL);
+    if (opaque) { // keeping the spans for the next frames
+      cache->valid = false;
+      if (count > cache->span_capacity) {
+        free(cache->spans);
+        cache->spans = malloc(3 * count * sizeof(int16_t));
+        cache->span_capacity = cache->spans ? count : 0;
+      }
+      spans = cache->spans;
+      if (spans) mask_cache_store_key(cache, mask, position);
+      cache->span_count = count;
+    } else {
+      spans = effect_scratch(3 * count * sizeof(int16_t));
+    }
+    if (!spans) {
+      effect_release_frame_buffer(ctx, fb);
+      return;
+    }
+    mask_spans(bitmap_data, bytes_per_row, position, mask->mask_color, spans);
+  }
+
+  //copying background bitmap thru the mask spans (clipped to the background size)
+  for (int i = 0; i < count; i++) {
+    int y = spans[3 * i] + position.origin.y;
+    int x0 = spans[3 * i + 1] + position.origin.x, x1 = spans[3 * i + 2] + position.origin.x;
+    if (y >= cache->bg_size.h) continue;
+    if (x1 > cache->bg_size.w) x1 = cache->bg_size.w;
+    if (x0 >= x1) continue;
+    #ifdef PBL_COLOR
+      memcpy(bitmap_data + y * bytes_per_row + x0, cache->bg_data + y * cache->bg_bytes_per_row + x0, x1 - x0);
+    #else
+      bitplane_blit(bitmap_data + y * bytes_per_row, x0, cache->bg_data + y * cache->bg_bytes_per_row, x0, x1 - x0, BitplaneCopy);
+    #endif
   }
   
-  graphics_release_frame_buffer(ctx, fb);
+  effect_release_frame_buffer(ctx, fb);
   
 }
 
+// shaped effect.
+// see struct EffectShaped for parameter description
+// Colour effects are merged into a palette applied span by span. Other effects run on the whole rect, which
+// is saved beforehand (per call, so a shaped effect can run inside another) and the gaps between the spans
+// of each row are copied back
+void effect_shaped(GContext* ctx, GRect position, void* param) {
+  EffectShaped *shaped = (EffectShaped *)param;
+  const EffectShape *shape = shaped->shape;
+  if (position.size.w <= 0 || position.size.h <= 0) return;
+
+  EffectPalette palette;
+  effect_palette_init(&palette);
+  bool local = effect_palette_add_effect(&palette, shaped->effect, shaped->param);
+
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  uint8_t *bitmap_data = gbitmap_get_data(fb);
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  GRect clip = position;
+  if (!effect_clip(fb, &clip)) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  int x_end = clip.origin.x + clip.size.w, y_end = clip.origin.y + clip.size.h;
+
+  if (local) {
+    #ifndef PBL_COLOR
+      uint8_t black = gcolor_equal((GColor8){.argb = palette.lut[GColorBlack.argb]}, GColorWhite)? 1 : 0;
+      uint8_t white = gcolor_equal((GColor8){.argb = palette.lut[GColorWhite.argb]}, GColorWhite)? 1 : 0;
+    #endif
+    const EffectSpan *end = shape->spans + shape->count;
+    #ifndef PBL_COLOR
+      if (black == 0 && white == 1) end = shape->spans; // identity
+    #endif
+    for (const EffectSpan *span = shape->spans; span < end; span++) {
+      int y = span->y + position.origin.y;
+      int x0 = span->x0 + position.origin.x, x1 = span->x1 + position.origin.x;
+      if (y < clip.origin.y || y >= y_end) continue;
+      if (x0 < clip.origin.x) x0 = clip.origin.x;
+      if (x1 > x_end) x1 = x_end;
+      if (x0 >= x1) continue;
+      uint8_t *row = bitmap_data + y * bytes_per_row;
+      #ifdef PBL_COLOR
+        if (shaped->effect == effect_invert) invert_row_8bit(row + x0, x1 - x0);
+        else for (int x = x0; x < x1; x++) row[x] = palette.lut[row[x]];
+      #else
+        bitplane_apply(row, x0, x1, black ^ white, black);
+      #endif
+    }
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+
+  // saving the rect (the words covering each row on Aplite, so the saved bits keep their positions in the word)
+  uint8_t *saved = malloc(effect_saved_size(clip));
+  if (!saved) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  effect_save_rect(fb, clip, saved);
+  effect_release_frame_buffer(ctx, fb);
+
+  effect_call(shaped->effect, ctx, position, shaped->param);
+
+  // copying back the gaps between the spans of each row; saved pixel x of a row is at x - saved_x
+  #ifdef PBL_COLOR
+    int saved_row = clip.size.w, saved_x = clip.origin.x;
+  #else
+    int saved_row = (int)(effect_saved_size(clip) / clip.size.h), saved_x = clip.origin.x & ~31;
+  #endif
+  fb = effect_capture_frame_buffer(ctx);
+  bitmap_data = gbitmap_get_data(fb);
+  const EffectSpan *span = shape->spans, *end = shape->spans + shape->count;
+  for (int y = clip.origin.y; y < y_end; y++) {
+    uint8_t *row = bitmap_data + y * bytes_per_row;
+    const uint8_t *saved_pixels = saved + (y - clip.origin.y) * saved_row;
+    while (span < end && span->y + position.origin.y < y) span++;
+    int x = clip.origin.x;
+    for (; x < x_end; span++) {
+      bool in_row = span < end && span->y + position.origin.y == y;
+      int gap_end = in_row ? span->x0 + position.origin.x : x_end;
+      if (gap_end > x_end) gap_end = x_end;
+      if (gap_end > x) {
+        #ifdef PBL_COLOR
+          memcpy(row + x, &saved_pixels[x - saved_x], gap_end - x);
+        #else
+          bitplane_blit(row, x, saved_pixels, x - saved_x, gap_end - x, BitplaneCopy);
+        #endif
+      }
+      if (!in_row) break;
+      if (span->x1 + position.origin.x > x) x = span->x1 + position.origin.x;
+    }
+  }
+  effect_release_frame_buffer(ctx, fb);
+  free(saved);
+}
+
 void effect_fps(GContext* ctx, GRect position, void* param) {
   static GFont font = NULL;
   static char buff[16];
@@ -641,6 +1519,7 @@ void effect_fps(GContext* ctx, GRect position, void* param) {
     ++((EffectFPS*)param)->frame;
     uint32_t fp100s = (100000*((EffectFPS*)param)->frame)/((tt-((EffectFPS*)param)->starttt)*1000+ms-((EffectFPS*)param)->startms);
     snprintf(buff,sizeof(buff),"FPS:%d.%02d",(int)fp100s/100,(int)fp100s%100);
+    effect_frame_flush(ctx);
     graphics_context_set_stroke_color(ctx, GColorWhite);
     graphics_draw_text(ctx, buff, font, GRect(0, 0, position.size.w, position.size.h), GTextOverflowModeWordWrap, GTextAlignmentLeft, NULL);
   }
@@ -653,114 +1532,360 @@ void effect_fps(GContext* ctx, GRect position, void* param) {
 }
 
 
+// pixel offsets of a shadow line from (0,0) to (dy,dx), stepped exactly like
+// THE EXTREMELY FAST LINE ALGORITHM Variation E (Addition Fixed Point PreCalc Small Display)
+// based on algorythm by Po-Han Lin at http://www.edepot.com
+// offsets holds dy,dx pairs, returns number of points
+static int shadow_line(int dy, int dx, int8_t *offsets) {
+  bool yLonger = false; int shortLen = dy; int longLen = dx;
+  int n = 0;
+
+  if (abs(shortLen) > abs(longLen)) {
+    int swap = shortLen;
+    shortLen = longLen; longLen = swap; yLonger = true;
+  }
+
+  int decInc = longLen == 0 ? 0 : (shortLen * 256) / longLen;
+  int step = longLen > 0 ? 1 : -1;
+  for (int i = 0, j = 0x80; i * step <= longLen * step; i += step, j += step * decInc, ++n) {
+    offsets[2 * n]     = yLonger ? i : j >> 8;
+    offsets[2 * n + 1] = yLonger ? j >> 8 : i;
+  }
+  return n;
+}
+
+// ORs src (src_words long) shifted left by shift bits (right if negative) into dst (dst_words long)
+static void or_shifted(uint32_t *dst, int dst_words, const uint32_t *src, int src_words, int shift) {
+  int dst_x = shift, src_x = 0, n = 32 * src_words;
+  if (dst_x < 0) {
+    src_x = -dst_x;
+    n += dst_x;
+    dst_x = 0;
+  }
+  if (dst_x + n > 32 * dst_words) n = 32 * dst_words - dst_x;
+  if (n > 0) bitplane_blit((uint8_t*)dst, dst_x, (const uint8_t*)src, src_x, n, BitplaneOr);
+}
+
+// widens every set bit of a bitset row to n bits on each side (shift-OR doubling, log2(n) steps)
+static void smear_row(uint32_t *row, uint32_t *temp, int words, int n) {
+  for (int span = 0; span < n; ) {
+    int step = span + 1 < n - span ? span + 1 : n - span;
+    memcpy(temp, row, words * sizeof(uint32_t));
+    or_shifted(row, words, temp, words, step);
+    or_shifted(row, words, temp, words, -step);
+    span += step;
+  }
+}
+
+// bitset (words per row, bit x = pixel position.origin.x + x) of the pixels of color inside position
+// On Basalt uniform tiles (counted for effect) are skipped, or filled when they have color; Aplite already
+// copies 32 pixels at a time, where the summary would cost more than it saves
+static void color_mask(uint8_t *bitmap_data, int bytes_per_row, GRect position, GColor color, uint32_t *mask, int words, effect_cb *effect) {
+  memset(mask, 0, position.size.h * words * sizeof(uint32_t));
+  #ifdef PBL_COLOR
+    int cols, rows, skipped = 0;
+    uint16_t *tiles = effect_tile_summary(bitmap_data, bytes_per_row, position, &cols, &rows);
+    for (int y = 0; y < position.size.h; y++, mask += words) {
+      uint8_t *row = bitmap_data + (y + position.origin.y) * bytes_per_row + position.origin.x;
+      uint16_t *tile = tiles ? tiles + ((y + position.origin.y) / EFFECT_TILE - position.origin.y / EFFECT_TILE) * cols : NULL;
+      // x0..x1: part of the row inside one tile (rect coordinates)
+      for (int x0 = 0, x1; x0 < position.size.w; x0 = x1, tile += tiles != NULL) {
+        x1 = ((x0 + position.origin.x) / EFFECT_TILE + 1) * EFFECT_TILE - position.origin.x;
+        if (x1 > position.size.w) x1 = position.size.w;
+        if (tiles && *tile != EFFECT_TILE_MIXED) {
+          if (*tile == color.argb)
+            for (int x = x0; x < x1; x++) mask[x >> 5] |= 1u << (x & 31);
+          continue;
+        }
+        for (int x = x0; x < x1; x++)
+          if (row[x] == color.argb) mask[x >> 5] |= 1u << (x & 31);
+      }
+    }
+    if (tiles) {
+      for (int i = 0; i < cols * rows; i++) skipped += tiles[i] != EFFECT_TILE_MIXED;
+      effect_count_tiles(effect, cols * rows, skipped);
+    }
+  #else
+    bool white = gcolor_equal(color, GColorWhite);
+    for (int y = 0; y < position.size.h; y++, mask += words) {
+      uint8_t *row = bitmap_data + (y + position.origin.y) * bytes_per_row;
+      bitplane_blit((uint8_t*)mask, 0, row, position.origin.x, position.size.w, BitplaneCopy);
+      if (!white) bitplane_apply((uint8_t*)mask, 0, position.size.w, 1, 1);
+    }
+  #endif
+}
+
+#ifdef PBL_COLOR
+// gives covered pixels of a row (bitset in screen coordinates) new_color, unless they are keep_color
+static void cover_row_8bit(uint8_t *row, const uint32_t *cover, int words, uint8_t keep_color, uint8_t new_color) {
+  for (int i = 0; i < words; ++i) {
+    for (uint32_t bits = cover[i]; bits; bits &= bits - 1) {
+      uint8_t *pixel = row + 32 * i + __builtin_ctz(bits);
+      if (*pixel != keep_color) *pixel = new_color;
+    }
+  }
+}
+#endif
+
+// Shadows and outlines whose written pixels have orig_color again (offset_color == orig_color) or lose it
+// (Aplite long shadows, which always draw white) depend on the order of the per-pixel raster scan they
+// replace: a written pixel casts when the scan reaches it, or no longer does. offset_cascade keeps that
+// order. Rows of position are read one at a time after the rows above them have been written, and casting
+// to the right within a row is followed pixel by pixel. points holds count (dy, dx) pairs, equal dy adjacent.
+// Covered pixels get write_color (on Basalt unless they are orig_color); rows holds 3 framebuffer rows of bits
+static void offset_cascade(GBitmap *fb, GRect position, GColor orig_color, GColor write_color,
+                           const int8_t *points, int count, uint32_t *rows) {
+  uint8_t *bitmap_data = gbitmap_get_data(fb);
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  GRect bounds = gbitmap_get_bounds(fb);
+  int words = (bounds.size.w + 31) / 32;
+  uint32_t *cast = rows, *written = rows + words, *cover = rows + 2 * words;
+  uint32_t last_word = (bounds.size.w & 31) ? (1u << (bounds.size.w & 31)) - 1 : 0xFFFFFFFF;
+  bool grow = gcolor_equal(write_color, orig_color);
+  int x0 = position.origin.x, x1 = position.origin.x + position.size.w;
+
+  bool same_row = false;
+  for (int k = 0; k < count; ++k) same_row |= points[2 * k] == 0 && points[2 * k + 1] > 0;
+
+  for (int y = position.origin.y; y < position.origin.y + position.size.h; y++) {
+    // orig_color pixels of the row as the scan finds them
+    uint8_t *row = bitmap_data + y * bytes_per_row;
+    memset(cast, 0, words * sizeof(uint32_t));
+    #ifdef PBL_COLOR
+      for (int x = x0; x < x1; x++)
+        if (row[x] == orig_color.argb) cast[x >> 5] |= 1u << (x & 31);
+    #else
+      bitplane_blit((uint8_t*)cast, x0, row, x0, position.size.w, BitplaneCopy);
+      if (!gcolor_equal(orig_color, GColorWhite)) bitplane_apply((uint8_t*)cast, x0, x1, 1, 1);
+    #endif
+
+    // pixels written ahead of the scan in the same row join (grow) or leave the casting ones
+    if (same_row) {
+      memset(written, 0, words * sizeof(uint32_t));
+      for (int x = x0; x < x1; x++) {
+        bool orig = (cast[x >> 5] >> (x & 31)) & 1, hit = (written[x >> 5] >> (x & 31)) & 1;
+        if (grow ? !orig && !hit : !orig || hit) continue;
+        for (int k = 0; k < count; ++k) {
+          int target = x + points[2 * k + 1];
+          if (points[2 * k] == 0 && points[2 * k + 1] > 0 && target < x1) written[target >> 5] |= 1u << (target & 31);
+        }
+      }
+      for (int i = 0; i < words; ++i) cast[i] = grow ? cast[i] | written[i] : cast[i] & ~written[i];
+    }
+
+    uint32_t any = 0;
+    for (int i = 0; i < words; ++i) any |= cast[i];
+    if (!any) continue;
+
+    // cover of every target row, written before the scan reads the rows below
+    memset(cover, 0, words * sizeof(uint32_t));
+    for (int k = 0; k < count; ++k) {
+      or_shifted(cover, words, cast, words, points[2 * k + 1]);
+      if (k + 1 < count && points[2 * k + 2] == points[2 * k]) continue;
+      int target = y + points[2 * k];
+      if (target >= 0 && target < bounds.size.h) {
+        cover[words - 1] &= last_word;
+        #ifdef PBL_COLOR
+          cover_row_8bit(bitmap_data + target * bytes_per_row, cover, words, orig_color.argb, write_color.argb);
+        #else
+          bitplane_blit(bitmap_data + target * bytes_per_row, 0, (const uint8_t*)cover, 0, bounds.size.w,
+                        gcolor_equal(write_color, GColorWhite) ? BitplaneOr : BitplaneClear);
+        #endif
+      }
+      memset(cover, 0, words * sizeof(uint32_t));
+    }
+  }
+}
+
 // shadow effect.
-// see struct EffecOffset for parameter description  
+// see struct EffecOffset for parameter description
+// Pixels of orig_color in the rect are collected into a bitset (one bit per pixel), then every screen row
+// ORs the bitset rows that cast a shadow on it, shifted along the (long) shadow line. Covered pixels that
+// are neither orig_color nor offset_color get offset_color. When written pixels cast again (offset_color ==
+// orig_color) the rows are run in scan order by offset_cascade instead. On Aplite a long shadow turns every
+// pixel of its lines white, and a plain shadow only changes something when offset_color == orig_color
 void effect_shadow(GContext* ctx, GRect position, void* param) {
-  GColor temp_pixel;  
-  int shadow_x, shadow_y;
   EffectOffset *shadow = (EffectOffset *)param;
-  
-  #ifndef PBL_COLOR
-    uint8_t draw_color = gcolor_equal(shadow->offset_color, GColorWhite)? 1 : 0;
-    uint8_t skip_color = gcolor_equal(shadow->orig_color, GColorWhite)? 1 : 0;
+  if (position.size.w <= 0 || position.size.h <= 0) return;
+  #ifdef PBL_COLOR
+    bool cascade = gcolor_equal(shadow->orig_color, shadow->offset_color);
+    GColor write_color = shadow->offset_color;
+  #else
+    if (!gcolor_equal(shadow->orig_color, GColorWhite) && !gcolor_equal(shadow->orig_color, GColorBlack)) return;
+    if (shadow->option != 1 && !gcolor_equal(shadow->orig_color, shadow->offset_color)) return;
+    bool cascade = true;
+    GColor write_color = shadow->option == 1 ? GColorWhite : shadow->orig_color;
   #endif
-  
+
    //capturing framebuffer bitmap
-  GBitmap *fb = graphics_capture_frame_buffer(ctx);
-  
-  BitmapInfo bitmap_info;
-  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
-  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
-  bitmap_info.bitmap_format = gbitmap_get_format(fb);
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  if (!effect_clip(fb, &position)) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  uint8_t *bitmap_data = gbitmap_get_data(fb);
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  GRect bounds = gbitmap_get_bounds(fb);
+
+  int mask_words = (position.size.w + 31) / 32;
+  int cover_words = (bounds.size.w + 31) / 32;
+  int mask_size = cascade ? 2 * cover_words : position.size.h * mask_words;
+  int max_points = 1 + (abs(shadow->offset_x) > abs(shadow->offset_y) ? abs(shadow->offset_x) : abs(shadow->offset_y));
+  uint32_t *mask = effect_scratch((mask_size + cover_words) * sizeof(uint32_t) + 2 * max_points);
+  if (!mask) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  uint32_t *cover = mask + mask_size;
+  int8_t *offsets = (int8_t*)(cover + cover_words);
+
+  // shadow line (or single offset) and the rows it reaches
+  int points = 1;
+  offsets[0] = shadow->offset_y;
+  offsets[1] = shadow->offset_x;
+  if (shadow->option == 1) points = shadow_line(shadow->offset_y, shadow->offset_x, offsets);
+  int min_dy = 0, max_dy = 0;
+  for (int k = 0; k < points; ++k) {
+    if (offsets[2 * k] < min_dy) min_dy = offsets[2 * k];
+    if (offsets[2 * k] > max_dy) max_dy = offsets[2 * k];
+  }
+  if (cascade) {
+    offset_cascade(fb, position, shadow->orig_color, write_color, offsets, points, mask);
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+
+  // bitset of orig_color pixels in the rect
+  color_mask(bitmap_data, bytes_per_row, position, shadow->orig_color, mask, mask_words, effect_shadow);
+
+  // edge of the last cover word (padding pixels are never touched)
+  uint32_t last_word = (bounds.size.w & 31) ? (1u << (bounds.size.w & 31)) - 1 : 0xFFFFFFFF;
+
+  int y0 = position.origin.y + min_dy, y1 = position.origin.y + position.size.h - 1 + max_dy;
+  if (y0 < 0) y0 = 0;
+  if (y1 > bounds.size.h - 1) y1 = bounds.size.h - 1;
+  for (int y = y0; y <= y1; y++) {
+    memset(cover, 0, cover_words * sizeof(uint32_t));
+    for (int k = 0; k < points; ++k) {
+      int source = y - offsets[2 * k] - position.origin.y;
+      if (source >= 0 && source < position.size.h)
+        or_shifted(cover, cover_words, mask + source * mask_words, mask_words, position.origin.x + offsets[2 * k + 1]);
+    }
+    cover[cover_words - 1] &= last_word;
+
+    #ifdef PBL_COLOR // offset_color pixels stay offset_color anyway (Aplite always cascades)
+      cover_row_8bit(bitmap_data + y * bytes_per_row, cover, cover_words, shadow->orig_color.argb, shadow->offset_color.argb);
+    #endif
+  }
+
+  effect_release_frame_buffer(ctx, fb);
 
-  
-  //looping throughout making shadow
-  for (int y = 0; y < position.size.h; y++)
-     for (int x = 0; x < position.size.w; x++) {
-       temp_pixel = (GColor)get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x);
-       
-       if (gcolor_equal(temp_pixel, shadow->orig_color)) {
-         shadow_x =  x + position.origin.x + shadow->offset_x;
-         shadow_y =  y + position.origin.y + shadow->offset_y;
-         
-         if (shadow->option == 1) {
-            #ifdef PBL_COLOR // for Basalt simple calling line-drawing routine
-               set_line(bitmap_info, y + position.origin.y, x + position.origin.x, shadow_y, shadow_x, shadow->offset_color.argb, shadow->orig_color.argb, NULL);
-            #else // for Aplite - passing user-defined array to determine if pixels have been set or not
-               set_line(bitmap_info, y + position.origin.y, x + position.origin.x, shadow_y, shadow_x, draw_color, skip_color, shadow->aplite_visited); 
-            #endif
-           
-         } else {
-           
-             if (shadow_x >= 0 && shadow_x <=143 && shadow_y >= 0 && shadow_y <= 167) {
-             
-               temp_pixel = (GColor)get_pixel(bitmap_info, shadow_y, shadow_x);
-               if (!gcolor_equal(temp_pixel, shadow->orig_color) & !gcolor_equal(temp_pixel, shadow->offset_color) ) {
-                 #ifdef PBL_COLOR
-                    set_pixel(bitmap_info,  shadow_y, shadow_x, shadow->offset_color.argb);  
-                 #else
-                    set_pixel(bitmap_info,  shadow_y, shadow_x, gcolor_equal(shadow->offset_color, GColorWhite)? 1 : 0);
-                 #endif
-               }
-             }
-           
-         }
-         
-         
-       }
-  }
-         
-  graphics_release_frame_buffer(ctx, fb);
- 
 }
 
+// outline effect.
+// see struct EffecOffset for parameter description
+// Pixels around orig_color ones get offset_color: option 0 uses the 4 diagonal points at (+-offset_x, +-offset_y),
+// option 4 a diamond of radius offset_x (4-connected), option 8 a box of offset_x by offset_y (8-connected).
+// This is a dilation of the orig_color bitset: each screen row ORs the shifted source rows, widened by shift-OR
+// doubling. With option 0 and offset_color == orig_color the outlined pixels are outlined in turn, so those
+// run in scan order by offset_cascade. On Aplite pixels that are not orig_color already have offset_color
+// unless it is orig_color, so only that case changes anything: options 4 and 8 dilate the orig_color pixels
+// a word at a time, option 0 cascades
 void effect_outline(GContext* ctx, GRect position, void* param) {
-  GColor temp_pixel;  
-  int outlinex[4];
-  int outliney[4];
   EffectOffset *outline = (EffectOffset *)param;
-  
+  if (position.size.w <= 0 || position.size.h <= 0) return;
+  int option = outline->option;
+  #ifndef PBL_COLOR
+    if (!gcolor_equal(outline->orig_color, GColorWhite) && !gcolor_equal(outline->orig_color, GColorBlack)) return;
+    if (!gcolor_equal(outline->orig_color, outline->offset_color)) return;
+  #endif
+
+  int rx = abs(outline->offset_x), ry = abs(outline->offset_y);
+  if (option == 4) ry = rx;
+  int entries = option == 4 || option == 8 ? 2 * ry + 1 : 4;
+  bool cascade = entries == 4 && gcolor_equal(outline->orig_color, outline->offset_color);
+
    //capturing framebuffer bitmap
-  GBitmap *fb = graphics_capture_frame_buffer(ctx);
-  
-  BitmapInfo bitmap_info;
-  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
-  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
-  bitmap_info.bitmap_format = gbitmap_get_format(fb);
+  GBitmap *fb = effect_capture_frame_buffer(ctx);
+  if (!effect_clip(fb, &position)) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  uint8_t *bitmap_data = gbitmap_get_data(fb);
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  GRect bounds = gbitmap_get_bounds(fb);
 
-  
-  //loop through pixels from framebuffer
-  for (int y = 0; y < position.size.h; y++)
-     for (int x = 0; x < position.size.w; x++) {
-       temp_pixel = (GColor)get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x);
-       
-       if (gcolor_equal(temp_pixel, outline->orig_color)) {
-          // TODO: there's probably a more efficient way to do this
-          outlinex[0] = x + position.origin.x - outline->offset_x;
-          outliney[0] = y + position.origin.y - outline->offset_y;
-          outlinex[1] = x + position.origin.x + outline->offset_x;
-          outliney[1] = y + position.origin.y + outline->offset_y;
-          outlinex[2] = x + position.origin.x - outline->offset_x;
-          outliney[2] = y + position.origin.y + outline->offset_y;
-          outlinex[3] = x + position.origin.x + outline->offset_x;
-          outliney[3] = y + position.origin.y - outline->offset_y;
-          
-         
-          for (int i = 0; i < 4; i++) {
-            // TODO: centralize the constants
-            if (outlinex[i] >= 0 && outlinex[i] <=144 && outliney[i] >= 0 && outliney[i] <= 168) {
-              temp_pixel = (GColor)get_pixel(bitmap_info, outliney[i], outlinex[i]);
-              if (!gcolor_equal(temp_pixel, outline->orig_color)) {
-                #ifdef PBL_COLOR
-                   set_pixel(bitmap_info, outliney[i], outlinex[i], outline->offset_color.argb);  
-                #else
-                   set_pixel(bitmap_info, outliney[i], outlinex[i], gcolor_equal(outline->offset_color, GColorWhite)? 1 : 0);
-                #endif
-              }
-            }
-          }
-       }
+  int mask_words = (position.size.w + 31) / 32;
+  int cover_words = (bounds.size.w + 31) / 32;
+  uint32_t *mask = effect_scratch((position.size.h * mask_words + 3 * cover_words) * sizeof(uint32_t) + 3 * entries);
+  if (!mask) {
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+  uint32_t *cover = mask + position.size.h * mask_words;
+  uint32_t *acc = cover + cover_words, *temp = acc + cover_words;
+  int8_t *entry = (int8_t*)(temp + cover_words);
+
+  // written pixels are orig_color and get outlined in turn when the scan reaches them
+  if (cascade) {
+    for (int k = 0; k < 4; ++k) {
+      entry[2 * k]     = (k & 2) ? ry : -ry;
+      entry[2 * k + 1] = (k & 1) ? rx : -rx;
+    }
+    offset_cascade(fb, position, outline->orig_color, outline->orig_color, entry, 4, mask);
+    effect_release_frame_buffer(ctx, fb);
+    return;
+  }
+
+  // structuring element as (dy, dx, half width) rows; rows of equal width are adjacent so they are widened once
+  for (int k = 0; k < entries; ++k) {
+    if (entries == 4) {
+      entry[3 * k]     = (k & 1) ? ry : -ry;
+      entry[3 * k + 1] = (k & 2) ? rx : -rx;
+      entry[3 * k + 2] = 0;
+    } else {
+      int dy = (k + 1) / 2;
+      entry[3 * k]     = (k & 1) ? dy : -dy;
+      entry[3 * k + 1] = 0;
+      entry[3 * k + 2] = outline->option == 4 ? rx - dy : rx;
+    }
+  }
+
+  // bitset of orig_color pixels in the rect
+  color_mask(bitmap_data, bytes_per_row, position, outline->orig_color, mask, mask_words, effect_outline);
+
+  // edge of the last cover word (padding pixels are never touched)
+  uint32_t last_word = (bounds.size.w & 31) ? (1u << (bounds.size.w & 31)) - 1 : 0xFFFFFFFF;
+
+  int y0 = position.origin.y - ry, y1 = position.origin.y + position.size.h - 1 + ry;
+  if (y0 < 0) y0 = 0;
+  if (y1 > bounds.size.h - 1) y1 = bounds.size.h - 1;
+  for (int y = y0; y <= y1; y++) {
+    bool any = false;
+    memset(cover, 0, cover_words * sizeof(uint32_t));
+    memset(acc, 0, cover_words * sizeof(uint32_t));
+    for (int k = 0; k < entries; ++k) {
+      int source = y - entry[3 * k] - position.origin.y;
+      if (source >= 0 && source < position.size.h) {
+        or_shifted(acc, cover_words, mask + source * mask_words, mask_words, position.origin.x + entry[3 * k + 1]);
+        any = true;
+      }
+      if (any && (k == entries - 1 || entry[3 * k + 5] != entry[3 * k + 2])) {
+        smear_row(acc, temp, cover_words, entry[3 * k + 2]);
+        for (int i = 0; i < cover_words; ++i) cover[i] |= acc[i];
+        memset(acc, 0, cover_words * sizeof(uint32_t));
+        any = false;
+      }
+    }
+    cover[cover_words - 1] &= last_word;
+
+    #ifdef PBL_COLOR
+      cover_row_8bit(bitmap_data + y * bytes_per_row, cover, cover_words, outline->orig_color.argb, outline->offset_color.argb);
+    #else // offset_color is orig_color here
+      bitplane_blit(bitmap_data + y * bytes_per_row, 0, (const uint8_t*)cover, 0, bounds.size.w,
+                    gcolor_equal(outline->orig_color, GColorWhite) ? BitplaneOr : BitplaneClear);
+    #endif
   }
 
-  graphics_release_frame_buffer(ctx, fb);
+  effect_release_frame_buffer(ctx, fb);
 }
@@ -8,6 +8,9 @@ typedef struct {
    GBitmapFormat bitmap_format;
 }  BitmapInfo;
   
+// span list and converted background kept by effect_mask between frames
+typedef struct EffectMaskCache EffectMaskCache;
+
 // structure of mask for masking effects
 typedef struct {
   GBitmap*  bitmap_mask; // bitmap used for mask (when masking by bitmap)
@@ -18,6 +21,7 @@ typedef struct {
   GFont     font; // font used for text mask;
   GTextOverflowMode text_overflow; // overflow used for text mask;
   GTextAlignment  text_align; // alignment used for text masks
+  EffectMaskCache *cache; // managed by effect_mask (start with NULL, free with effect_mask_reset)
 } EffectMask;  
 
 // structure for FPS effect
@@ -33,8 +37,8 @@ typedef struct {
   GColor offset_color; //new color of pixel at offset coords
   int8_t offset_x; // horizontal ofset
   int8_t offset_y; // vertical offset
-  int8_t option; // optional parameter (currently in effect_shadow 1=draw long shadow)
-  uint8_t *aplite_visited; // for Applite holds array of visited pixels
+  int8_t option; // optional parameter (effect_shadow: 1=draw long shadow, effect_outline: 4/8=connectivity)
+  uint8_t *aplite_visited; // no longer used (shadows are tracked with a bitset), kept for compatibility
 } EffectOffset;  
 
 // structure for color swap effect
@@ -43,8 +47,71 @@ typedef struct {
   GColor secondColor; // second color (new color for colorize, other of set in colorswap)
 } EffectColorpair;
 
+// structure for palette map effect: every pixel of color c becomes lut[c.argb]
+typedef struct {
+  uint8_t lut[256];
+} EffectPalette;
+
 typedef void effect_cb(GContext* ctx, GRect position, void* param);
 
+// scratch memory shared by effects (kept between calls, grown on demand)
+void* effect_scratch(size_t size);
+
+// Framebuffer access for effects. Between effect_frame_begin and effect_frame_end (EffectLayer wraps its
+// effect chain with them) the framebuffer is captured once and shared: effect_release_frame_buffer keeps it
+// and effects that draw through the context call effect_frame_flush first. Outside of a chain these
+// behave like graphics_capture_frame_buffer/graphics_release_frame_buffer
+void effect_frame_begin(GContext *ctx);
+void effect_frame_flush(GContext *ctx);
+void effect_frame_end(GContext *ctx);
+GBitmap* effect_capture_frame_buffer(GContext *ctx);
+void effect_release_frame_buffer(GContext *ctx, GBitmap *fb);
+
+// runs effect like effect(ctx, position, param); inside a chain an effect that is not from this library gets
+// the framebuffer released first, so callbacks that capture it (or draw) themselves keep working
+void effect_call(effect_cb *effect, GContext *ctx, GRect position, void *param);
+
+// bounds of effect rects: effect_clip narrows position to the framebuffer and returns false when nothing
+// is left, so kernels then index position without per-pixel checks. Kernels that read outside position
+// (lens) run an interior whose reads stay inside the framebuffer unchecked and clamp only a border band
+bool effect_clip(GBitmap *fb, GRect *position);
+
+// saved copies of screen areas (rect inside the framebuffer, see effect_clip), used to put back the output of
+// effects that are not run again: effect_saved_size bytes hold the pixels of rect
+size_t effect_saved_size(GRect rect);
+void effect_save_rect(GBitmap *fb, GRect rect, uint8_t *data);
+void effect_restore_rect(GBitmap *fb, GRect rect, const uint8_t *data);
+
+// tile summaries: effects look at the screen in EFFECT_TILE x EFFECT_TILE tiles (aligned to the screen) and
+// skip or fill uniform ones instead of touching every pixel. effect_tile_summary gives, for the tiles
+// covering position (row by row, only pixels inside position count), the tile color (argb, black or white
+// on Aplite) or EFFECT_TILE_MIXED; the summary is overwritten by the next call, NULL when out of memory
+#define EFFECT_TILE 16
+#define EFFECT_TILE_MIXED 0xFFFF
+uint16_t* effect_tile_summary(const uint8_t *bitmap_data, int bytes_per_row, GRect position, int *cols, int *rows);
+
+// tile counters per effect: tiles looked at and tiles that were skipped or filled without per-pixel work.
+// Only effect_blur, effect_shadow and effect_outline use tile summaries, and only on Basalt: other effects,
+// and all effects on Aplite (which already work on 32 pixels at a time), leave their counters at 0.
+// EffectLayer itself does not split its chain into tiles
+typedef struct {
+  uint32_t tiles;
+  uint32_t skipped;
+} EffectTileStats;
+void effect_count_tiles(effect_cb *effect, uint32_t tiles, uint32_t skipped);
+void effect_get_tile_stats(effect_cb *effect, EffectTileStats *stats);
+void effect_reset_tile_stats(void);
+
+// debug counter: number of framebuffer captures made by effects since the last reset (a chain that shares
+// its capture counts once, plus once more after each flush)
+uint32_t effect_get_capture_count(void);
+void effect_reset_capture_count(void);
+
+// debug counter: number of effect passes over their rect run through effect_call (every EffectLayer entry,
+// a fused run of colour effects counts once; effect_cached and effect_run count the effect they call)
+uint32_t effect_get_pass_count(void);
+void effect_reset_pass_count(void);
+
 // inverter effect.
 // Added by Yuriy Galanter
 effect_cb effect_invert;
@@ -63,6 +130,99 @@ effect_cb effect_invert_bw_only;
 // Invert brightness of colors (retains hue, does not apply to black and white)
 effect_cb effect_invert_brightness;
 
+// palette map effect: one table lookup per pixel.
+// uses EffectPalette as a parameter, build it with effect_palette_init and chain
+// effect_palette_add_* / effect_palette_compose to merge several color effects into one pass
+effect_cb effect_palette_map;
+
+void effect_palette_init(EffectPalette *palette);
+void effect_palette_compose(EffectPalette *palette, const EffectPalette *next);
+void effect_palette_add_invert(EffectPalette *palette);
+void effect_palette_add_colorize(EffectPalette *palette, EffectColorpair *paint);
+void effect_palette_add_colorswap(EffectPalette *palette, EffectColorpair *swap);
+void effect_palette_add_invert_bw_only(EffectPalette *palette);
+void effect_palette_add_invert_brightness(EffectPalette *palette);
+
+// fade effect: mixes the rect towards color by level/16 (0 leaves it, 16 fills it with color).
+// On Aplite the rect is filled with color from level 8 on
+typedef struct {
+  GColor color;
+  uint8_t level; // 0..16
+} EffectFade;
+
+effect_cb effect_fade;
+void effect_palette_add_fade(EffectPalette *palette, EffectFade *fade);
+
+// blend effect: draws a translucent overlay over the rect. The overlay is bitmap (GBitmapFormat8Bit, its alpha
+// is used; top left corner at the rect origin, clipped to its size) or, when bitmap is NULL, color (with its
+// alpha) over the whole rect. opacity scales the overlay's alpha. On Aplite the overlay (a GBitmapFormat1Bit
+// bitmap or color) is drawn as is when its opacity is at least 8/16, otherwise not at all
+typedef struct {
+  GBitmap *bitmap;
+  GColor color;
+  uint8_t opacity; // 0 (invisible) .. 16 (overlay alpha as is)
+} EffectBlend;
+
+effect_cb effect_blend;
+// fade level (0..16) a color blend amounts to: the color's alpha (0..3) scaled by opacity
+uint8_t effect_blend_weight(const EffectBlend *blend);
+
+// appends any of the pixel-local effects above (invert, invert_bw_only, colorize, colorswap,
+// invert_brightness, palette_map, fade, blend of a color) to a palette, returns false for other effects
+bool effect_palette_add_effect(EffectPalette *palette, effect_cb *effect, void *param);
+
+// margin (in pixels) of neighbours an effect reads around the pixels it changes, so it can update a dirty
+// area by reading that area grown by that much instead of its whole rect. EFFECT_HALO_FRAME: the effect depends on the whole
+// rect (mirrors, rotation, zoom, lens, mask, fps, shadows and outlines that cascade, and any effect this
+// library doesn't know)
+#define EFFECT_HALO_FRAME -1
+int16_t effect_halo(effect_cb *effect, void *param);
+
+// Effects with a lifecycle and typed parameters. An EffectType splits an effect into prepare (builds tables
+// from the parameters, called again only when they change), apply (the per frame work) and destroy (frees
+// what prepare built). An EffectInstance binds a type to its parameters and prepared state; effect_run is
+// an effect_cb taking the instance, so instances go into EffectLayer like any other effect:
+//   effect_instance_init(&lens, &effect_type_lens, &lens_params);
+//   effect_layer_add_effect(layer, effect_run, &lens);
+typedef struct {
+  size_t param_size; // bytes of the typed parameters, compared to decide when to prepare again
+  size_t state_size; // bytes of prepared state per instance (zeroed before the first prepare, 0: none)
+  bool rect_sized; // prepared state also depends on the rect size (prepared again when it changes)
+  bool palette; // prepared state is an EffectPalette, so the instance fuses with other colour effects
+  bool (*prepare)(void *state, const void *param, GRect position); // NULL: nothing to prepare
+  void (*apply)(GContext *ctx, GRect position, const void *param, void *state);
+  void (*destroy)(void *state); // frees what prepare allocated inside state, NULL: nothing
+  int16_t (*halo)(const void *param); // see effect_halo, NULL: EFFECT_HALO_FRAME
+} EffectType;
+
+typedef struct {
+  const EffectType *type;
+  const void *param; // typed parameters, may be changed in place between frames
+  // managed by effect_run
+  void *state;
+  void *prepared_param; // copy of the parameters state was prepared for
+  GSize prepared_size;
+  bool prepared;
+} EffectInstance;
+
+void effect_instance_init(EffectInstance *instance, const EffectType *type, const void *param);
+bool effect_instance_prepare(EffectInstance *instance, GRect position);
+void effect_instance_destroy(EffectInstance *instance);
+effect_cb effect_run;
+
+// compatibility: any plain effect_cb as an EffectType, its param is passed through unchanged
+typedef struct {
+  effect_cb *effect;
+  void *param;
+} EffectCallback;
+
+extern const EffectType effect_type_callback;
+
+// colour effects whose palette is built once by prepare (parameters: EffectColorpair, none)
+extern const EffectType effect_type_colorize;
+extern const EffectType effect_type_colorswap;
+extern const EffectType effect_type_invert_brightness;
+
 // vertical mirror effect.
 // Added by Yuriy Galanter
 effect_cb effect_mirror_vertical;
@@ -79,9 +239,22 @@ effect_cb effect_rotate_90_degrees;
 
 // blur effect.
 // Added by Grégoire Sage
-// Parameter: blur radius
+// Parameter: blur radius (low byte) and number of box blur passes (high byte, 0 is same as 1)
+// use the macro EL_BLUR(3,3). In this example: radius 3, 3 passes (approximates a gaussian blur)
+// On Aplite the share of white pixels in each window is dithered back to black and white (4x4 Bayer), in one
+// pass whose box has the variance of the requested passes
 effect_cb effect_blur;
 
+#define EL_BLUR(r,p) ((void*)((r)|((p)<<8)))
+
+// typed blur parameters for effect_type_blur
+typedef struct {
+  uint8_t radius;
+  uint8_t passes; // 0 is same as 1
+} EffectBlurParams;
+
+extern const EffectType effect_type_blur;
+
 // Zoom effect
 // Added by Ron64
 // Parameter: Y zoom (high byte) X zoom(low byte),  0x10 no zoom 0x20 200% 0x08 50%, 
@@ -89,6 +262,17 @@ effect_cb effect_blur;
 effect_cb effect_zoom;
 
 #define EL_ZOOM(x,y) ((void*)((((y)*16/100)|(((x)*16/100)<<8))))
+#define EL_ZOOM_BILINEAR_FLAG 0x10000
+#define EL_ZOOM_BILINEAR(x,y) ((void*)((uint32_t)EL_ZOOM(x,y)|EL_ZOOM_BILINEAR_FLAG))
+
+// typed zoom parameters for effect_type_zoom, ratios in 1/16 like EL_ZOOM (16 no zoom, 32 200%, 8 50%)
+typedef struct {
+  uint8_t ratio_x;
+  uint8_t ratio_y;
+  bool bilinear; // Basalt only
+} EffectZoomParams;
+
+extern const EffectType effect_type_zoom;
 
 // Lens effect
 // Added by Ron64
@@ -97,12 +281,24 @@ effect_cb effect_lens;
 
 #define EL_LENS(f,d) ((void*) ( d|(f<<8)))
 
+// typed lens parameters for effect_type_lens; every instance keeps its own displacement table
+typedef struct {
+  uint8_t focal;
+  uint8_t obj_dis;
+} EffectLensParams;
+
+extern const EffectType effect_type_lens;
+
 
 // mask effect.
 // Added by Yuriy Galanter
 // see struct EffectMask for parameter description
 effect_cb effect_mask;
 
+// frees the span cache of a mask; the next effect_mask call rebuilds it
+// (needed when the mask or background bitmap pixels are changed in place)
+void effect_mask_reset(EffectMask *mask);
+
 // Just displays the average FPS of the app
 // Probably works better on a fullscreen effect layer so it can catch all redraw messages
 effect_cb effect_fps;
@@ -112,4 +308,66 @@ effect_cb effect_fps;
 // uses EffecOffset as a parameter;
 effect_cb effect_shadow;
 
+// cached effect: remembers the output of an expensive effect (blur, lens, shadow, outline...) and copies it
+// back instead of running the effect again while the rect, its parameters and the pixels it reads (the rect
+// grown by effect_halo, the whole screen for EFFECT_HALO_FRAME) are unchanged. Results share one LRU cache
+// bounded by effect_cache_set_budget; with a budget of 0 effects always run
+typedef struct {
+  effect_cb *effect; // effect to run
+  void *param; // its parameter
+  size_t param_size; // bytes of *param that make up the parameters (0: the param pointer itself is the value, like EL_BLUR)
+} EffectCached;
+
+typedef struct {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+  size_t bytes; // memory held by cached results
+} EffectCacheStats;
+
+#ifdef PBL_COLOR
+  #define EFFECT_CACHE_DEFAULT_BUDGET (24 * 1024) // room for one full Basalt screen
+#else
+  #define EFFECT_CACHE_DEFAULT_BUDGET 0 // off: a full screen of results would take a big part of Aplite's heap
+#endif
+
+effect_cb effect_cached;
+void effect_cache_set_budget(size_t bytes);
+void effect_cache_clear(void);
+void effect_cache_get_stats(EffectCacheStats *stats);
+
+// Shapes: non-rectangular effect regions stored as [x0, x1) spans per row, built once so effects touch only
+// covered pixels instead of testing each pixel of a rect. Coordinates are relative to the rect the effect
+// runs on (like EffectLayer sub-rects), spans are sorted by row then x and do not overlap.
+// Start from an all zero EffectShape; the builders replace its spans and return false when out of memory
+typedef struct {
+  int16_t y, x0, x1;
+} EffectSpan;
+
+typedef struct {
+  EffectSpan *spans;
+  uint16_t count;
+  uint16_t capacity;
+} EffectShape;
+
+bool effect_shape_circle(EffectShape *shape, GPoint centre, uint16_t radius);
+bool effect_shape_annulus(EffectShape *shape, GPoint centre, uint16_t inner_radius, uint16_t outer_radius);
+bool effect_shape_round_rect(EffectShape *shape, GRect rect, uint16_t corner_radius);
+bool effect_shape_polygon(EffectShape *shape, const GPoint *points, uint16_t num_points);
+void effect_shape_destroy(EffectShape *shape);
+
+// shaped effect: limits effect to the pixels of shape. Colour effects (see effect_palette_add_effect) only
+// run on the spans; any other effect runs on the whole rect and the pixels outside the spans are put back
+typedef struct {
+  const EffectShape *shape;
+  effect_cb *effect;
+  void *param;
+} EffectShaped;
+
+effect_cb effect_shaped;
+
+// outline effect
+// uses EffecOffset as a parameter: option 0 marks the 4 diagonal points at (+-offset_x, +-offset_y),
+// option 4 a diamond of radius offset_x, option 8 a box of offset_x by offset_y around each orig_color pixel.
+// On Aplite only offset_color == orig_color changes anything (other pixels already have the other color)
 effect_cb effect_outline;
@@ -0,0 +1,756 @@
+#include <pebble.h>
+#include "effects.h"
+#include "math.h"
+
+// The per-pixel effects of the library before they were rewritten, kept as references for the tests and
+// benchmarks. Code is as it was, helpers are static and effects have a baseline_ prefix
+
+// set pixel color at given coordinates
+static void set_pixel(BitmapInfo bitmap_info, int y, int x, uint8_t color) {
+
+#ifdef PBL_PLATFORM_BASALT
+  if (bitmap_info.bitmap_format == GBitmapFormat1BitPalette) { // for 1bit palette bitmap on Basalt --- verify if it needs to be different
+     bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x / 8] ^= (-color ^ bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x / 8]) & (1 << (x % 8));
+#else
+  if (bitmap_info.bitmap_format == GBitmapFormat1Bit) { // for 1 bit bitmap on Aplite  --- verify if it needs to be different
+     bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x / 8] ^= (-color ^ bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x / 8]) & (1 << (x % 8));
+#endif
+  } else { // othersise (assuming GBitmapFormat8Bit) going byte-wise
+     bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x] = color;
+  }
+
+}
+
+// get pixel color at given coordinates
+static uint8_t get_pixel(BitmapInfo bitmap_info, int y, int x) {
+
+#ifdef PBL_PLATFORM_BASALT
+  if (bitmap_info.bitmap_format == GBitmapFormat1BitPalette) { // for 1bit palette bitmap on Basalt shifting left to get correct bit
+    return (bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x / 8] << (x % 8)) & 128;
+#else
+  if (bitmap_info.bitmap_format == GBitmapFormat1Bit) { // for 1 bit bitmap on Aplite - shifting right to get bit
+    return (bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x / 8] >> (x % 8)) & 1;
+#endif
+  } else {  // othersise (assuming GBitmapFormat8Bit) going byte-wise
+    return bitmap_info.bitmap_data[y*bitmap_info.bytes_per_row + x];
+  }
+
+}
+
+// inverter effect.
+void baseline_effect_invert(GContext* ctx,  GRect position, void* param) {
+  //capturing framebuffer bitmap
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+  BitmapInfo bitmap_info;
+  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
+  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  bitmap_info.bitmap_format = gbitmap_get_format(fb);
+
+  for (int y = 0; y < position.size.h; y++)
+     for (int x = 0; x < position.size.w; x++)
+        #ifdef PBL_COLOR // on Basalt simple doing NOT on entire returned byte/pixel
+          set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, (~get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x))|11000000);
+        #else // on Aplite since only 1 and 0 is returning, doing "not" by 1 - pixel
+          set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, 1 - get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x));
+        #endif
+
+  graphics_release_frame_buffer(ctx, fb);
+
+}
+
+// colorize effect - given a target color, replace it with a new color
+// Added by Martin Norland (@cynorg)
+// Parameter:  GColor firstColor, GColor secondColor
+void baseline_effect_colorize(GContext* ctx,  GRect position, void* param) {
+#ifdef PBL_COLOR // only logical to do anything on Basalt - otherwise you're just ... drawing a black|white GRect
+  //capturing framebuffer bitmap
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+  BitmapInfo bitmap_info;
+  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
+  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  bitmap_info.bitmap_format = gbitmap_get_format(fb);
+
+  EffectColorpair *paint = (EffectColorpair *)param;
+
+  for (int y = 0; y < position.size.h; y++){
+     for (int x = 0; x < position.size.w; x++){
+        if (gcolor_equal((GColor)get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x), paint->firstColor)){
+           set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, (uint8_t)paint->secondColor.argb);
+        }
+     }
+  }
+  graphics_release_frame_buffer(ctx, fb); // was released inside the row loop, once per row
+#endif
+}
+
+
+// colorswap effect - swaps two colors in a given area
+// Added by Martin Norland (@cynorg)
+// Parameter:  GColor firstColor, GColor secondColor
+void baseline_effect_colorswap(GContext* ctx,  GRect position, void* param) {
+#ifdef PBL_COLOR // only logical to do anything on Basalt - otherwise you're just ... doing an invert
+  //capturing framebuffer bitmap
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+  BitmapInfo bitmap_info;
+  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
+  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  bitmap_info.bitmap_format = gbitmap_get_format(fb);
+
+  EffectColorpair *swap = (EffectColorpair *)param;
+  GColor pixel;
+
+  for (int y = 0; y < position.size.h; y++){
+     for (int x = 0; x < position.size.w; x++){
+          pixel.argb = get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x);
+          if (gcolor_equal(pixel, swap->firstColor))
+            set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, swap->secondColor.argb);
+          else if (gcolor_equal(pixel, swap->secondColor))
+            set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, swap->firstColor.argb);
+     }
+  }
+  graphics_release_frame_buffer(ctx, fb); // was released inside the row loop, once per row
+#endif
+}
+
+// invert black and white only (leaves all other colors intact).
+void baseline_effect_invert_bw_only(GContext* ctx,  GRect position, void* param) {
+  //capturing framebuffer bitmap
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+  BitmapInfo bitmap_info;
+  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
+  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  bitmap_info.bitmap_format = gbitmap_get_format(fb);
+
+#ifdef PBL_COLOR
+  GColor pixel;
+#endif
+
+  for (int y = 0; y < position.size.h; y++) {
+     for (int x = 0; x < position.size.w; x++) {
+        #ifdef PBL_COLOR // on Basalt invert only black or white
+          pixel.argb = get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x);
+          if (gcolor_equal(pixel, GColorBlack))
+            set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, GColorWhite.argb);
+          else if (gcolor_equal(pixel, GColorWhite))
+            set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, GColorBlack.argb);
+        #else // on Aplite since only 1 and 0 is returning, doing "not" by 1 - pixel
+          set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, 1 - get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x));
+        #endif
+     }
+  }
+
+  graphics_release_frame_buffer(ctx, fb);
+
+}
+
+// invert brightness of colors (leaves hue more or less intact and does not apply to black and white).
+void baseline_effect_invert_brightness(GContext* ctx,  GRect position, void* param) {
+#ifdef PBL_COLOR
+  //capturing framebuffer bitmap
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+  BitmapInfo bitmap_info;
+  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
+  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  bitmap_info.bitmap_format = gbitmap_get_format(fb);
+
+  GColor pixel;
+  GColor pixel_new = GColorClear; // was uninitialized (only colors with alpha miss the list below)
+
+  for (int y = 0; y < position.size.h; y++) {
+     for (int x = 0; x < position.size.w; x++) {
+         pixel.argb = get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x);
+
+         if (!gcolor_equal(pixel, GColorBlack) && !gcolor_equal(pixel, GColorWhite)) {
+           // Only apply if not black/white (add effect_invert_bw_only for that too)
+
+           // Color spread is not even, so need to handcraft the opposing brightness of colors,
+           // which is probably subjective and open for improvement
+           if (gcolor_equal(pixel, GColorOxfordBlue))
+             pixel_new = GColorCeleste;
+           else if (gcolor_equal(pixel, GColorDukeBlue))
+             pixel_new = GColorVividCerulean;
+           else if (gcolor_equal(pixel, GColorBlue))
+             pixel_new = GColorPictonBlue;
+           else if (gcolor_equal(pixel, GColorDarkGreen))
+             pixel_new = GColorMintGreen;
+           else if (gcolor_equal(pixel, GColorMidnightGreen))
+             pixel_new = GColorMediumSpringGreen;
+           else if (gcolor_equal(pixel, GColorCobaltBlue))
+             pixel_new = GColorCyan;
+           else if (gcolor_equal(pixel, GColorBlueMoon))
+             pixel_new = GColorElectricBlue;
+           else if (gcolor_equal(pixel, GColorIslamicGreen))
+             pixel_new = GColorMalachite;
+           else if (gcolor_equal(pixel, GColorJaegerGreen))
+             pixel_new = GColorScreaminGreen;
+           else if (gcolor_equal(pixel, GColorTiffanyBlue))
+             pixel_new = GColorCadetBlue;
+           else if (gcolor_equal(pixel, GColorVividCerulean))
+             pixel_new = GColorDukeBlue;
+           else if (gcolor_equal(pixel, GColorGreen))
+             pixel_new = GColorMayGreen;
+           else if (gcolor_equal(pixel, GColorMalachite))
+             pixel_new = GColorIslamicGreen;
+           else if (gcolor_equal(pixel, GColorMediumSpringGreen))
+             pixel_new = GColorMidnightGreen;
+           else if (gcolor_equal(pixel, GColorCyan))
+             pixel_new = GColorCobaltBlue;
+           else if (gcolor_equal(pixel, GColorBulgarianRose))
+             pixel_new = GColorMelon;
+           else if (gcolor_equal(pixel, GColorImperialPurple))
+             pixel_new = GColorRichBrilliantLavender;
+           else if (gcolor_equal(pixel, GColorIndigo))
+             pixel_new = GColorLavenderIndigo;
+           else if (gcolor_equal(pixel, GColorElectricUltramarine))
+             pixel_new = GColorVeryLightBlue;
+           else if (gcolor_equal(pixel, GColorArmyGreen))
+             pixel_new = GColorBrass;
+           else if (gcolor_equal(pixel, GColorDarkGray))
+             pixel_new = GColorLightGray;
+           else if (gcolor_equal(pixel, GColorLiberty))
+             pixel_new = GColorBabyBlueEyes;
+           else if (gcolor_equal(pixel, GColorVeryLightBlue))
+             pixel_new = GColorElectricUltramarine;
+           else if (gcolor_equal(pixel, GColorKellyGreen))
+             pixel_new = GColorGreen;
+           else if (gcolor_equal(pixel, GColorMayGreen))
+             pixel_new = GColorMediumAquamarine;
+           else if (gcolor_equal(pixel, GColorCadetBlue))
+             pixel_new = GColorTiffanyBlue;
+           else if (gcolor_equal(pixel, GColorPictonBlue))
+             pixel_new = GColorBlue;
+           else if (gcolor_equal(pixel, GColorBrightGreen))
+             pixel_new = GColorIslamicGreen;
+           else if (gcolor_equal(pixel, GColorScreaminGreen))
+             pixel_new = GColorKellyGreen;
+           else if (gcolor_equal(pixel, GColorMediumAquamarine))
+             pixel_new = GColorMayGreen;
+           else if (gcolor_equal(pixel, GColorElectricBlue))
+             pixel_new = GColorBlueMoon;
+           else if (gcolor_equal(pixel, GColorDarkCandyAppleRed))
+             pixel_new = GColorMelon;
+           else if (gcolor_equal(pixel, GColorJazzberryJam))
+             pixel_new = GColorBrilliantRose;
+           else if (gcolor_equal(pixel, GColorPurple))
+             pixel_new = GColorShockingPink;
+           else if (gcolor_equal(pixel, GColorVividViolet))
+             pixel_new = GColorPurpureus;
+           else if (gcolor_equal(pixel, GColorWindsorTan))
+             pixel_new = GColorRoseVale;
+           else if (gcolor_equal(pixel, GColorRoseVale))
+             pixel_new = GColorWindsorTan;
+           else if (gcolor_equal(pixel, GColorPurpureus))
+             pixel_new = GColorVividViolet;
+           else if (gcolor_equal(pixel, GColorLavenderIndigo))
+             pixel_new = GColorIndigo;
+           else if (gcolor_equal(pixel, GColorLimerick))
+             pixel_new = GColorPastelYellow;
+           else if (gcolor_equal(pixel, GColorBrass))
+             pixel_new = GColorArmyGreen;
+           else if (gcolor_equal(pixel, GColorLightGray))
+             pixel_new = GColorDarkGray;
+           else if (gcolor_equal(pixel, GColorBabyBlueEyes))
+             pixel_new = GColorLiberty;
+           else if (gcolor_equal(pixel, GColorSpringBud))
+             pixel_new = GColorDarkGreen;
+           else if (gcolor_equal(pixel, GColorInchworm))
+             pixel_new = GColorMidnightGreen;
+           else if (gcolor_equal(pixel, GColorMintGreen))
+             pixel_new = GColorDarkGreen;
+           else if (gcolor_equal(pixel, GColorCeleste))
+             pixel_new = GColorOxfordBlue;
+           else if (gcolor_equal(pixel, GColorRed))
+             pixel_new = GColorSunsetOrange;
+           else if (gcolor_equal(pixel, GColorFolly))
+             pixel_new = GColorMelon;
+           else if (gcolor_equal(pixel, GColorFashionMagenta))
+             pixel_new = GColorMagenta ;
+           else if (gcolor_equal(pixel, GColorMagenta))
+             pixel_new = GColorFashionMagenta;
+           else if (gcolor_equal(pixel, GColorOrange))
+             pixel_new = GColorRajah;
+           else if (gcolor_equal(pixel, GColorSunsetOrange))
+             pixel_new = GColorRed;
+           else if (gcolor_equal(pixel, GColorBrilliantRose))
+             pixel_new = GColorJazzberryJam;
+           else if (gcolor_equal(pixel, GColorShockingPink))
+             pixel_new = GColorPurple;
+           else if (gcolor_equal(pixel, GColorChromeYellow))
+             pixel_new = GColorWindsorTan;
+           else if (gcolor_equal(pixel, GColorRajah))
+             pixel_new = GColorOrange;
+           else if (gcolor_equal(pixel, GColorMelon))
+             pixel_new = GColorDarkCandyAppleRed;
+           else if (gcolor_equal(pixel, GColorRichBrilliantLavender))
+             pixel_new = GColorImperialPurple;
+           else if (gcolor_equal(pixel, GColorYellow))
+             pixel_new = GColorChromeYellow;
+           else if (gcolor_equal(pixel, GColorIcterine))
+             pixel_new = GColorChromeYellow;
+           else if (gcolor_equal(pixel, GColorPastelYellow))
+             pixel_new = GColorChromeYellow;
+
+           set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, pixel_new.argb);
+         }
+     }
+  }
+
+  graphics_release_frame_buffer(ctx, fb);
+
+#endif
+}
+
+// pixel value as a color. On Aplite the 1bit value was cast to GColor and compared with black or white, which
+// only worked with the old 0/1 color values; the references compare it as the color it stands for
+static GColor pixel_color(uint8_t pixel) {
+  #ifdef PBL_COLOR
+    return (GColor8){.argb = pixel};
+  #else
+    return pixel ? GColorWhite : GColorBlack;
+  #endif
+}
+
+// THE EXTREMELY FAST LINE ALGORITHM Variation E (Addition Fixed Point PreCalc Small Display)
+// Small Display (256x256) resolution.
+// based on algorythm by Po-Han Lin at http://www.edepot.com
+static void set_line(BitmapInfo bitmap_info, int y, int x, int y2, int x2, uint8_t draw_color, uint8_t skip_color, uint8_t *visited) {
+  bool yLonger = false;	int shortLen=y2-y; int longLen=x2-x;
+  uint8_t temp_pixel;  int temp_x, temp_y;
+
+	if (abs(shortLen)>abs(longLen)) {
+		int swap=shortLen;
+		shortLen=longLen;	longLen=swap;	yLonger=true;
+	}
+
+	int decInc;
+	if (longLen==0) decInc=0;
+	else decInc = (shortLen << 8) / longLen;
+
+	if (yLonger) {
+		if (longLen>0) {
+			longLen+=y;
+			for (int j=0x80+(x<<8);y<=longLen;++y) {
+        temp_y = y; temp_x = j >> 8;
+        if (temp_y >=0 && temp_y<168 && temp_x >=0 && temp_x < 144) {
+          temp_pixel = get_pixel(bitmap_info,  temp_y, temp_x);
+          #ifdef PBL_COLOR // for Basalt drawing pixel if it is not of original color or already drawn color
+            if (temp_pixel != skip_color && temp_pixel != draw_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color);
+          #else
+            if (get_pixel(bitmap_info,  temp_y, temp_x) != 1) { // for Aplite first check if pixel isn't already marked as set in user-defined array
+              if (temp_pixel != skip_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color); // if pixel isn't of original color - set it
+              draw_color = 1 - draw_color; // revers pixel for "lined" effect
+              set_pixel(bitmap_info, temp_y, temp_x, 1); //mark pixel as set
+            }
+          #endif
+        }
+				j+=decInc;
+			}
+			return;
+		}
+		longLen+=y;
+		for (int j=0x80+(x<<8);y>=longLen;--y) {
+      temp_y = y; temp_x = j >> 8;
+      if (temp_y >=0 && temp_y<168 && temp_x >=0 && temp_x < 144) {
+        temp_pixel = get_pixel(bitmap_info,  temp_y, temp_x);
+          #ifdef PBL_COLOR // for Basalt drawing pixel if it is not of original color or already drawn color
+            if (temp_pixel != skip_color && temp_pixel != draw_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color);
+          #else
+            if (get_pixel(bitmap_info,  temp_y, temp_x) != 1) { // for Aplite first check if pixel isn't already marked as set in user-defined array
+              if (temp_pixel != skip_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color); // if pixel isn't of original color - set it
+              draw_color = 1 - draw_color; // revers pixel for "lined" effect
+              set_pixel(bitmap_info, temp_y, temp_x, 1); //mark pixel as set
+            }
+          #endif
+      }
+			j-=decInc;
+		}
+		return;
+	}
+
+	if (longLen>0) {
+		longLen+=x;
+		for (int j=0x80+(y<<8);x<=longLen;++x) {
+      temp_y = j >> 8; temp_x =  x;
+      if (temp_y >=0 && temp_y<168 && temp_x >=0 && temp_x < 144) {
+        temp_pixel = get_pixel(bitmap_info, temp_y, temp_x);
+          #ifdef PBL_COLOR // for Basalt drawing pixel if it is not of original color or already drawn color
+            if (temp_pixel != skip_color && temp_pixel != draw_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color);
+          #else
+            if (get_pixel(bitmap_info,  temp_y, temp_x) != 1) { // for Aplite first check if pixel isn't already marked as set in user-defined array
+              if (temp_pixel != skip_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color); // if pixel isn't of original color - set it
+              draw_color = 1 - draw_color; // revers pixel for "lined" effect
+              set_pixel(bitmap_info, temp_y, temp_x, 1); //mark pixel as set
+            }
+          #endif
+      }
+			j+=decInc;
+		}
+		return;
+	}
+	longLen+=x;
+	for (int j=0x80+(y<<8);x>=longLen;--x) {
+	  temp_y = j >> 8; temp_x =  x;
+    if (temp_y >=0 && temp_y<168 && temp_x >=0 && temp_x < 144) {
+      temp_pixel = get_pixel(bitmap_info, temp_y, temp_x);
+          #ifdef PBL_COLOR // for Basalt drawing pixel if it is not of original color or already drawn color
+            if (temp_pixel != skip_color && temp_pixel != draw_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color);
+          #else
+            if (get_pixel(bitmap_info,  temp_y, temp_x) != 1) { // for Aplite first check if pixel isn't already marked as set in user-defined array
+              if (temp_pixel != skip_color) set_pixel(bitmap_info, temp_y, temp_x, draw_color); // if pixel isn't of original color - set it
+              draw_color = 1 - draw_color; // revers pixel for "lined" effect
+              set_pixel(bitmap_info, temp_y, temp_x, 1); //mark pixel as set
+            }
+          #endif
+    }
+		j-=decInc;
+	}
+
+}
+
+
+// shadow effect.
+// see struct EffecOffset for parameter description
+void baseline_effect_shadow(GContext* ctx, GRect position, void* param) {
+  GColor temp_pixel;
+  int shadow_x, shadow_y;
+  EffectOffset *shadow = (EffectOffset *)param;
+
+  #ifndef PBL_COLOR
+    uint8_t draw_color = gcolor_equal(shadow->offset_color, GColorWhite)? 1 : 0;
+    uint8_t skip_color = gcolor_equal(shadow->orig_color, GColorWhite)? 1 : 0;
+  #endif
+
+   //capturing framebuffer bitmap
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+  BitmapInfo bitmap_info;
+  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
+  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  bitmap_info.bitmap_format = gbitmap_get_format(fb);
+
+
+  //looping throughout making shadow
+  for (int y = 0; y < position.size.h; y++)
+     for (int x = 0; x < position.size.w; x++) {
+       temp_pixel = pixel_color(get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x));
+
+       if (gcolor_equal(temp_pixel, shadow->orig_color)) {
+         shadow_x =  x + position.origin.x + shadow->offset_x;
+         shadow_y =  y + position.origin.y + shadow->offset_y;
+
+         if (shadow->option == 1) {
+            #ifdef PBL_COLOR // for Basalt simple calling line-drawing routine
+               set_line(bitmap_info, y + position.origin.y, x + position.origin.x, shadow_y, shadow_x, shadow->offset_color.argb, shadow->orig_color.argb, NULL);
+            #else // for Aplite - passing user-defined array to determine if pixels have been set or not
+               set_line(bitmap_info, y + position.origin.y, x + position.origin.x, shadow_y, shadow_x, draw_color, skip_color, shadow->aplite_visited);
+            #endif
+
+         } else {
+
+             if (shadow_x >= 0 && shadow_x <=143 && shadow_y >= 0 && shadow_y <= 167) {
+
+               temp_pixel = pixel_color(get_pixel(bitmap_info, shadow_y, shadow_x));
+               if (!gcolor_equal(temp_pixel, shadow->orig_color) & !gcolor_equal(temp_pixel, shadow->offset_color) ) {
+                 #ifdef PBL_COLOR
+                    set_pixel(bitmap_info,  shadow_y, shadow_x, shadow->offset_color.argb);
+                 #else
+                    set_pixel(bitmap_info,  shadow_y, shadow_x, gcolor_equal(shadow->offset_color, GColorWhite)? 1 : 0);
+                 #endif
+               }
+             }
+
+         }
+
+
+       }
+  }
+
+  graphics_release_frame_buffer(ctx, fb);
+
+}
+
+void baseline_effect_outline(GContext* ctx, GRect position, void* param) {
+  GColor temp_pixel;
+  int outlinex[4];
+  int outliney[4];
+  EffectOffset *outline = (EffectOffset *)param;
+
+   //capturing framebuffer bitmap
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+  BitmapInfo bitmap_info;
+  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
+  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  bitmap_info.bitmap_format = gbitmap_get_format(fb);
+
+
+  //loop through pixels from framebuffer
+  for (int y = 0; y < position.size.h; y++)
+     for (int x = 0; x < position.size.w; x++) {
+       temp_pixel = pixel_color(get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x));
+
+       if (gcolor_equal(temp_pixel, outline->orig_color)) {
+          // TODO: there's probably a more efficient way to do this
+          outlinex[0] = x + position.origin.x - outline->offset_x;
+          outliney[0] = y + position.origin.y - outline->offset_y;
+          outlinex[1] = x + position.origin.x + outline->offset_x;
+          outliney[1] = y + position.origin.y + outline->offset_y;
+          outlinex[2] = x + position.origin.x - outline->offset_x;
+          outliney[2] = y + position.origin.y + outline->offset_y;
+          outlinex[3] = x + position.origin.x + outline->offset_x;
+          outliney[3] = y + position.origin.y - outline->offset_y;
+
+
+          for (int i = 0; i < 4; i++) {
+            // TODO: centralize the constants (bounds were <= 144 and <= 168, off by one)
+            if (outlinex[i] >= 0 && outlinex[i] < 144 && outliney[i] >= 0 && outliney[i] < 168) {
+              temp_pixel = pixel_color(get_pixel(bitmap_info, outliney[i], outlinex[i]));
+              if (!gcolor_equal(temp_pixel, outline->orig_color)) {
+                #ifdef PBL_COLOR
+                   set_pixel(bitmap_info, outliney[i], outlinex[i], outline->offset_color.argb);
+                #else
+                   set_pixel(bitmap_info, outliney[i], outlinex[i], gcolor_equal(outline->offset_color, GColorWhite)? 1 : 0);
+                #endif
+              }
+            }
+          }
+       }
+  }
+
+  graphics_release_frame_buffer(ctx, fb);
+}
+
+#ifdef PBL_COLOR
+static void blur_(uint8_t *bitmap_data, int bytes_per_row, GRect position, uint16_t line, uint8_t *dest, uint8_t radius){
+  uint8_t (*fb_a)[bytes_per_row] = (uint8_t (*)[bytes_per_row])bitmap_data;
+  uint16_t total[3] = {0,0,0};
+  uint8_t  nb_points = 0;
+  GPoint p = {0,0};
+  for (uint16_t x = 0; x < position.size.w; ++x) {
+    total[0] = total[1] = total[2] = 0;
+    nb_points = 0;
+    p.y = position.origin.y + line - radius;
+    for (uint8_t ky = 0; ky <= 2*radius; ++ky){
+      p.x = position.origin.x + x - radius;
+      for (uint8_t kx = 0; kx <= 2*radius; ++kx){
+        if(grect_contains_point(&position, &p)){
+          GColor8 color = (GColor8)fb_a[p.y][p.x];
+          total[0] += color.r;
+          total[1] += color.g;
+          total[2] += color.b;
+          nb_points++;
+        }
+        p.x++;
+      }
+      p.y++;
+    }
+    total[0] = (total[0] * 0x55) / nb_points;
+    total[1] = (total[1] * 0x55) / nb_points;
+    total[2] = (total[2] * 0x55) / nb_points;
+    dest[x] = GColorFromRGB(total[0], total[1], total[2]).argb;
+  }
+}
+#endif
+
+// blur effect (radius only; nothing on Aplite, the last row of the rect is left as it was)
+void baseline_effect_blur(GContext* ctx,  GRect position, void* param){
+#ifdef PBL_COLOR
+  //capturing framebuffer bitmap
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+  uint8_t *bitmap_data =  gbitmap_get_data(fb);
+  int bytes_per_row = gbitmap_get_bytes_per_row(fb);
+
+  uint8_t radius = (uint8_t)(uint32_t)param; // Not very elegant... sorry
+  uint8_t (*fb_a)[bytes_per_row] = (uint8_t (*)[bytes_per_row])bitmap_data;
+  uint16_t offset_x = position.origin.x;
+  uint16_t offset_y = position.origin.y;
+  uint16_t width    = position.size.w;
+  uint16_t height   = position.size.h;
+
+  uint8_t *buffer = malloc(width * (radius + 1));
+
+  uint16_t h=0;
+  for(; h<(radius+1); h++){
+    blur_(bitmap_data, bytes_per_row, position, h, buffer + h*width, radius);
+  }
+
+  for(; h<height; h++){
+    memcpy(&fb_a[offset_y + h - (radius + 1)][offset_x], buffer, width);
+    memcpy(buffer, buffer + width, radius * width);
+    blur_(bitmap_data, bytes_per_row, position, h, buffer + radius*width, radius);
+  }
+
+  h=0;
+  for(; h<radius; h++){
+    memcpy(&fb_a[offset_y + height - (radius + 1) + h][offset_x] , buffer + h*width, width);
+  }
+
+  free(buffer);
+
+  graphics_release_frame_buffer(ctx, fb);
+#endif
+}
+
+// vertical mirror effect (row y was paired with h-2-y: the last row stayed, the rest was off by one)
+void baseline_effect_mirror_vertical(GContext* ctx, GRect position, void* param) {
+  uint8_t temp_pixel;
+
+  //capturing framebuffer bitmap
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+  BitmapInfo bitmap_info;
+  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
+  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  bitmap_info.bitmap_format = gbitmap_get_format(fb);
+
+  for (int y = 0; y < position.size.h / 2 ; y++)
+     for (int x = 0; x < position.size.w; x++){
+        temp_pixel = get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x);
+        set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, get_pixel(bitmap_info, position.origin.y + position.size.h - y - 2, x + position.origin.x));
+        set_pixel(bitmap_info, position.origin.y + position.size.h - y - 2, x + position.origin.x, temp_pixel);
+     }
+
+  graphics_release_frame_buffer(ctx, fb);
+}
+
+// horizontal mirror effect (column x was paired with w-2-x)
+void baseline_effect_mirror_horizontal(GContext* ctx, GRect position, void* param) {
+  uint8_t temp_pixel;
+
+  //capturing framebuffer bitmap
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+  BitmapInfo bitmap_info;
+  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
+  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  bitmap_info.bitmap_format = gbitmap_get_format(fb);
+
+  for (int y = 0; y < position.size.h; y++)
+     for (int x = 0; x < position.size.w / 2; x++){
+        temp_pixel = get_pixel(bitmap_info, y + position.origin.y, x + position.origin.x);
+        set_pixel(bitmap_info, y + position.origin.y, x + position.origin.x, get_pixel(bitmap_info, y + position.origin.y, position.origin.x + position.size.w - x - 2));
+        set_pixel(bitmap_info, y + position.origin.y, position.origin.x + position.size.w - x - 2, temp_pixel);
+     }
+
+  graphics_release_frame_buffer(ctx, fb);
+}
+
+// Rotate 90 degrees
+// Added by Ron64
+// Parameter:  true: rotate right/clockwise,  false: rotate left/counter_clockwise
+void baseline_effect_rotate_90_degrees(GContext* ctx,  GRect position, void* param){
+
+  //capturing framebuffer bitmap
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+  BitmapInfo bitmap_info;
+  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
+  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  bitmap_info.bitmap_format = gbitmap_get_format(fb);
+
+  bool right = (bool)param;
+  uint8_t qtr, xCn, yCn, temp_pixel;
+  xCn= position.origin.x + position.size.w /2;
+  yCn= position.origin.y + position.size.h /2;
+  qtr=position.size.w;
+  if (position.size.h < qtr)
+    qtr= position.size.h;
+  qtr= qtr/2;
+
+  for (int c1 = 0; c1 < qtr; c1++)
+    for (int c2 = 1; c2 < qtr; c2++){
+      temp_pixel = get_pixel(bitmap_info, yCn +c1, xCn +c2);
+      if (right){
+        set_pixel(bitmap_info, yCn +c1, xCn +c2, get_pixel(bitmap_info, yCn -c2, xCn +c1));
+        set_pixel(bitmap_info, yCn -c2, xCn +c1, get_pixel(bitmap_info, yCn -c1, xCn -c2));
+        set_pixel(bitmap_info, yCn -c1, xCn -c2, get_pixel(bitmap_info, yCn +c2, xCn -c1));
+        set_pixel(bitmap_info, yCn +c2, xCn -c1, temp_pixel);
+      }
+      else{
+        set_pixel(bitmap_info, yCn +c1, xCn +c2, get_pixel(bitmap_info, yCn +c2, xCn -c1));
+        set_pixel(bitmap_info, yCn +c2, xCn -c1, get_pixel(bitmap_info, yCn -c1, xCn -c2));
+        set_pixel(bitmap_info, yCn -c1, xCn -c2, get_pixel(bitmap_info, yCn -c2, xCn +c1));
+        set_pixel(bitmap_info, yCn -c2, xCn +c1, temp_pixel);
+      }
+     }
+
+  graphics_release_frame_buffer(ctx, fb);
+}
+
+// Zoom effect.
+// Added by Ron64
+// Parameter: Y zoom (high byte) X zoom(low byte),  0x10 no zoom 0x20 200% 0x08 50%,
+// use the percentage macro EL_ZOOM(150,60). In this example: Y- zoom in 150%, X- zoom out to 60%
+void baseline_effect_zoom(GContext* ctx,  GRect position, void* param){
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+  BitmapInfo bitmap_info;
+  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
+  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  bitmap_info.bitmap_format = gbitmap_get_format(fb);
+
+  uint8_t xCn, yCn, Y1,X1, ratioY, ratioX;
+  xCn= position.origin.x + position.size.w /2;
+  yCn= position.origin.y + position.size.h /2;
+
+  ratioY= (int32_t)param >>8 & 0xFF;
+  ratioX= (int32_t)param & 0xFF;
+
+  for (int y = 0; y <= position.size.h>>1; y++)
+    for (int x = 0; x <= position.size.w>>1; x++)
+    {
+      //yS,xS scan source: centre to out or out to centre
+      int8_t yS = (ratioY>16) ? (position.size.h/2)- y: y;
+      int8_t xS = (ratioX>16) ? (position.size.w/2)- x: x;
+      Y1= (yS<<4) /ratioY;
+      X1= (xS<<4) /ratioX;
+      set_pixel(bitmap_info, yCn +yS, xCn +xS, get_pixel(bitmap_info, yCn +Y1, xCn +X1));
+      set_pixel(bitmap_info, yCn +yS, xCn -xS, get_pixel(bitmap_info, yCn +Y1, xCn -X1));
+      set_pixel(bitmap_info, yCn -yS, xCn +xS, get_pixel(bitmap_info, yCn -Y1, xCn +X1));
+      set_pixel(bitmap_info, yCn -yS, xCn -xS, get_pixel(bitmap_info, yCn -Y1, xCn -X1));
+    }
+  graphics_release_frame_buffer(ctx, fb);
+//Todo: Should probably reduce Y size on zoom out or limit reading beyond edge of screen.
+}
+
+// Lens effect.
+// Added by Ron64
+// Parameters: lens focal(high byte) and object distance(low byte)
+void baseline_effect_lens(GContext* ctx,  GRect position, void* param){
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+  BitmapInfo bitmap_info;
+  bitmap_info.bitmap_data =  gbitmap_get_data(fb);
+  bitmap_info.bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  bitmap_info.bitmap_format = gbitmap_get_format(fb);
+
+  uint8_t d,r, xCn, yCn;
+
+  xCn= position.origin.x + position.size.w /2;
+  yCn= position.origin.y + position.size.h /2;
+  d=position.size.w;
+  if (position.size.h < d)
+    d= position.size.h;
+  r= d/2; // radius of lens
+  float focal =   (int32_t)param >>8 & 0xFF;// focal point of lens
+  float obj_dis = (int32_t)param & 0xFF;//distance of object from focal point.
+
+  for (int y = r; y >= 0; --y)
+    for (int x = r; x >= 0; --x)
+      if (x*x+y*y < r*r)
+      {
+        int Y1= my_tan(my_asin(y/focal))*obj_dis;
+        int X1= my_tan(my_asin(x/focal))*obj_dis;
+        set_pixel(bitmap_info, yCn +y, xCn +x, get_pixel(bitmap_info, yCn +Y1, xCn +X1));
+        set_pixel(bitmap_info, yCn +y, xCn -x, get_pixel(bitmap_info, yCn +Y1, xCn -X1));
+        set_pixel(bitmap_info, yCn -y, xCn +x, get_pixel(bitmap_info, yCn -Y1, xCn +X1));
+        set_pixel(bitmap_info, yCn -y, xCn -x, get_pixel(bitmap_info, yCn -Y1, xCn -X1));
+      }
+  graphics_release_frame_buffer(ctx, fb);
+//Todo: Change to lock-up arcsin table in the future. (Currently using floating point math library that is relatively big & slow)
+}
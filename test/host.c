@@ -0,0 +1,182 @@
+#include <pebble.h>
+
+// SDK functions of pebble.h on the host. Capturing and drawing follow the firmware rules the library relies
+// on: a capture is exclusive until released, and nothing may be drawn through the context meanwhile
+
+static void host_fail(const char *message) {
+  fprintf(stderr, "SDK misuse: %s\n", message);
+  abort();
+}
+
+GBitmap* graphics_capture_frame_buffer(GContext *ctx) {
+  if (ctx->captured) return NULL;
+  ctx->captured = true;
+  return ctx->fb;
+}
+
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer) {
+  if (!ctx->captured || buffer != ctx->fb) host_fail("release of a framebuffer that is not captured");
+  ctx->captured = false;
+  return true;
+}
+
+uint8_t* gbitmap_get_data(const GBitmap *bitmap) {
+  return bitmap->data;
+}
+
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap) {
+  return bitmap->bytes_per_row;
+}
+
+GBitmapFormat gbitmap_get_format(const GBitmap *bitmap) {
+  return bitmap->format;
+}
+
+GRect gbitmap_get_bounds(const GBitmap *bitmap) {
+  return bitmap->bounds;
+}
+
+// rows padded to whole words like the firmware's 1bit bitmaps
+GBitmap* gbitmap_create_blank(GSize size, GBitmapFormat format) {
+  GBitmap *bitmap = calloc(1, sizeof(GBitmap));
+  if (!bitmap) return NULL;
+  bitmap->format = format;
+  bitmap->bytes_per_row = format == GBitmapFormat8Bit ? size.w : (size.w + 31) / 32 * 4;
+  bitmap->bounds = GRect(0, 0, size.w, size.h);
+  bitmap->data = calloc(size.h, bitmap->bytes_per_row);
+  if (!bitmap->data) {
+    free(bitmap);
+    return NULL;
+  }
+  return bitmap;
+}
+
+void gbitmap_destroy(GBitmap *bitmap) {
+  if (!bitmap) return;
+  free(bitmap->data);
+  free(bitmap);
+}
+
+bool grect_equal(const GRect *a, const GRect *b) {
+  return a->origin.x == b->origin.x && a->origin.y == b->origin.y && a->size.w == b->size.w && a->size.h == b->size.h;
+}
+
+void grect_clip(GRect *const rect_to_clip, const GRect *const rect_clipper) {
+  int x0 = rect_to_clip->origin.x > rect_clipper->origin.x ? rect_to_clip->origin.x : rect_clipper->origin.x;
+  int y0 = rect_to_clip->origin.y > rect_clipper->origin.y ? rect_to_clip->origin.y : rect_clipper->origin.y;
+  int x1 = rect_to_clip->origin.x + rect_to_clip->size.w, y1 = rect_to_clip->origin.y + rect_to_clip->size.h;
+  if (x1 > rect_clipper->origin.x + rect_clipper->size.w) x1 = rect_clipper->origin.x + rect_clipper->size.w;
+  if (y1 > rect_clipper->origin.y + rect_clipper->size.h) y1 = rect_clipper->origin.y + rect_clipper->size.h;
+  *rect_to_clip = GRect(x0, y0, x1 > x0 ? x1 - x0 : 0, y1 > y0 ? y1 - y0 : 0);
+}
+
+bool grect_contains_point(const GRect *rect, const GPoint *point) {
+  return point->x >= rect->origin.x && point->x < rect->origin.x + rect->size.w &&
+         point->y >= rect->origin.y && point->y < rect->origin.y + rect->size.h;
+}
+
+// nearest of the 4 levels per channel, like the firmware: the top 2 bits
+GColor8 GColorFromRGB(uint8_t red, uint8_t green, uint8_t blue) {
+  return (GColor8){.argb = 0xC0 | (red >> 6) << 4 | (green >> 6) << 2 | blue >> 6};
+}
+
+Layer* layer_create_with_data(GRect frame, size_t data_size) {
+  Layer *layer = calloc(1, sizeof(Layer));
+  if (!layer) return NULL;
+  layer->frame = frame;
+  layer->bounds = GRect(0, 0, frame.size.w, frame.size.h);
+  layer->data = data_size ? calloc(1, data_size) : NULL;
+  return layer;
+}
+
+Layer* layer_create(GRect frame) {
+  return layer_create_with_data(frame, 0);
+}
+
+void* layer_get_data(const Layer *layer) {
+  return layer->data;
+}
+
+void layer_destroy(Layer *layer) {
+  if (!layer) return;
+  free(layer->data);
+  free(layer);
+}
+
+void layer_add_child(Layer *parent, Layer *child) {
+  child->parent = parent;
+}
+
+GRect layer_get_frame(const Layer *layer) {
+  return layer->frame;
+}
+
+void layer_set_frame(Layer *layer, GRect frame) {
+  layer->frame = frame;
+  layer->bounds.size = frame.size;
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+  layer->update_proc = update_proc;
+}
+
+void layer_mark_dirty(Layer *layer) {
+}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {
+  ctx->fill_color = color;
+}
+
+void graphics_context_set_text_color(GContext *ctx, GColor color) {
+  ctx->text_color = color;
+}
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) {
+  ctx->stroke_color = color;
+}
+
+// pixel of the framebuffer: argb on Basalt, black (GColorBlackARGB8) or white on Aplite
+static void host_set_pixel(GBitmap *fb, int x, int y, uint8_t argb) {
+  GRect bounds = fb->bounds;
+  if (x < 0 || y < 0 || x >= bounds.size.w || y >= bounds.size.h) return;
+  uint8_t *row = fb->data + y * fb->bytes_per_row;
+  if (fb->format == GBitmapFormat8Bit) row[x] = argb;
+  else if (argb == GColorWhiteARGB8) row[x >> 3] |= 1 << (x & 7);
+  else row[x >> 3] &= ~(1 << (x & 7));
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask) {
+  if (ctx->captured) host_fail("drawing while the framebuffer is captured");
+  if (gcolor_equal(ctx->fill_color, GColorClear)) return;
+  for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++)
+    for (int x = rect.origin.x; x < rect.origin.x + rect.size.w; x++) host_set_pixel(ctx->fb, x, y, ctx->fill_color.argb);
+}
+
+// text is not rendered on the host, only the rules are checked
+void graphics_draw_text(GContext *ctx, const char *text, GFont font, GRect box, GTextOverflowMode overflow_mode,
+                        GTextAlignment alignment, GTextAttributes *text_attributes) {
+  if (ctx->captured) host_fail("drawing while the framebuffer is captured");
+}
+
+// 8bit bitmaps (transparent pixels skipped) or 1bit ones, drawn at the rect origin and clipped to the rect
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect) {
+  if (ctx->captured) host_fail("drawing while the framebuffer is captured");
+  for (int y = 0; y < rect.size.h && y < bitmap->bounds.size.h; y++) {
+    const uint8_t *row = bitmap->data + y * bitmap->bytes_per_row;
+    for (int x = 0; x < rect.size.w && x < bitmap->bounds.size.w; x++) {
+      uint8_t argb = bitmap->format == GBitmapFormat8Bit ? row[x] :
+                     (row[x >> 3] >> (x & 7)) & 1 ? GColorWhiteARGB8 : GColorBlackARGB8;
+      if (argb >> 6) host_set_pixel(ctx->fb, rect.origin.x + x, rect.origin.y + y, argb);
+    }
+  }
+}
+
+GFont fonts_get_system_font(const char *font_key) {
+  return NULL;
+}
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms) {
+  if (tloc) *tloc = 0;
+  if (out_ms) *out_ms = 0;
+  return 0;
+}
@@ -0,0 +1,232 @@
+#pragma once
+// Host stand-in for the parts of the Pebble SDK the library uses, so its sources build and run in the tests.
+// Frame buffers are plain GBitmaps in the platform format (see test.h)
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+typedef struct { int16_t x, y; } GPoint;
+typedef struct { int16_t w, h; } GSize;
+typedef struct { GPoint origin; GSize size; } GRect;
+#define GPoint(x, y) ((GPoint){(x), (y)})
+#define GSize(w, h) ((GSize){(w), (h)})
+#define GRect(x, y, w, h) ((GRect){{(x), (y)}, {(w), (h)}})
+#define GRectZero GRect(0, 0, 0, 0)
+
+typedef union {
+  uint8_t argb;
+  struct { uint8_t b:2; uint8_t g:2; uint8_t r:2; uint8_t a:2; };
+} GColor8;
+typedef GColor8 GColor;
+static inline bool gcolor_equal(GColor8 a, GColor8 b) { return a.argb == b.argb; }
+
+typedef enum {
+  GBitmapFormat1Bit = 0,
+  GBitmapFormat8Bit,
+  GBitmapFormat1BitPalette,
+  GBitmapFormat2BitPalette,
+  GBitmapFormat4BitPalette,
+} GBitmapFormat;
+
+typedef struct GBitmap {
+  uint8_t *data;
+  uint16_t bytes_per_row;
+  GBitmapFormat format;
+  GRect bounds;
+} GBitmap;
+
+typedef struct GContext {
+  GBitmap *fb;
+  bool captured; // like the firmware, a second capture before the release gets NULL
+  GColor fill_color, text_color, stroke_color;
+} GContext;
+
+typedef struct Layer Layer;
+typedef void (*LayerUpdateProc)(Layer *layer, GContext *ctx);
+struct Layer {
+  Layer *parent;
+  GRect frame;
+  GRect bounds;
+  LayerUpdateProc update_proc;
+  void *data;
+};
+
+typedef void *GFont;
+typedef struct GTextAttributes GTextAttributes;
+typedef enum { GTextOverflowModeWordWrap, GTextOverflowModeTrailingEllipsis, GTextOverflowModeFill } GTextOverflowMode;
+typedef enum { GTextAlignmentLeft, GTextAlignmentCenter, GTextAlignmentRight } GTextAlignment;
+typedef enum { GCornerNone = 0, GCornersAll = 15 } GCornerMask;
+typedef enum { SECOND_UNIT = 1, MINUTE_UNIT = 2, HOUR_UNIT = 4, DAY_UNIT = 8, MONTH_UNIT = 16, YEAR_UNIT = 32 } TimeUnits;
+
+#define FONT_KEY_GOTHIC_14 "GOTHIC_14"
+#define APP_LOG_LEVEL_ERROR 1
+#define APP_LOG_LEVEL_WARNING 2
+#define APP_LOG_LEVEL_INFO 3
+#define APP_LOG_LEVEL_DEBUG 4
+#define APP_LOG(level, fmt, ...) fprintf(stderr, fmt "\n", ##__VA_ARGS__)
+
+GBitmap* graphics_capture_frame_buffer(GContext *ctx);
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer);
+uint8_t* gbitmap_get_data(const GBitmap *bitmap);
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap);
+GBitmapFormat gbitmap_get_format(const GBitmap *bitmap);
+GRect gbitmap_get_bounds(const GBitmap *bitmap);
+GBitmap* gbitmap_create_blank(GSize size, GBitmapFormat format);
+void gbitmap_destroy(GBitmap *bitmap);
+bool grect_equal(const GRect *a, const GRect *b);
+void grect_clip(GRect *const rect_to_clip, const GRect *const rect_clipper);
+bool grect_contains_point(const GRect *rect, const GPoint *point);
+GColor8 GColorFromRGB(uint8_t red, uint8_t green, uint8_t blue);
+Layer* layer_create(GRect frame);
+Layer* layer_create_with_data(GRect frame, size_t data_size);
+void* layer_get_data(const Layer *layer);
+void layer_destroy(Layer *layer);
+void layer_add_child(Layer *parent, Layer *child);
+GRect layer_get_frame(const Layer *layer);
+void layer_set_frame(Layer *layer, GRect frame);
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc);
+void layer_mark_dirty(Layer *layer);
+void graphics_context_set_fill_color(GContext *ctx, GColor color);
+void graphics_context_set_text_color(GContext *ctx, GColor color);
+void graphics_context_set_stroke_color(GContext *ctx, GColor color);
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask);
+void graphics_draw_text(GContext *ctx, const char *text, GFont font, GRect box, GTextOverflowMode overflow_mode,
+                        GTextAlignment alignment, GTextAttributes *text_attributes);
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect);
+GFont fonts_get_system_font(const char *font_key);
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms);
+
+// GColor8 names (opaque colors in argb order) and their argb values
+#define GColorBlackARGB8 ((uint8_t)0xC0)
+#define GColorOxfordBlueARGB8 ((uint8_t)0xC1)
+#define GColorDukeBlueARGB8 ((uint8_t)0xC2)
+#define GColorBlueARGB8 ((uint8_t)0xC3)
+#define GColorDarkGreenARGB8 ((uint8_t)0xC4)
+#define GColorMidnightGreenARGB8 ((uint8_t)0xC5)
+#define GColorCobaltBlueARGB8 ((uint8_t)0xC6)
+#define GColorBlueMoonARGB8 ((uint8_t)0xC7)
+#define GColorIslamicGreenARGB8 ((uint8_t)0xC8)
+#define GColorJaegerGreenARGB8 ((uint8_t)0xC9)
+#define GColorTiffanyBlueARGB8 ((uint8_t)0xCA)
+#define GColorVividCeruleanARGB8 ((uint8_t)0xCB)
+#define GColorGreenARGB8 ((uint8_t)0xCC)
+#define GColorMalachiteARGB8 ((uint8_t)0xCD)
+#define GColorMediumSpringGreenARGB8 ((uint8_t)0xCE)
+#define GColorCyanARGB8 ((uint8_t)0xCF)
+#define GColorBulgarianRoseARGB8 ((uint8_t)0xD0)
+#define GColorImperialPurpleARGB8 ((uint8_t)0xD1)
+#define GColorIndigoARGB8 ((uint8_t)0xD2)
+#define GColorElectricUltramarineARGB8 ((uint8_t)0xD3)
+#define GColorArmyGreenARGB8 ((uint8_t)0xD4)
+#define GColorDarkGrayARGB8 ((uint8_t)0xD5)
+#define GColorLibertyARGB8 ((uint8_t)0xD6)
+#define GColorVeryLightBlueARGB8 ((uint8_t)0xD7)
+#define GColorKellyGreenARGB8 ((uint8_t)0xD8)
+#define GColorMayGreenARGB8 ((uint8_t)0xD9)
+#define GColorCadetBlueARGB8 ((uint8_t)0xDA)
+#define GColorPictonBlueARGB8 ((uint8_t)0xDB)
+#define GColorBrightGreenARGB8 ((uint8_t)0xDC)
+#define GColorScreaminGreenARGB8 ((uint8_t)0xDD)
+#define GColorMediumAquamarineARGB8 ((uint8_t)0xDE)
+#define GColorElectricBlueARGB8 ((uint8_t)0xDF)
+#define GColorDarkCandyAppleRedARGB8 ((uint8_t)0xE0)
+#define GColorJazzberryJamARGB8 ((uint8_t)0xE1)
+#define GColorPurpleARGB8 ((uint8_t)0xE2)
+#define GColorVividVioletARGB8 ((uint8_t)0xE3)
+#define GColorWindsorTanARGB8 ((uint8_t)0xE4)
+#define GColorRoseValeARGB8 ((uint8_t)0xE5)
+#define GColorPurpureusARGB8 ((uint8_t)0xE6)
+#define GColorLavenderIndigoARGB8 ((uint8_t)0xE7)
+#define GColorLimerickARGB8 ((uint8_t)0xE8)
+#define GColorBrassARGB8 ((uint8_t)0xE9)
+#define GColorLightGrayARGB8 ((uint8_t)0xEA)
+#define GColorBabyBlueEyesARGB8 ((uint8_t)0xEB)
+#define GColorSpringBudARGB8 ((uint8_t)0xEC)
+#define GColorInchwormARGB8 ((uint8_t)0xED)
+#define GColorMintGreenARGB8 ((uint8_t)0xEE)
+#define GColorCelesteARGB8 ((uint8_t)0xEF)
+#define GColorRedARGB8 ((uint8_t)0xF0)
+#define GColorFollyARGB8 ((uint8_t)0xF1)
+#define GColorFashionMagentaARGB8 ((uint8_t)0xF2)
+#define GColorMagentaARGB8 ((uint8_t)0xF3)
+#define GColorOrangeARGB8 ((uint8_t)0xF4)
+#define GColorSunsetOrangeARGB8 ((uint8_t)0xF5)
+#define GColorBrilliantRoseARGB8 ((uint8_t)0xF6)
+#define GColorShockingPinkARGB8 ((uint8_t)0xF7)
+#define GColorChromeYellowARGB8 ((uint8_t)0xF8)
+#define GColorRajahARGB8 ((uint8_t)0xF9)
+#define GColorMelonARGB8 ((uint8_t)0xFA)
+#define GColorRichBrilliantLavenderARGB8 ((uint8_t)0xFB)
+#define GColorYellowARGB8 ((uint8_t)0xFC)
+#define GColorIcterineARGB8 ((uint8_t)0xFD)
+#define GColorPastelYellowARGB8 ((uint8_t)0xFE)
+#define GColorWhiteARGB8 ((uint8_t)0xFF)
+#define GColorClearARGB8 ((uint8_t)0x00)
+#define GColorBlack ((GColor8){.argb = GColorBlackARGB8})
+#define GColorOxfordBlue ((GColor8){.argb = GColorOxfordBlueARGB8})
+#define GColorDukeBlue ((GColor8){.argb = GColorDukeBlueARGB8})
+#define GColorBlue ((GColor8){.argb = GColorBlueARGB8})
+#define GColorDarkGreen ((GColor8){.argb = GColorDarkGreenARGB8})
+#define GColorMidnightGreen ((GColor8){.argb = GColorMidnightGreenARGB8})
+#define GColorCobaltBlue ((GColor8){.argb = GColorCobaltBlueARGB8})
+#define GColorBlueMoon ((GColor8){.argb = GColorBlueMoonARGB8})
+#define GColorIslamicGreen ((GColor8){.argb = GColorIslamicGreenARGB8})
+#define GColorJaegerGreen ((GColor8){.argb = GColorJaegerGreenARGB8})
+#define GColorTiffanyBlue ((GColor8){.argb = GColorTiffanyBlueARGB8})
+#define GColorVividCerulean ((GColor8){.argb = GColorVividCeruleanARGB8})
+#define GColorGreen ((GColor8){.argb = GColorGreenARGB8})
+#define GColorMalachite ((GColor8){.argb = GColorMalachiteARGB8})
+#define GColorMediumSpringGreen ((GColor8){.argb = GColorMediumSpringGreenARGB8})
+#define GColorCyan ((GColor8){.argb = GColorCyanARGB8})
+#define GColorBulgarianRose ((GColor8){.argb = GColorBulgarianRoseARGB8})
+#define GColorImperialPurple ((GColor8){.argb = GColorImperialPurpleARGB8})
+#define GColorIndigo ((GColor8){.argb = GColorIndigoARGB8})
+#define GColorElectricUltramarine ((GColor8){.argb = GColorElectricUltramarineARGB8})
+#define GColorArmyGreen ((GColor8){.argb = GColorArmyGreenARGB8})
+#define GColorDarkGray ((GColor8){.argb = GColorDarkGrayARGB8})
+#define GColorLiberty ((GColor8){.argb = GColorLibertyARGB8})
+#define GColorVeryLightBlue ((GColor8){.argb = GColorVeryLightBlueARGB8})
+#define GColorKellyGreen ((GColor8){.argb = GColorKellyGreenARGB8})
+#define GColorMayGreen ((GColor8){.argb = GColorMayGreenARGB8})
+#define GColorCadetBlue ((GColor8){.argb = GColorCadetBlueARGB8})
+#define GColorPictonBlue ((GColor8){.argb = GColorPictonBlueARGB8})
+#define GColorBrightGreen ((GColor8){.argb = GColorBrightGreenARGB8})
+#define GColorScreaminGreen ((GColor8){.argb = GColorScreaminGreenARGB8})
+#define GColorMediumAquamarine ((GColor8){.argb = GColorMediumAquamarineARGB8})
+#define GColorElectricBlue ((GColor8){.argb = GColorElectricBlueARGB8})
+#define GColorDarkCandyAppleRed ((GColor8){.argb = GColorDarkCandyAppleRedARGB8})
+#define GColorJazzberryJam ((GColor8){.argb = GColorJazzberryJamARGB8})
+#define GColorPurple ((GColor8){.argb = GColorPurpleARGB8})
+#define GColorVividViolet ((GColor8){.argb = GColorVividVioletARGB8})
+#define GColorWindsorTan ((GColor8){.argb = GColorWindsorTanARGB8})
+#define GColorRoseVale ((GColor8){.argb = GColorRoseValeARGB8})
+#define GColorPurpureus ((GColor8){.argb = GColorPurpureusARGB8})
+#define GColorLavenderIndigo ((GColor8){.argb = GColorLavenderIndigoARGB8})
+#define GColorLimerick ((GColor8){.argb = GColorLimerickARGB8})
+#define GColorBrass ((GColor8){.argb = GColorBrassARGB8})
+#define GColorLightGray ((GColor8){.argb = GColorLightGrayARGB8})
+#define GColorBabyBlueEyes ((GColor8){.argb = GColorBabyBlueEyesARGB8})
+#define GColorSpringBud ((GColor8){.argb = GColorSpringBudARGB8})
+#define GColorInchworm ((GColor8){.argb = GColorInchwormARGB8})
+#define GColorMintGreen ((GColor8){.argb = GColorMintGreenARGB8})
+#define GColorCeleste ((GColor8){.argb = GColorCelesteARGB8})
+#define GColorRed ((GColor8){.argb = GColorRedARGB8})
+#define GColorFolly ((GColor8){.argb = GColorFollyARGB8})
+#define GColorFashionMagenta ((GColor8){.argb = GColorFashionMagentaARGB8})
+#define GColorMagenta ((GColor8){.argb = GColorMagentaARGB8})
+#define GColorOrange ((GColor8){.argb = GColorOrangeARGB8})
+#define GColorSunsetOrange ((GColor8){.argb = GColorSunsetOrangeARGB8})
+#define GColorBrilliantRose ((GColor8){.argb = GColorBrilliantRoseARGB8})
+#define GColorShockingPink ((GColor8){.argb = GColorShockingPinkARGB8})
+#define GColorChromeYellow ((GColor8){.argb = GColorChromeYellowARGB8})
+#define GColorRajah ((GColor8){.argb = GColorRajahARGB8})
+#define GColorMelon ((GColor8){.argb = GColorMelonARGB8})
+#define GColorRichBrilliantLavender ((GColor8){.argb = GColorRichBrilliantLavenderARGB8})
+#define GColorYellow ((GColor8){.argb = GColorYellowARGB8})
+#define GColorIcterine ((GColor8){.argb = GColorIcterineARGB8})
+#define GColorPastelYellow ((GColor8){.argb = GColorPastelYellowARGB8})
+#define GColorWhite ((GColor8){.argb = GColorWhiteARGB8})
+#define GColorClear ((GColor8){.argb = GColorClearARGB8})
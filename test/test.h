@@ -0,0 +1,151 @@
+#pragma once
+#include <pebble.h>
+#include "effects.h"
+#include "effect_layer.h"
+
+// Helpers of the host tests: two screen sized framebuffers in the platform format, random content and rects,
+// checks and timing. Every test_*.c is one program, built for Aplite and Basalt by the Makefile
+
+#define TEST_W 144
+#define TEST_H 168
+#ifdef PBL_COLOR
+  #define TEST_FORMAT GBitmapFormat8Bit
+  #define TEST_ROW 144
+#else
+  #define TEST_FORMAT GBitmapFormat1Bit
+  #define TEST_ROW 20
+#endif
+#define TEST_SIZE (TEST_ROW * TEST_H)
+
+static uint8_t test_data[2][TEST_SIZE] __attribute__((aligned(4)));
+static GBitmap test_fb[2] = {
+  { test_data[0], TEST_ROW, TEST_FORMAT, {{0, 0}, {TEST_W, TEST_H}} },
+  { test_data[1], TEST_ROW, TEST_FORMAT, {{0, 0}, {TEST_W, TEST_H}} },
+};
+// test_ctx[0] usually runs the reference, test_ctx[1] the code under test
+static GContext test_ctx[2] = { { &test_fb[0] }, { &test_fb[1] } };
+static int test_failures;
+
+// both framebuffers get the same random pixels (opaque colors on Basalt); white_percent is the share of white
+// pixels on Aplite, Basalt uses the first colors of palette (all 64 colors if count is 0)
+static inline void test_fill(unsigned seed, int white_percent, const uint8_t *palette, int count) {
+  srand(seed);
+  memset(test_data[0], 0, TEST_SIZE);
+  for (int y = 0; y < TEST_H; y++)
+    for (int x = 0; x < TEST_W; x++) {
+      #ifdef PBL_COLOR
+        test_data[0][y * TEST_ROW + x] = count ? palette[rand() % count] : 0xC0 | (rand() & 0x3F);
+      #else
+        if (rand() % 100 < white_percent) test_data[0][y * TEST_ROW + x / 8] |= 1 << (x % 8);
+      #endif
+    }
+  memcpy(test_data[1], test_data[0], TEST_SIZE);
+}
+
+static inline bool test_same(void) {
+  return memcmp(test_data[0], test_data[1], TEST_SIZE) == 0;
+}
+
+// pixel as a color (black or white on Aplite)
+static inline GColor test_pixel(int i, int x, int y) {
+  #ifdef PBL_COLOR
+    return (GColor8){.argb = test_data[i][y * TEST_ROW + x]};
+  #else
+    return (test_data[i][y * TEST_ROW + x / 8] >> (x % 8)) & 1 ? GColorWhite : GColorBlack;
+  #endif
+}
+
+// sets a pixel (on Aplite white for white, black for any other color)
+static inline void test_set(int i, int x, int y, GColor color) {
+  #ifdef PBL_COLOR
+    test_data[i][y * TEST_ROW + x] = color.argb;
+  #else
+    uint8_t bit = 1 << (x % 8);
+    if (gcolor_equal(color, GColorWhite)) test_data[i][y * TEST_ROW + x / 8] |= bit;
+    else test_data[i][y * TEST_ROW + x / 8] &= ~bit;
+  #endif
+}
+
+// random rect inside the screen, at least 1x1
+static inline GRect test_rect(void) {
+  int x = rand() % TEST_W, y = rand() % TEST_H;
+  return GRect(x, y, 1 + rand() % (TEST_W - x), 1 + rand() % (TEST_H - y));
+}
+
+#define CHECK(cond, ...) do { \
+  if (!(cond)) { \
+    if (test_failures++ < 10) { printf("%s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } \
+  } \
+} while (0)
+
+// exit status of a test program
+static inline int test_done(const char *name) {
+  printf("%-14s %s\n", name, test_failures ? "FAILED" : "ok");
+  return test_failures != 0;
+}
+
+// benchmarks run with "bench" as argument (make bench)
+static inline double test_now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// runs an update of effect_layer on framebuffer i
+static inline void test_update(EffectLayer *effect_layer, int i) {
+  Layer *layer = effect_layer_get_layer(effect_layer);
+  layer->update_proc(layer, &test_ctx[i]);
+}
+
+// effect_layer with marked dirty rects against reference (the same effects) updating the whole frame: both
+// start from the same random content (colors of palette as in test_fill), then every frame redraws a random
+// rect of the content. Framebuffer 0 gets all of the content, framebuffer 1 only the rect, which it marks,
+// and keeps its previous output elsewhere. The first update of effect_layer marks the whole screen
+static inline void test_dirty_frames(EffectLayer *reference, EffectLayer *effect_layer, const uint8_t *palette,
+                                     int count, int frames, const char *name) {
+  static uint8_t content[TEST_SIZE];
+  test_fill(frames, 50, palette, count);
+  memcpy(content, test_data[0], TEST_SIZE);
+  effect_layer_mark_dirty_rect(effect_layer, GRect(0, 0, TEST_W, TEST_H));
+  for (int frame = 0; frame < frames; frame++) {
+    GRect rect = frame ? test_rect() : GRect(0, 0, TEST_W, TEST_H);
+    for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++)
+      for (int x = rect.origin.x; x < rect.origin.x + rect.size.w; x++) {
+        #ifdef PBL_COLOR
+          content[y * TEST_ROW + x] = count ? palette[rand() % count] : 0xC0 | (rand() & 0x3F);
+          test_data[1][y * TEST_ROW + x] = content[y * TEST_ROW + x];
+        #else
+          uint8_t bit = 1 << (x % 8), *pixel = &content[y * TEST_ROW + x / 8];
+          *pixel = rand() & 1 ? *pixel | bit : *pixel & ~bit;
+          test_data[1][y * TEST_ROW + x / 8] = (test_data[1][y * TEST_ROW + x / 8] & ~bit) | (*pixel & bit);
+        #endif
+      }
+    memcpy(test_data[0], content, TEST_SIZE);
+    test_update(reference, 0);
+    if (frame) effect_layer_mark_dirty_rect(effect_layer, rect);
+    test_update(effect_layer, 1);
+    CHECK(test_same(), "%s: frame %d, dirty rect %d %d %d %d", name, frame, rect.origin.x, rect.origin.y,
+          rect.size.w, rect.size.h);
+  }
+}
+
+#define BENCH(label, call, n) do { \
+  double t0 = test_now(); \
+  for (int i_ = 0; i_ < (n); i_++) { call; } \
+  printf("  %-40s %9.2f us/call\n", label, (test_now() - t0) * 1e6 / (n)); \
+} while (0)
+
+// baseline.c: the per-pixel effects the library started with, as references
+void baseline_effect_invert(GContext* ctx, GRect position, void* param);
+void baseline_effect_shadow(GContext* ctx, GRect position, void* param);
+void baseline_effect_outline(GContext* ctx, GRect position, void* param);
+void baseline_effect_blur(GContext* ctx, GRect position, void* param);
+void baseline_effect_colorize(GContext* ctx, GRect position, void* param);
+void baseline_effect_colorswap(GContext* ctx, GRect position, void* param);
+void baseline_effect_invert_bw_only(GContext* ctx, GRect position, void* param);
+void baseline_effect_invert_brightness(GContext* ctx, GRect position, void* param);
+void baseline_effect_lens(GContext* ctx, GRect position, void* param);
+void baseline_effect_zoom(GContext* ctx, GRect position, void* param);
+void baseline_effect_rotate_90_degrees(GContext* ctx, GRect position, void* param);
+void baseline_effect_mirror_vertical(GContext* ctx, GRect position, void* param);
+void baseline_effect_mirror_horizontal(GContext* ctx, GRect position, void* param);
@@ -0,0 +1,99 @@
+#include "test.h"
+#include "bitplane.h"
+
+// rows of 320 pixels (whole words), compared as a whole so pixels outside the range must stay
+#define ROW_BYTES 40
+
+static bool bit(const uint8_t *row, int x) {
+  return (row[x >> 3] >> (x & 7)) & 1;
+}
+
+static void set_bit(uint8_t *row, int x, bool white) {
+  if (white) row[x >> 3] |= 1 << (x & 7);
+  else row[x >> 3] &= ~(1 << (x & 7));
+}
+
+// bitplane functions against per-bit references on random rows, offsets and lengths (with every alignment of
+// source and destination), in-place shifts and rects of the test framebuffers; the same on both builds
+int main(int argc, char **argv) {
+  static uint8_t row[ROW_BYTES] __attribute__((aligned(4))), src[ROW_BYTES] __attribute__((aligned(4)));
+  static uint8_t expect[ROW_BYTES], expect_src[ROW_BYTES];
+  srand(1);
+  for (int i = 0; i < 100000; i++) {
+    for (int k = 0; k < ROW_BYTES; k++) {
+      row[k] = rand();
+      src[k] = rand();
+    }
+    memcpy(expect, row, ROW_BYTES);
+    memcpy(expect_src, src, ROW_BYTES);
+    int n = 1 + rand() % 200, dst_x = rand() % (8 * ROW_BYTES - n + 1), src_x = rand() % (8 * ROW_BYTES - n + 1);
+    int test = i % 5;
+    if (test == 0) {
+      BitplaneOp op = rand() % 5;
+      for (int k = 0; k < n; k++) {
+        bool d = bit(row, dst_x + k), s = bit(src, src_x + k);
+        set_bit(expect, dst_x + k, op == BitplaneCopy ? s : op == BitplaneAnd ? d & s : op == BitplaneOr ? d | s :
+                                   op == BitplaneXor ? d ^ s : d & !s);
+      }
+      bitplane_blit(row, dst_x, src, src_x, n, op);
+      CHECK(!memcmp(row, expect, ROW_BYTES), "blit op %d n %d dst %d src %d", op, n, dst_x, src_x);
+    } else if (test == 1) {
+      bool and_bit = rand() & 1, xor_bit = rand() & 1;
+      for (int k = dst_x; k < dst_x + n; k++) set_bit(expect, k, (bit(row, k) & and_bit) ^ xor_bit);
+      bitplane_apply(row, dst_x, dst_x + n, and_bit, xor_bit);
+      CHECK(!memcmp(row, expect, ROW_BYTES), "apply and %d xor %d [%d, %d)", and_bit, xor_bit, dst_x, dst_x + n);
+    } else if (test == 2) {
+      for (int k = dst_x; k < dst_x + n; k++) {
+        set_bit(expect, k, bit(src, k));
+        set_bit(expect_src, k, bit(row, k));
+      }
+      bitplane_swap(row, src, dst_x, dst_x + n);
+      CHECK(!memcmp(row, expect, ROW_BYTES) && !memcmp(src, expect_src, ROW_BYTES), "swap [%d, %d)", dst_x, dst_x + n);
+    } else if (test == 3) {
+      for (int k = 0; k < n; k++) set_bit(expect, dst_x + k, bit(src, src_x + n - 1 - k));
+      bitplane_reverse(row, dst_x, src, src_x, n);
+      CHECK(!memcmp(row, expect, ROW_BYTES), "reverse n %d dst %d src %d", n, dst_x, src_x);
+    } else {
+      int count = 0, get_n = n < 32 ? n : 32;
+      uint32_t bits = 0;
+      for (int k = dst_x; k < dst_x + n; k++) count += bit(row, k);
+      for (int k = 0; k < get_n; k++) bits |= (uint32_t)bit(row, dst_x + k) << k;
+      CHECK(bitplane_count(row, dst_x, dst_x + n) == count, "count [%d, %d)", dst_x, dst_x + n);
+      CHECK(bitplane_get(row, dst_x, get_n) == bits, "get %d at %d", get_n, dst_x);
+      uint32_t word = rand() ^ (uint32_t)rand() << 16;
+      int ones = 0;
+      for (int k = 0; k < 32; k++) ones += (word >> k) & 1;
+      CHECK(bitplane_popcount(word) == ones, "popcount %08x", (unsigned)word);
+    }
+
+    // a row shifted left in place
+    memcpy(expect, src, ROW_BYTES);
+    int shift = rand() % 40;
+    n = 1 + rand() % (8 * ROW_BYTES - shift - 1);
+    for (int k = 0; k < n; k++) set_bit(expect, k, bit(src, k + shift));
+    bitplane_blit(src, 0, src, shift, n, BitplaneCopy);
+    CHECK(!memcmp(src, expect, ROW_BYTES), "shift %d n %d", shift, n);
+  }
+
+  // rects of framebuffer 1 read as bitplanes with TEST_ROW bytes per row (a whole number of words on both builds)
+  for (int i = 0; i < 2000; i++) {
+    test_fill(i, 50, NULL, 0);
+    GRect rect = GRect(rand() % (8 * TEST_ROW - 1), rand() % TEST_H, 0, 0);
+    rect.size = GSize(1 + rand() % (8 * TEST_ROW - rect.origin.x), 1 + rand() % (TEST_H - rect.origin.y));
+    bool and_bit = rand() & 1, xor_bit = rand() & 1;
+    for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++)
+      for (int x = rect.origin.x; x < rect.origin.x + rect.size.w; x++) {
+        uint8_t *line = test_data[0] + y * TEST_ROW;
+        set_bit(line, x, (bit(line, x) & and_bit) ^ xor_bit);
+      }
+    bitplane_apply_rect(test_data[1], TEST_ROW, rect, and_bit, xor_bit);
+    CHECK(test_same(), "apply_rect %d %d %d %d and %d xor %d", rect.origin.x, rect.origin.y, rect.size.w,
+          rect.size.h, and_bit, xor_bit);
+  }
+
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    BENCH("bitplane_blit 300 pixels, unaligned", bitplane_blit(row, 3, src, 17, 300, BitplaneCopy), 100000);
+    BENCH("bitplane_count 300 pixels", bitplane_count(row, 5, 305), 100000);
+  }
+  return test_done("bitplane");
+}
@@ -0,0 +1,163 @@
+#include "test.h"
+#include "colors4.h"
+
+// 2bit channel c (0 blue .. 3 alpha) of pixel p in a word of 4 pixels
+static int channel(uint32_t word, int p, int c) {
+  return (word >> (8 * p + 2 * c)) & 3;
+}
+
+#ifdef PBL_COLOR
+// per channel pixels: a faded towards b by w/16 (alpha of a kept), a mixed with b by w/16 (opaque) and src over
+// dst by the alpha of src (opaque), all rounded to nearest
+static uint8_t fade(uint8_t a, uint8_t b, int w) {
+  uint8_t faded = a & 0xC0;
+  for (int shift = 0; shift < 6; shift += 2) {
+    int x = (((a >> shift & 3) * (16 - w) + 8) >> 4) + (((b >> shift & 3) * w + 8) >> 4);
+    faded |= (x > 3 ? 3 : x) << shift;
+  }
+  return faded;
+}
+
+static uint8_t mix(uint8_t a, uint8_t b, int w) {
+  uint8_t mixed = 0xC0;
+  for (int shift = 0; shift < 6; shift += 2)
+    mixed |= (((a >> shift & 3) * (16 - w) + (b >> shift & 3) * w + 8) >> 4) << shift;
+  return mixed;
+}
+
+static uint8_t over(uint8_t dst, uint8_t src) {
+  int alpha = src >> 6;
+  uint8_t result = 0xC0;
+  for (int shift = 0; shift < 6; shift += 2)
+    result |= ((2 * ((src >> shift & 3) * alpha + (dst >> shift & 3) * (3 - alpha)) + 3) / 6) << shift;
+  return result;
+}
+#endif
+
+// per pixel fade of the part of rect on the screen in framebuffer 0 (filled from level 8 on on Aplite)
+static void reference_fade(GRect rect, GColor color, int level) {
+  if (level > 16) level = 16;
+  for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++)
+    for (int x = rect.origin.x; x < rect.origin.x + rect.size.w; x++) {
+      if (x < 0 || y < 0 || x >= TEST_W || y >= TEST_H || level == 0) continue;
+      #ifdef PBL_COLOR
+        test_set(0, x, y, (GColor8){.argb = fade(test_pixel(0, x, y).argb, color.argb, level)});
+      #else
+        if (level >= 8) test_set(0, x, y, color);
+      #endif
+    }
+}
+
+// per pixel blend of bitmap (top left corner at the rect origin) in framebuffer 0, or a fade by the color's
+// alpha times opacity without one; on Aplite the bitmap is copied from opacity 8 on
+static void reference_blend(GRect rect, GBitmap *bitmap, GColor color, int opacity) {
+  if (opacity > 16) opacity = 16;
+  if (!bitmap) {
+    reference_fade(rect, color, (opacity * color.a + 1) / 3);
+    return;
+  }
+  for (int y = 0; y < rect.size.h && y < bitmap->bounds.size.h; y++)
+    for (int x = 0; x < rect.size.w && x < bitmap->bounds.size.w; x++) {
+      int sx = rect.origin.x + x, sy = rect.origin.y + y;
+      if (sx < 0 || sy < 0 || sx >= TEST_W || sy >= TEST_H || opacity == 0) continue;
+      const uint8_t *row = bitmap->data + y * bitmap->bytes_per_row;
+      #ifdef PBL_COLOR
+        uint8_t pixel = test_pixel(0, sx, sy).argb, blended = over(pixel, row[x]);
+        test_set(0, sx, sy, (GColor8){.argb = opacity < 16 ? mix(pixel, blended, opacity) : blended});
+      #else
+        if (opacity >= 8) test_set(0, sx, sy, (row[x >> 3] >> (x & 7)) & 1 ? GColorWhite : GColorBlack);
+      #endif
+    }
+}
+
+// colors4 helpers against per channel arithmetic on random words (both builds); effect_fade and effect_blend
+// (a bitmap or a color, opacities and levels past 16, rects partly off the screen) against per pixel references,
+// and the fade and color blend as palette entries give the same pixels. Benchmarks with "bench"
+int main(int argc, char **argv) {
+  srand(1);
+  for (int i = 0; i < 200000; i++) {
+    uint32_t a = rand() ^ (uint32_t)rand() << 16, b = rand() ^ (uint32_t)rand() << 16;
+    int weight = rand() % 17;
+    uint32_t sum = colors4_add(a, b), diff = colors4_sub(a, b), avg = colors4_avg(a, b), scaled = colors4_scale(a, weight);
+    uint32_t mixed = colors4_mix(a, b, weight), composited = colors4_over(a, b);
+    bool same = colors4_splat((GColor8){.argb = a & 0xFF}) == (a & 0xFF) * 0x01010101u;
+    for (int p = 0; p < 4; p++)
+      for (int c = 0; c < 4; c++) {
+        int x = channel(a, p, c), y = channel(b, p, c);
+        same = same && channel(sum, p, c) == (x + y > 3 ? 3 : x + y) && channel(diff, p, c) == (x < y ? 0 : x - y) &&
+               channel(avg, p, c) == (x + y) / 2 && channel(scaled, p, c) == (c == 3 ? x : (x * weight + 8) >> 4);
+        int alpha = channel(b, p, 3);
+        same = same && channel(mixed, p, c) == (c == 3 ? 3 : (x * (16 - weight) + y * weight + 8) >> 4) &&
+               channel(composited, p, c) == (c == 3 ? 3 : (2 * (y * alpha + x * (3 - alpha)) + 3) / 6);
+      }
+    CHECK(same, "colors4 %08x %08x weight %d", (unsigned)a, (unsigned)b, weight);
+  }
+
+  for (int i = 0; i < 1000; i++) {
+    test_fill(i, 50, NULL, 0);
+    GRect rect = i % 4 == 3 ? GRect(rand() % 200 - 40, rand() % 220 - 40, rand() % 120, rand() % 120) : test_rect();
+    EffectFade fade = { .color = {.argb = rand()}, .level = rand() % 20 };
+    if (i % 8 == 1) fade.color = GColorWhite;
+    reference_fade(rect, fade.color, fade.level);
+    effect_fade(&test_ctx[1], rect, &fade);
+    CHECK(test_same(), "fade rect %d %d %d %d color %02x level %d", rect.origin.x, rect.origin.y, rect.size.w,
+          rect.size.h, fade.color.argb, fade.level);
+  }
+
+  // overlays in the framebuffer format with random pixels (all alphas on Basalt)
+  GBitmap *overlay = gbitmap_create_blank(GSize(70, 60), TEST_FORMAT);
+  for (int k = 0; k < 60 * overlay->bytes_per_row; k++) overlay->data[k] = rand();
+  for (int i = 0; i < 1000; i++) {
+    test_fill(2000 + i, 50, NULL, 0);
+    GRect rect = test_rect();
+    rect.origin.x -= rand() % 40;
+    rect.origin.y -= rand() % 40;
+    rect.size.w += rand() % 60;
+    EffectBlend blend = { .bitmap = i & 1 ? overlay : NULL, .color = {.argb = rand()}, .opacity = rand() % 20 };
+    reference_blend(rect, blend.bitmap, blend.color, blend.opacity);
+    effect_blend(&test_ctx[1], rect, &blend);
+    CHECK(test_same(), "blend %s rect %d %d %d %d color %02x opacity %d", blend.bitmap ? "bitmap" : "color",
+          rect.origin.x, rect.origin.y, rect.size.w, rect.size.h, blend.color.argb, blend.opacity);
+  }
+
+  // an overlay in the other format is not drawn
+  GBitmap *other = gbitmap_create_blank(GSize(70, 60), TEST_FORMAT == GBitmapFormat8Bit ? GBitmapFormat1Bit : GBitmapFormat8Bit);
+  test_fill(3000, 50, NULL, 0);
+  effect_blend(&test_ctx[1], GRect(0, 0, TEST_W, TEST_H), &(EffectBlend){ .bitmap = other, .opacity = 16 });
+  CHECK(test_same(), "overlay in the other format");
+
+  for (int i = 0; i < 500; i++) {
+    EffectFade fade = { .color = {.argb = rand()}, .level = rand() % 20 };
+    EffectBlend blend = { .color = {.argb = rand()}, .opacity = rand() % 20 };
+    EffectPalette palette;
+    effect_palette_init(&palette);
+    CHECK(effect_palette_add_effect(&palette, effect_fade, &fade), "fade as a palette");
+    CHECK(effect_palette_add_effect(&palette, effect_blend, &blend), "color blend as a palette");
+    test_fill(4000 + i, 50, NULL, 0);
+    GRect rect = test_rect();
+    effect_fade(&test_ctx[0], rect, &fade);
+    effect_blend(&test_ctx[0], rect, &blend);
+    effect_palette_map(&test_ctx[1], rect, &palette);
+    CHECK(test_same(), "palette fade color %02x level %d blend color %02x opacity %d", fade.color.argb, fade.level,
+          blend.color.argb, blend.opacity);
+  }
+  EffectPalette palette;
+  effect_palette_init(&palette);
+  CHECK(!effect_palette_add_effect(&palette, effect_blend, &(EffectBlend){ .bitmap = overlay, .opacity = 16 }),
+        "bitmap blend is not a palette");
+
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    GRect screen = GRect(0, 0, TEST_W, TEST_H);
+    EffectFade blue = { .color = GColorBlue, .level = 6 };
+    EffectBlend full = { .bitmap = overlay, .opacity = 16 }, partial = { .bitmap = overlay, .opacity = 10 };
+    test_fill(1, 50, NULL, 0);
+    BENCH("per pixel fade reference, screen", reference_fade(screen, blue.color, blue.level), 200);
+    BENCH("effect_fade to blue, screen", effect_fade(&test_ctx[1], screen, &blue), 200);
+    BENCH("per pixel blend reference, 70x60", reference_blend(GRect(0, 0, 70, 60), overlay, GColorClear, 10), 2000);
+    BENCH("effect_blend 70x60 opacity 16", effect_blend(&test_ctx[1], GRect(0, 0, 70, 60), &full), 2000);
+    BENCH("effect_blend 70x60 opacity 10", effect_blend(&test_ctx[1], GRect(0, 0, 70, 60), &partial), 2000);
+  }
+  gbitmap_destroy(overlay);
+  gbitmap_destroy(other);
+  return test_done("blend");
+}
@@ -0,0 +1,129 @@
+#include "test.h"
+#include "dither.h"
+
+#ifdef PBL_COLOR
+// per pixel box blur of rect in framebuffer 0, passes times: each channel averaged over the window clipped to
+// the rect, packed like GColorFromRGB(total * 0x55 / points)
+static void reference_box(GRect rect, int radius, int passes) {
+  static uint8_t out[TEST_SIZE];
+  for (int pass = 0; pass < (passes ? passes : 1); pass++) {
+    memcpy(out, test_data[0], TEST_SIZE);
+    for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++)
+      for (int x = rect.origin.x; x < rect.origin.x + rect.size.w; x++) {
+        int total[3] = {0, 0, 0}, points = 0;
+        for (int wy = y - radius; wy <= y + radius; wy++)
+          for (int wx = x - radius; wx <= x + radius; wx++) {
+            if (wx < rect.origin.x || wx >= rect.origin.x + rect.size.w || wy < rect.origin.y || wy >= rect.origin.y + rect.size.h) continue;
+            GColor color = test_pixel(0, wx, wy);
+            total[0] += color.r;
+            total[1] += color.g;
+            total[2] += color.b;
+            points++;
+          }
+        out[y * TEST_ROW + x] = GColorFromRGB(total[0] * 0x55 / points, total[1] * 0x55 / points, total[2] * 0x55 / points).argb;
+      }
+    memcpy(test_data[0], out, TEST_SIZE);
+  }
+}
+#else
+// per pixel Aplite blur of rect in framebuffer 0: one box whose radius has the variance of the passes (the
+// smallest R >= radius with R(R+1) >= passes * radius(radius+1), at most the larger side - 1), its white
+// share over the window clipped to the rect dithered with the Bayer 4x4 threshold at the screen position
+static void reference_box(GRect rect, int radius, int passes) {
+  static uint8_t before[TEST_SIZE];
+  memcpy(before, test_data[0], TEST_SIZE);
+  int box = radius, max_radius = (rect.size.w > rect.size.h ? rect.size.w : rect.size.h) - 1;
+  while (box * (box + 1) < (passes ? passes : 1) * radius * (radius + 1)) box++;
+  if (box > max_radius) box = max_radius;
+  if (box == 0) return;
+  for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++)
+    for (int x = rect.origin.x; x < rect.origin.x + rect.size.w; x++) {
+      int white = 0, points = 0;
+      for (int wy = y - box; wy <= y + box; wy++)
+        for (int wx = x - box; wx <= x + box; wx++) {
+          if (wx < rect.origin.x || wx >= rect.origin.x + rect.size.w || wy < rect.origin.y || wy >= rect.origin.y + rect.size.h) continue;
+          white += (before[wy * TEST_ROW + wx / 8] >> (wx % 8)) & 1;
+          points++;
+        }
+      test_set(0, x, y, 32 * white > (2 * dither_bayer4[y & 3][x & 3] + 1) * points ? GColorWhite : GColorBlack);
+    }
+}
+#endif
+
+// effect_blur against a per-pixel window average (Basalt) or a dithered window count (Aplite) with random rects,
+// radii and passes, and on Basalt against the baseline kernel, which left the last row of the rect as it was.
+// The typed blur gives the same pixels as EL_BLUR. Benchmarks with "bench"
+int main(int argc, char **argv) {
+  GRect screen = GRect(0, 0, TEST_W, TEST_H);
+  #ifdef PBL_COLOR
+    static const uint8_t palette[] = { GColorBlackARGB8, GColorWhiteARGB8, GColorRedARGB8, GColorBlueARGB8 };
+    for (int i = 0; i < 300; i++) {
+      test_fill(i, 50, palette, i & 1 ? 4 : 0);
+      GRect rect = i % 50 == 0 ? screen : test_rect();
+      int radius = 1 + rand() % 10, passes = i % 4;
+      reference_box(rect, radius, passes);
+      effect_blur(&test_ctx[1], rect, EL_BLUR(radius, passes));
+      CHECK(test_same(), "rect %d %d %d %d radius %d passes %d", rect.origin.x, rect.origin.y, rect.size.w,
+            rect.size.h, radius, passes);
+    }
+
+    // windows wider than the rect average all of it
+    for (int i = 0; i < 20; i++) {
+      test_fill(1000 + i, 50, NULL, 0);
+      GRect rect = GRect(rand() % 100, rand() % 100, 1 + rand() % 30, 1 + rand() % 30);
+      reference_box(rect, 40, 1);
+      effect_blur(&test_ctx[1], rect, EL_BLUR(40, 1));
+      CHECK(test_same(), "rect %d %d %d %d radius 40", rect.origin.x, rect.origin.y, rect.size.w, rect.size.h);
+    }
+
+    for (int i = 0; i < 300; i++) {
+      test_fill(2000 + i, 50, NULL, 0);
+      GRect rect = i == 0 ? screen : test_rect();
+      int radius = 1 + i % 7;
+      if (rect.size.h <= radius + 1) continue;
+      baseline_effect_blur(&test_ctx[0], rect, (void*)radius);
+      effect_blur(&test_ctx[1], rect, (void*)radius);
+      int last = (rect.origin.y + rect.size.h - 1) * TEST_ROW;
+      memcpy(test_data[0] + last, test_data[1] + last, TEST_ROW);
+      CHECK(test_same(), "baseline rect %d %d %d %d radius %d", rect.origin.x, rect.origin.y, rect.size.w,
+            rect.size.h, radius);
+    }
+  #else
+    // random pixels at half and 40% white, white with black stripes and all white
+    static const int white_percents[] = { 50, 0, 40, 100 };
+    for (int i = 0; i < 400; i++) {
+      test_fill(i, white_percents[i % 4], NULL, 0);
+      if (i % 4 == 1)
+        for (int k = 0; k < TEST_SIZE; k++) test_data[0][k] = test_data[1][k] = k % 7 ? 0xFF : 0x00;
+      GRect rect = i % 50 == 0 ? screen : test_rect();
+      int radius = 1 + rand() % 12, passes = i % 4;
+      reference_box(rect, radius, passes);
+      effect_blur(&test_ctx[1], rect, EL_BLUR(radius, passes));
+      CHECK(test_same(), "rect %d %d %d %d radius %d passes %d", rect.origin.x, rect.origin.y, rect.size.w,
+            rect.size.h, radius, passes);
+    }
+  #endif
+
+  for (int i = 0; i < 40; i++) {
+    EffectBlurParams params = { .radius = 1 + rand() % 12, .passes = i % 4 };
+    EffectInstance blur;
+    effect_instance_init(&blur, &effect_type_blur, &params);
+    test_fill(3000 + i, 50, NULL, 0);
+    GRect rect = test_rect();
+    effect_blur(&test_ctx[0], rect, EL_BLUR(params.radius, params.passes));
+    effect_run(&test_ctx[1], rect, &blur);
+    CHECK(test_same(), "typed blur radius %d passes %d", params.radius, params.passes);
+    effect_instance_destroy(&blur);
+  }
+
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    test_fill(1, 50, NULL, 0);
+    #ifdef PBL_COLOR
+      BENCH("baseline effect_blur r=3, screen", baseline_effect_blur(&test_ctx[0], screen, (void*)3), 20);
+    #endif
+    BENCH("effect_blur r=3, screen", effect_blur(&test_ctx[1], screen, (void*)3), 200);
+    BENCH("effect_blur r=20, screen", effect_blur(&test_ctx[1], screen, (void*)20), 200);
+    BENCH("effect_blur EL_BLUR(3,3), screen", effect_blur(&test_ctx[1], screen, EL_BLUR(3, 3)), 200);
+  }
+  return test_done("blur");
+}
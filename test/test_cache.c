@@ -0,0 +1,62 @@
+#include "test.h"
+
+// new random pixels on both framebuffers everywhere except rect
+static void refill_outside(unsigned seed, GRect rect) {
+  static uint8_t kept[TEST_SIZE];
+  memcpy(kept, test_data[0], TEST_SIZE);
+  test_fill(seed, 50, NULL, 0);
+  for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++)
+    for (int x = rect.origin.x; x < rect.origin.x + rect.size.w; x++) {
+      #ifdef PBL_COLOR
+        test_data[0][y * TEST_ROW + x] = kept[y * TEST_ROW + x];
+      #else
+        uint8_t bit = 1 << (x % 8);
+        test_data[0][y * TEST_ROW + x / 8] = (test_data[0][y * TEST_ROW + x / 8] & ~bit) | (kept[y * TEST_ROW + x / 8] & bit);
+      #endif
+    }
+  memcpy(test_data[1], test_data[0], TEST_SIZE);
+}
+
+// effect_cached: default budget per platform, cached results equal fresh runs, also for effects that read
+// outside their rect (lens)
+int main(int argc, char **argv) {
+  EffectCacheStats stats;
+  GRect rect = GRect(40, 50, 60, 60);
+
+  // default budget: off on Aplite
+  EffectCached blur = { effect_blur, (void*)3, 0 };
+  test_fill(1, 50, NULL, 0);
+  effect_cached(&test_ctx[1], rect, &blur);
+  test_fill(1, 50, NULL, 0);
+  effect_cached(&test_ctx[1], rect, &blur);
+  effect_cache_get_stats(&stats);
+  #ifdef PBL_COLOR
+    CHECK(stats.hits == 1 && stats.bytes > 0, "hits %u bytes %u", (unsigned)stats.hits, (unsigned)stats.bytes);
+  #else
+    CHECK(stats.hits == 0 && stats.misses == 0 && stats.bytes == 0, "caching is off by default");
+  #endif
+
+  effect_cache_set_budget(24 * 1024);
+  uint32_t hits = stats.hits;
+  for (int i = 0; i < 30; i++) { // same inputs again: copied back, and equal to running the effect
+    test_fill(2 + i % 3, 50, NULL, 0);
+    effect_blur(&test_ctx[0], rect, (void*)3);
+    effect_cached(&test_ctx[1], rect, &blur);
+    CHECK(test_same(), "blur run %d", i);
+  }
+  effect_cache_get_stats(&stats);
+  CHECK(stats.hits - hits >= 27, "hits %u", (unsigned)(stats.hits - hits));
+
+  // lens reads around its rect: changing only pixels outside the rect must not give the old result
+  EffectCached lens = { effect_lens, EL_LENS(30, 20), 0 };
+  for (int i = 0; i < 30; i++) {
+    test_fill(10 + i, 50, NULL, 0);
+    effect_cached(&test_ctx[1], rect, &lens);
+    refill_outside(100 + i, rect);
+    effect_lens(&test_ctx[0], rect, EL_LENS(30, 20));
+    effect_cached(&test_ctx[1], rect, &lens);
+    CHECK(test_same(), "lens run %d with new surroundings", i);
+  }
+  effect_cache_clear();
+  return test_done("cache");
+}
@@ -0,0 +1,137 @@
+#include "test.h"
+#include "dither.h"
+
+// screen sized sources: random gray and random GColor8 pixels
+static uint8_t s_gray[TEST_W * TEST_H], s_color[TEST_W * TEST_H];
+
+#ifndef PBL_COLOR
+static void set_bit(int i, int x, int y, bool white) {
+  uint8_t bit = 1 << (x % 8);
+  if (white) test_data[i][y * TEST_ROW + x / 8] |= bit;
+  else test_data[i][y * TEST_ROW + x / 8] &= ~bit;
+}
+
+static uint8_t source_gray(const uint8_t *src, int src_bytes_per_row, DitherSource format, int x, int y) {
+  uint8_t pixel = src[y * src_bytes_per_row + x];
+  return format == DitherSourceColor8 ? dither_luminance((GColor8){.argb = pixel}) : pixel;
+}
+
+// per pixel ordered dithering into framebuffer 0: white when the 7bit gray reaches the Bayer threshold at the
+// screen position
+static void reference_ordered(const uint8_t *src, int src_bytes_per_row, DitherSource format, GRect rect, DitherMethod method) {
+  for (int y = 0; y < rect.size.h; y++)
+    for (int x = 0; x < rect.size.w; x++) {
+      int sx = rect.origin.x + x, sy = rect.origin.y + y;
+      int threshold = method == DitherBayer4 ? 8 * dither_bayer4[sy & 3][sx & 3] + 1 : 2 * dither_bayer8[sy & 7][sx & 7] + 1;
+      set_bit(0, sx, sy, source_gray(src, src_bytes_per_row, format, x, y) >> 1 >= threshold);
+    }
+}
+
+// per pixel Floyd-Steinberg into framebuffer 0, with the errors of the whole rect in one array
+static void reference_diffusion(const uint8_t *src, int src_bytes_per_row, DitherSource format, GRect rect) {
+  static int errors[TEST_H + 1][TEST_W + 2];
+  memset(errors, 0, sizeof(errors));
+  for (int y = 0; y < rect.size.h; y++)
+    for (int x = 0; x < rect.size.w; x++) {
+      int value = source_gray(src, src_bytes_per_row, format, x, y) + errors[y][x + 1];
+      bool white = value >= 128;
+      int error = value - (white ? 255 : 0);
+      set_bit(0, rect.origin.x + x, rect.origin.y + y, white);
+      errors[y][x + 2] += error * 7 / 16;
+      errors[y + 1][x] += error * 3 / 16;
+      errors[y + 1][x + 1] += error * 5 / 16;
+      errors[y + 1][x + 2] += error / 16;
+    }
+}
+
+// largest difference between the white share of a dithered even gray and the gray level, over all 256 levels
+static double white_share_error(DitherMethod method) {
+  static uint8_t gray[TEST_W * TEST_H];
+  double worst = 0;
+  for (int level = 0; level < 256; level++) {
+    memset(gray, level, sizeof(gray));
+    dither_rows(gray, TEST_W, DitherSourceGray8, test_data[1], TEST_ROW, GRect(0, 0, TEST_W, TEST_H), method);
+    int white = 0;
+    for (int y = 0; y < TEST_H; y++)
+      for (int x = 0; x < TEST_W; x++) white += gcolor_equal(test_pixel(1, x, y), GColorWhite);
+    double error = (double)white / (TEST_W * TEST_H) - level / 255.0;
+    if (error < 0) error = -error;
+    if (error > worst) worst = error;
+  }
+  return worst;
+}
+#endif
+
+// dither_rows against per pixel references (Aplite), the Bayer phase of narrowed rects and EffectLayer dirty
+// rects over a data source; "bench" compares the methods in time and in how well they keep gray levels
+int main(int argc, char **argv) {
+  srand(1);
+  for (int i = 0; i < TEST_W * TEST_H; i++) {
+    s_gray[i] = rand() & 0xFF;
+    s_color[i] = 0xC0 | (rand() & 0x3F);
+  }
+  GRect screen = GRect(0, 0, TEST_W, TEST_H);
+
+  #ifndef PBL_COLOR
+    for (int i = 0; i < 600; i++) {
+      test_fill(i, 50, NULL, 0);
+      GRect rect = test_rect();
+      DitherMethod method = i % 3;
+      DitherSource format = i & 4 ? DitherSourceColor8 : DitherSourceGray8;
+      const uint8_t *src = (format == DitherSourceColor8 ? s_color : s_gray) + (i % 7) * TEST_W + i % 11;
+      if (method == DitherDiffusion) reference_diffusion(src, TEST_W, format, rect);
+      else reference_ordered(src, TEST_W, format, rect, method);
+      CHECK(dither_rows(src, TEST_W, format, test_data[1], TEST_ROW, rect, method), "out of memory");
+      CHECK(test_same(), "method %d format %d rect %d %d %d %d", method, format, rect.origin.x, rect.origin.y,
+            rect.size.w, rect.size.h);
+    }
+  #endif
+
+  // an even gray dithered on a narrowed rect gives the pixels of the whole screen run
+  for (int i = 0; i < 200; i++) {
+    EffectDither gray = { .method = i & 1 ? DitherBayer8 : DitherBayer4, .gray = rand() & 0xFF };
+    CHECK(effect_halo(effect_dither, &gray) == 0, "halo of an ordered gray");
+    test_fill(i, 50, NULL, 0);
+    GRect rect = test_rect();
+    effect_dither(&test_ctx[0], screen, &gray);
+    effect_dither(&test_ctx[1], rect, &gray);
+    bool same = true;
+    for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++)
+      for (int x = rect.origin.x; x < rect.origin.x + rect.size.w; x++)
+        same = same && gcolor_equal(test_pixel(0, x, y), test_pixel(1, x, y));
+    CHECK(same, "gray %d method %d rect %d %d %d %d", gray.gray, gray.method, rect.origin.x, rect.origin.y,
+          rect.size.w, rect.size.h);
+  }
+
+  // a data source stays anchored at the frame origin when a dirty rect is marked
+  static const DitherMethod methods[] = { DitherBayer4, DitherBayer8, DitherDiffusion };
+  for (int m = 0; m < 3; m++) {
+    EffectDither data = { .data = s_color, .bytes_per_row = TEST_W, .format = DitherSourceColor8, .method = methods[m] };
+    CHECK(effect_halo(effect_dither, &data) == EFFECT_HALO_FRAME, "halo of a data source");
+    EffectLayer *reference = effect_layer_create(screen), *effect_layer = effect_layer_create(screen);
+    effect_layer_add_effect(reference, effect_dither, &data);
+    effect_layer_add_effect(effect_layer, effect_dither, &data);
+    test_dirty_frames(reference, effect_layer, NULL, 0, 50, "data source");
+    effect_layer_destroy(reference);
+    effect_layer_destroy(effect_layer);
+  }
+
+  #ifndef PBL_COLOR
+    if (argc > 1 && !strcmp(argv[1], "bench")) {
+      static const char *names[] = { "Bayer4", "Bayer8", "Diffusion" };
+      char label[64];
+      for (int m = 0; m < 3; m++) {
+        snprintf(label, sizeof(label), "dither_rows %s gray, screen", names[m]);
+        BENCH(label, dither_rows(s_gray, TEST_W, DitherSourceGray8, test_data[1], TEST_ROW, screen, methods[m]), 200);
+        snprintf(label, sizeof(label), "dither_rows %s GColor8, screen", names[m]);
+        BENCH(label, dither_rows(s_color, TEST_W, DitherSourceColor8, test_data[1], TEST_ROW, screen, methods[m]), 200);
+      }
+      BENCH("per pixel Bayer8 reference, screen", reference_ordered(s_gray, TEST_W, DitherSourceGray8, screen, DitherBayer8), 200);
+      for (int m = 0; m < 3; m++) {
+        snprintf(label, sizeof(label), "%s white share error, worst gray", names[m]);
+        printf("  %-40s %9.3f\n", label, white_share_error(methods[m]));
+      }
+    }
+  #endif
+  return test_done("dither");
+}
@@ -0,0 +1,35 @@
+#include "test.h"
+
+// EffectLayer fuses a run of n colour effects into one pass: same output as running them one by one, with
+// the pass counter at 1 instead of n, and at 2n - 1 once a blur between every two of them breaks the run
+int main(int argc, char **argv) {
+  GRect screen = GRect(0, 0, TEST_W, TEST_H);
+  static EffectColorpair swap = { .firstColor = GColorBlack, .secondColor = GColorWhite };
+  static EffectColorpair colorize = { .firstColor = GColorWhite, .secondColor = GColorBlack };
+  static struct { effect_cb *effect; void *param; } colour[] = {
+    { effect_invert, NULL }, { effect_colorswap, &swap }, { effect_invert_bw_only, NULL },
+    { effect_colorize, &colorize }, { effect_invert_brightness, NULL },
+  };
+  for (int n = 1; n <= 5; n++) {
+    EffectLayer *effect_layer = effect_layer_create(screen);
+    test_fill(n, 50, NULL, 0);
+    effect_reset_pass_count();
+    for (int i = 0; i < n; i++) {
+      effect_call(colour[i].effect, &test_ctx[0], screen, colour[i].param);
+      effect_layer_add_effect(effect_layer, colour[i].effect, colour[i].param);
+    }
+    CHECK(effect_get_pass_count() == (uint32_t)n, "%d effects one by one: %u passes", n, (unsigned)effect_get_pass_count());
+    effect_reset_pass_count();
+    test_update(effect_layer, 1);
+    CHECK(test_same(), "fused output of %d effects", n);
+    CHECK(effect_get_pass_count() == 1, "%d fused effects: %u passes", n, (unsigned)effect_get_pass_count());
+
+    for (int i = n - 1; i > 0; i--) effect_layer_insert_effect(effect_layer, i, effect_blur, (void*)1);
+    effect_reset_pass_count();
+    test_update(effect_layer, 1);
+    CHECK(effect_get_pass_count() == (uint32_t)(2 * n - 1), "%d effects split by blurs: %u passes", n,
+          (unsigned)effect_get_pass_count());
+    effect_layer_destroy(effect_layer);
+  }
+  return test_done("fusion");
+}
@@ -0,0 +1,21 @@
+#include "test.h"
+
+// effect_invert against the per-pixel baseline: same output on random rects, and its speed with "bench"
+int main(int argc, char **argv) {
+  for (int i = 0; i < 2000; i++) {
+    test_fill(i, 50, NULL, 0);
+    GRect rect = i == 0 ? GRect(0, 0, TEST_W, TEST_H) : test_rect();
+    baseline_effect_invert(&test_ctx[0], rect, NULL);
+    effect_invert(&test_ctx[1], rect, NULL);
+    CHECK(test_same(), "rect %d %d %d %d", rect.origin.x, rect.origin.y, rect.size.w, rect.size.h);
+  }
+
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    GRect screen = GRect(0, 0, TEST_W, TEST_H), digits = GRect(20, 60, 104, 48);
+    BENCH("baseline effect_invert, screen", baseline_effect_invert(&test_ctx[0], screen, NULL), 1000);
+    BENCH("effect_invert, screen", effect_invert(&test_ctx[1], screen, NULL), 1000);
+    BENCH("baseline effect_invert, 104x48 at 20,60", baseline_effect_invert(&test_ctx[0], digits, NULL), 1000);
+    BENCH("effect_invert, 104x48 at 20,60", effect_invert(&test_ctx[1], digits, NULL), 1000);
+  }
+  return test_done("invert");
+}
@@ -0,0 +1,104 @@
+#include "test.h"
+
+static int s_user_captures;
+
+// a callback written against the plain SDK: captures the framebuffer itself and inverts the rect
+static void user_invert(GContext *ctx, GRect position, void *param) {
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+  if (!fb) return;
+  ++s_user_captures;
+  for (int y = position.origin.y; y < position.origin.y + position.size.h; y++)
+    for (int x = position.origin.x; x < position.origin.x + position.size.w; x++) {
+      #ifdef PBL_COLOR
+        fb->data[y * fb->bytes_per_row + x] ^= 0x3F;
+      #else
+        fb->data[y * fb->bytes_per_row + x / 8] ^= 1 << (x % 8);
+      #endif
+    }
+  graphics_release_frame_buffer(ctx, fb);
+}
+
+// EffectLayer chains: custom callbacks can capture the framebuffer, library effects share one capture
+int main(int argc, char **argv) {
+  GRect screen = GRect(0, 0, TEST_W, TEST_H);
+  EffectLayer *effect_layer = effect_layer_create(screen);
+  effect_layer_add_effect(effect_layer, effect_invert, NULL);
+  effect_layer_add_effect(effect_layer, effect_mirror_vertical, NULL);
+  effect_layer_add_effect(effect_layer, effect_blur, (void*)2);
+
+  // library effects only: one capture for the whole chain, same output as the effects one by one
+  test_fill(1, 50, NULL, 0);
+  effect_invert(&test_ctx[0], screen, NULL);
+  effect_mirror_vertical(&test_ctx[0], screen, NULL);
+  effect_blur(&test_ctx[0], screen, (void*)2);
+  effect_reset_capture_count();
+  test_update(effect_layer, 1);
+  CHECK(test_same(), "chain output");
+  CHECK(effect_get_capture_count() == 1, "captures %u", (unsigned)effect_get_capture_count());
+  CHECK(!test_ctx[1].captured, "framebuffer still captured after the update");
+
+  // a plain SDK callback in the middle (directly, and through effect_run) gets the framebuffer
+  static EffectCallback callback = { user_invert, NULL };
+  static EffectInstance instance;
+  effect_instance_init(&instance, &effect_type_callback, &callback);
+  effect_layer_insert_effect(effect_layer, 1, user_invert, NULL);
+  effect_layer_insert_effect(effect_layer, 3, effect_run, &instance);
+  test_fill(2, 50, NULL, 0);
+  effect_invert(&test_ctx[0], screen, NULL);
+  effect_invert(&test_ctx[0], screen, NULL);
+  effect_mirror_vertical(&test_ctx[0], screen, NULL);
+  effect_invert(&test_ctx[0], screen, NULL);
+  effect_blur(&test_ctx[0], screen, (void*)2);
+  s_user_captures = 0;
+  effect_reset_capture_count();
+  test_update(effect_layer, 1);
+  CHECK(s_user_captures == 2, "user callbacks captured %d times", s_user_captures);
+  CHECK(test_same(), "chain output with user callbacks");
+  // invert, mirror after the first callback, blur after the second
+  CHECK(effect_get_capture_count() == 3, "captures %u", (unsigned)effect_get_capture_count());
+  CHECK(!test_ctx[1].captured, "framebuffer still captured after the update");
+
+  effect_layer_destroy(effect_layer);
+
+  // dirty rects: the same output as whole frame updates, for a chain of colour effects (the marked rect),
+  // with shadows and outlines (the input copy around it) and with blur, mirror or bitmap blend (the frame)
+  static EffectColorpair colorize = { .firstColor = GColorWhite, .secondColor = GColorBlack };
+  static EffectOffset shadow = { .orig_color = GColorWhite, .offset_color = GColorRed, .offset_x = 3, .offset_y = 3 };
+  static EffectOffset dilate = { .orig_color = GColorWhite, .offset_color = GColorWhite, .offset_x = 2, .offset_y = 1, .option = 8 };
+  static EffectOffset outline = { .orig_color = GColorBlack, .offset_color = GColorBlue, .offset_x = 2, .offset_y = -1 };
+  GBitmap *overlay = gbitmap_create_blank(GSize(TEST_W, TEST_H), TEST_FORMAT);
+  srand(7);
+  for (int y = 0; y < TEST_H; y++)
+    for (int x = 0; x < TEST_W; x++) {
+      #ifdef PBL_COLOR
+        overlay->data[y * overlay->bytes_per_row + x] = rand() & 0xFF;
+      #else
+        if (rand() & 1) overlay->data[y * overlay->bytes_per_row + x / 8] |= 1 << (x % 8);
+      #endif
+    }
+  static EffectBlend blend = { .opacity = 12 };
+  blend.bitmap = overlay;
+  static const struct { const char *name; effect_cb *effects[3]; void *params[3]; } chains[] = {
+    { "invert colorize", { effect_invert, effect_colorize }, { NULL, &colorize } },
+    { "invert shadow", { effect_invert, effect_shadow }, { NULL, &shadow } },
+    { "shadow invert dilate", { effect_shadow, effect_invert, effect_outline }, { &shadow, NULL, &dilate } },
+    { "outline shadow", { effect_outline, effect_shadow }, { &outline, &shadow } },
+    { "invert blur", { effect_invert, effect_blur }, { NULL, (void*)2 } },
+    { "mirror", { effect_mirror_vertical }, { NULL } },
+    { "blend", { effect_blend }, { &blend } },
+  };
+  static const uint8_t palette[] = { GColorBlackARGB8, GColorWhiteARGB8, GColorRedARGB8, GColorBlueARGB8 };
+  for (size_t c = 0; c < sizeof(chains) / sizeof(chains[0]); c++) {
+    EffectLayer *reference = effect_layer_create(screen);
+    effect_layer = effect_layer_create(screen);
+    for (int i = 0; i < 3 && chains[c].effects[i]; i++) {
+      effect_layer_add_effect(reference, chains[c].effects[i], chains[c].params[i]);
+      effect_layer_add_effect(effect_layer, chains[c].effects[i], chains[c].params[i]);
+    }
+    test_dirty_frames(reference, effect_layer, palette, 4, 200, chains[c].name);
+    effect_layer_destroy(reference);
+    effect_layer_destroy(effect_layer);
+  }
+  gbitmap_destroy(overlay);
+  return test_done("layer");
+}
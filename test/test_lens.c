@@ -0,0 +1,88 @@
+#include "test.h"
+#include "math.h"
+
+// shift of the lens for a pixel i away from the centre, computed per pixel like the original kernel (past the
+// focal point, where asin has no meaning, the source is pushed off the screen)
+static int shift(int i, int focal, int obj_dis) {
+  return i < focal ? (int)(my_tan(my_asin(i / (float)focal)) * obj_dis) : 10000;
+}
+
+// per pixel lens in framebuffer 0, in the order of the original kernel: pixels off the screen are skipped and
+// sources are clamped to the screen
+static void reference_lens(GRect rect, int focal, int obj_dis) {
+  int xCn = rect.origin.x + rect.size.w / 2, yCn = rect.origin.y + rect.size.h / 2;
+  int r = (rect.size.w < rect.size.h ? rect.size.w : rect.size.h) / 2;
+  for (int y = r; y >= 0; --y)
+    for (int x = r; x >= 0; --x) {
+      if (x * x + y * y >= r * r) continue;
+      int Y1 = shift(y, focal, obj_dis), X1 = shift(x, focal, obj_dis);
+      for (int q = 0; q < 4; q++) {
+        int px = xCn + (q & 1 ? -x : x), py = yCn + (q & 2 ? -y : y);
+        int sx = xCn + (q & 1 ? -X1 : X1), sy = yCn + (q & 2 ? -Y1 : Y1);
+        if (px < 0 || py < 0 || px >= TEST_W || py >= TEST_H) continue;
+        sx = sx < 0 ? 0 : sx >= TEST_W ? TEST_W - 1 : sx;
+        sy = sy < 0 ? 0 : sy >= TEST_H ? TEST_H - 1 : sy;
+        test_set(0, px, py, test_pixel(0, sx, sy));
+      }
+    }
+}
+
+// effect_lens against the original kernel on lenses whose pixels and sources stay on the screen, and against a
+// per-pixel reference that clamps on lenses partly off the screen or with focal points inside them. The
+// displacement table follows parameter and size changes, the typed lens gives the same pixels
+int main(int argc, char **argv) {
+  for (int i = 0; i < 400; i++) {
+    test_fill(i, 50, NULL, 0);
+    int size = 4 + rand() % 80, r = size / 2, focal = r + 1 + rand() % 60, obj_dis = 1 + rand() % 30;
+    int reach = shift(r, focal, obj_dis) > r ? shift(r, focal, obj_dis) : r;
+    if (2 * reach + 2 > TEST_W) continue;
+    int x = reach + rand() % (TEST_W - 2 * reach - 1), y = reach + rand() % (TEST_H - 2 * reach - 1);
+    int w = size + (i & 1 ? rand() % 20 : 0), h = size + (i & 1 ? 0 : rand() % 20);
+    GRect rect = GRect(x - w / 2, y - h / 2, w, h);
+    baseline_effect_lens(&test_ctx[0], rect, EL_LENS(focal, obj_dis));
+    effect_lens(&test_ctx[1], rect, EL_LENS(focal, obj_dis));
+    CHECK(test_same(), "baseline rect %d %d %d %d focal %d distance %d", rect.origin.x, rect.origin.y, rect.size.w,
+          rect.size.h, focal, obj_dis);
+  }
+
+  for (int i = 0; i < 600; i++) {
+    test_fill(1000 + i, 50, NULL, 0);
+    GRect rect = GRect(rand() % 200 - 40, rand() % 220 - 40, 1 + rand() % 120, 1 + rand() % 120);
+    int focal = 1 + rand() % 100, obj_dis = rand() % 40;
+    reference_lens(rect, focal, obj_dis);
+    effect_lens(&test_ctx[1], rect, EL_LENS(focal, obj_dis));
+    CHECK(test_same(), "rect %d %d %d %d focal %d distance %d", rect.origin.x, rect.origin.y, rect.size.w,
+          rect.size.h, focal, obj_dis);
+  }
+
+  // only one parameter changes from call to call
+  for (int i = 0; i < 60; i++) {
+    test_fill(3000 + i, 50, NULL, 0);
+    GRect rect = GRect(22, 34, 100, 100 - (i >= 40 ? 2 * (i - 40) : 0));
+    int focal = i >= 20 && i < 40 ? 50 + i : 70, obj_dis = i < 20 ? i : 20;
+    reference_lens(rect, focal, obj_dis);
+    effect_lens(&test_ctx[1], rect, EL_LENS(focal, obj_dis));
+    CHECK(test_same(), "sequence %d rect %d %d %d %d focal %d distance %d", i, rect.origin.x, rect.origin.y,
+          rect.size.w, rect.size.h, focal, obj_dis);
+  }
+
+  for (int i = 0; i < 50; i++) {
+    EffectLensParams params = { .focal = 20 + rand() % 80, .obj_dis = rand() % 40 };
+    EffectInstance lens;
+    effect_instance_init(&lens, &effect_type_lens, &params);
+    test_fill(2000 + i, 50, NULL, 0);
+    GRect rect = test_rect();
+    effect_lens(&test_ctx[0], rect, EL_LENS(params.focal, params.obj_dis));
+    effect_run(&test_ctx[1], rect, &lens);
+    CHECK(test_same(), "typed lens focal %d distance %d", params.focal, params.obj_dis);
+    effect_instance_destroy(&lens);
+  }
+
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    GRect lens = GRect(22, 34, 100, 100);
+    test_fill(1, 50, NULL, 0);
+    BENCH("baseline effect_lens 100x100", baseline_effect_lens(&test_ctx[0], lens, EL_LENS(60, 30)), 100);
+    BENCH("effect_lens 100x100", effect_lens(&test_ctx[1], lens, EL_LENS(60, 30)), 1000);
+  }
+  return test_done("lens");
+}
@@ -0,0 +1,65 @@
+#include "test.h"
+
+// random bitmap in the framebuffer format; mask ones hold mask_color, black and (on Basalt) transparent pixels
+static GBitmap* random_bitmap(GSize size, bool mask) {
+  GBitmap *bitmap = gbitmap_create_blank(size, TEST_FORMAT);
+  for (int y = 0; y < size.h; y++)
+    for (int x = 0; x < size.w; x++) {
+      uint8_t *row = bitmap->data + y * bitmap->bytes_per_row;
+      #ifdef PBL_COLOR
+        static const uint8_t mask_pixels[] = { GColorWhiteARGB8, GColorBlackARGB8, 0 };
+        row[x] = mask ? mask_pixels[rand() % 3] : 0xC0 | (rand() & 0x3F);
+      #else
+        if (rand() & 1) row[x >> 3] |= 1 << (x & 7);
+      #endif
+    }
+  return bitmap;
+}
+
+// effect_mask with a cache filled by earlier frames gives the same output as with a new one, for bitmap masks
+// with pixels that are not mask_color and for rects that only differ in their (clipped) origin
+int main(int argc, char **argv) {
+  srand(1);
+  GBitmap *mask_bitmap = random_bitmap(GSize(TEST_W, TEST_H), true);
+  GBitmap *background = random_bitmap(GSize(TEST_W, TEST_H), false);
+  EffectMask cached = { .bitmap_mask = mask_bitmap, .bitmap_background = background,
+                        .mask_color = GColorWhite, .background_color = GColorBlue };
+  #ifndef PBL_COLOR
+    cached.background_color = GColorBlack;
+  #endif
+  static const GRect rects[] = { {{10, 20}, {60, 50}}, {{30, 20}, {60, 50}}, {{100, 140}, {60, 50}},
+                                 {{110, 150}, {60, 50}}, {{-20, -10}, {60, 50}}, {{0, 0}, {TEST_W, TEST_H}} };
+  for (int i = 0; i < 200; i++) {
+    GRect rect = rects[i % 6];
+    test_fill(i, 50, NULL, 0);
+    EffectMask fresh = cached;
+    fresh.cache = NULL;
+    effect_mask(&test_ctx[0], rect, &fresh);
+    effect_mask_reset(&fresh);
+    effect_mask(&test_ctx[1], rect, &cached);
+    CHECK(test_same(), "frame %d rect %d %d %d %d", i, rect.origin.x, rect.origin.y, rect.size.w, rect.size.h);
+  }
+  effect_mask_reset(&cached);
+
+  // rows wider than 255 pixels: a full mask shows the whole background
+  GBitmap *wide_fb = gbitmap_create_blank(GSize(320, 4), TEST_FORMAT);
+  GBitmap *wide_mask = gbitmap_create_blank(GSize(320, 4), TEST_FORMAT);
+  GBitmap *wide_background = random_bitmap(GSize(320, 4), false);
+  memset(wide_mask->data, 0xFF, 4 * wide_mask->bytes_per_row);
+  GContext wide = { wide_fb };
+  EffectMask full = { .bitmap_mask = wide_mask, .bitmap_background = wide_background,
+                      .mask_color = GColorWhite, .background_color = GColorBlack };
+  for (int frame = 0; frame < 2; frame++) {
+    effect_mask(&wide, GRect(0, 0, 320, 4), &full);
+    for (int y = 0; y < 4; y++)
+      CHECK(!memcmp(wide_fb->data + y * wide_fb->bytes_per_row, wide_background->data + y * wide_background->bytes_per_row,
+                    TEST_FORMAT == GBitmapFormat8Bit ? 320 : 40), "wide row %d frame %d", y, frame);
+  }
+  effect_mask_reset(&full);
+  gbitmap_destroy(wide_fb);
+  gbitmap_destroy(wide_mask);
+  gbitmap_destroy(wide_background);
+  gbitmap_destroy(mask_bitmap);
+  gbitmap_destroy(background);
+  return test_done("mask");
+}
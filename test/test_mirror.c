@@ -0,0 +1,62 @@
+#include "test.h"
+
+// per pixel mirror of the part of rect on the screen into framebuffer 0: row y of it swaps with row h-1-y
+// (vertical) or column x with column w-1-x (horizontal)
+static void reference_mirror(GRect rect, bool vertical) {
+  GRect screen = GRect(0, 0, TEST_W, TEST_H);
+  grect_clip(&rect, &screen);
+  int w = rect.size.w, h = rect.size.h;
+  for (int y = 0; y < (vertical ? h / 2 : h); y++)
+    for (int x = 0; x < (vertical ? w : w / 2); x++) {
+      int x0 = rect.origin.x + x, y0 = rect.origin.y + y;
+      int x1 = vertical ? x0 : rect.origin.x + w - 1 - x, y1 = vertical ? rect.origin.y + h - 1 - y : y0;
+      GColor color = test_pixel(0, x0, y0);
+      test_set(0, x0, y0, test_pixel(0, x1, y1));
+      test_set(0, x1, y1, color);
+    }
+}
+
+// effect_mirror_vertical and effect_mirror_horizontal against a per-pixel mirror of the whole rect on random
+// rects (any bit alignment on Aplite, partly off the screen). The original kernels paired row y with h-2-y
+// and column x with w-2-x; the edge rows and columns are checked on their own. Benchmarks with "bench"
+int main(int argc, char **argv) {
+  for (int i = 0; i < 3000; i++) {
+    test_fill(i, 50, NULL, 0);
+    GRect rect = i % 4 == 3 ? GRect(rand() % 200 - 40, rand() % 220 - 40, 1 + rand() % 120, 1 + rand() % 120) : test_rect();
+    bool vertical = i & 1;
+    reference_mirror(rect, vertical);
+    (vertical ? effect_mirror_vertical : effect_mirror_horizontal)(&test_ctx[1], rect, NULL);
+    CHECK(test_same(), "%s rect %d %d %d %d", vertical ? "vertical" : "horizontal", rect.origin.x, rect.origin.y,
+          rect.size.w, rect.size.h);
+  }
+
+  // the first and last row (column) of the rect trade places, pixels next to the rect stay
+  for (int i = 0; i < 200; i++) {
+    test_fill(5000 + i, 50, NULL, 0);
+    GRect rect = test_rect();
+    int x0 = rect.origin.x, y0 = rect.origin.y, x1 = x0 + rect.size.w - 1, y1 = y0 + rect.size.h - 1;
+    effect_mirror_vertical(&test_ctx[1], rect, NULL);
+    bool edges = true;
+    for (int x = x0; x <= x1; x++) {
+      edges = edges && gcolor_equal(test_pixel(1, x, y0), test_pixel(0, x, y1)) && gcolor_equal(test_pixel(1, x, y1), test_pixel(0, x, y0));
+      if (y1 + 1 < TEST_H) edges = edges && gcolor_equal(test_pixel(1, x, y1 + 1), test_pixel(0, x, y1 + 1));
+    }
+    memcpy(test_data[1], test_data[0], TEST_SIZE);
+    effect_mirror_horizontal(&test_ctx[1], rect, NULL);
+    for (int y = y0; y <= y1; y++) {
+      edges = edges && gcolor_equal(test_pixel(1, x0, y), test_pixel(0, x1, y)) && gcolor_equal(test_pixel(1, x1, y), test_pixel(0, x0, y));
+      if (x1 + 1 < TEST_W) edges = edges && gcolor_equal(test_pixel(1, x1 + 1, y), test_pixel(0, x1 + 1, y));
+    }
+    CHECK(edges, "edges of rect %d %d %d %d", rect.origin.x, rect.origin.y, rect.size.w, rect.size.h);
+  }
+
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    GRect screen = GRect(0, 0, TEST_W, TEST_H);
+    test_fill(1, 50, NULL, 0);
+    BENCH("baseline mirror_vertical, screen", baseline_effect_mirror_vertical(&test_ctx[0], screen, NULL), 1000);
+    BENCH("effect_mirror_vertical, screen", effect_mirror_vertical(&test_ctx[1], screen, NULL), 1000);
+    BENCH("baseline mirror_horizontal, screen", baseline_effect_mirror_horizontal(&test_ctx[0], screen, NULL), 1000);
+    BENCH("effect_mirror_horizontal, screen", effect_mirror_horizontal(&test_ctx[1], screen, NULL), 1000);
+  }
+  return test_done("mirror");
+}
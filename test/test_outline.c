@@ -0,0 +1,72 @@
+#include "test.h"
+
+// options 4 and 8: every pixel within the diamond or box around an orig_color pixel of rect that is not
+// orig_color gets offset_color (on Aplite those already have it unless offset_color is orig_color). Reads the
+// source from framebuffer 1, which still holds the same pixels, and writes framebuffer 0
+static void reference_dilation(GRect rect, EffectOffset *outline) {
+  int rx = abs(outline->offset_x), ry = outline->option == 4 ? rx : abs(outline->offset_y);
+  for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++)
+    for (int x = rect.origin.x; x < rect.origin.x + rect.size.w; x++) {
+      if (!gcolor_equal(test_pixel(1, x, y), outline->orig_color)) continue;
+      for (int dy = -ry; dy <= ry; dy++)
+        for (int dx = -rx; dx <= rx; dx++) {
+          int tx = x + dx, ty = y + dy;
+          if (outline->option == 4 && abs(dx) + abs(dy) > rx) continue;
+          if (tx < 0 || tx >= TEST_W || ty < 0 || ty >= TEST_H) continue;
+          if (gcolor_equal(test_pixel(1, tx, ty), outline->orig_color)) continue;
+          #ifdef PBL_COLOR
+            test_data[0][ty * TEST_ROW + tx] = outline->offset_color.argb;
+          #else
+            uint8_t bit = 1 << (tx % 8);
+            if (gcolor_equal(outline->offset_color, GColorWhite)) test_data[0][ty * TEST_ROW + tx / 8] |= bit;
+            else test_data[0][ty * TEST_ROW + tx / 8] &= ~bit;
+          #endif
+        }
+    }
+}
+
+// effect_outline against the per-pixel baseline (option 0) and a plain dilation (options 4 and 8), on random
+// rects, offsets and colors
+int main(int argc, char **argv) {
+  static const uint8_t palette[] = { GColorBlackARGB8, GColorWhiteARGB8, GColorRedARGB8, GColorBlueARGB8 };
+  static const int8_t options[] = { 0, 4, 8 };
+  for (int i = 0; i < 3000; i++) {
+    test_fill(i, 5 + i % 40, palette, 2 + i % 3);
+    EffectOffset outline = {
+      .orig_color = (i & 2) ? GColorWhite : GColorBlack,
+      .offset_color = (i & 4) ? GColorWhite : GColorBlack,
+      .offset_x = rand() % 17 - 8,
+      .offset_y = rand() % 17 - 8,
+      .option = options[i % 3],
+    };
+    #ifdef PBL_COLOR
+      if (i & 8) outline.offset_color = (GColor8){.argb = palette[2 + (i & 16 ? 1 : 0)]};
+    #endif
+    GRect rect = i % 10 == 0 ? GRect(0, 0, TEST_W, TEST_H) : test_rect();
+    if (outline.option) reference_dilation(rect, &outline);
+    else baseline_effect_outline(&test_ctx[0], rect, &outline);
+    effect_outline(&test_ctx[1], rect, &outline);
+    CHECK(test_same(), "rect %d %d %d %d, orig %02x offset %02x (%d, %d) option %d", rect.origin.x, rect.origin.y,
+          rect.size.w, rect.size.h, outline.orig_color.argb, outline.offset_color.argb, outline.offset_x,
+          outline.offset_y, outline.option);
+  }
+
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    GRect screen = GRect(0, 0, TEST_W, TEST_H);
+    EffectOffset outline = { .orig_color = GColorWhite, .offset_color = GColorBlack, .offset_x = 2, .offset_y = 2 };
+    #ifdef PBL_COLOR
+      outline.offset_color = GColorRed;
+    #else
+      outline.offset_color = GColorWhite;
+    #endif
+    test_fill(1, 30, palette, 2);
+    BENCH("baseline outline (2, 2), screen", baseline_effect_outline(&test_ctx[0], screen, &outline), 20);
+    test_fill(1, 30, palette, 2);
+    BENCH("effect_outline (2, 2), screen", effect_outline(&test_ctx[1], screen, &outline), 20);
+    outline.offset_color = outline.orig_color;
+    outline.option = 8;
+    test_fill(1, 30, palette, 2);
+    BENCH("effect_outline box (2, 2), screen", effect_outline(&test_ctx[1], screen, &outline), 20);
+  }
+  return test_done("outline");
+}
@@ -0,0 +1,92 @@
+#include "test.h"
+
+// random opaque color (black or white half of the time, so both sides of the colour pairs show up)
+static GColor random_color(void) {
+  int pick = rand() % 4;
+  return (GColor8){.argb = pick == 0 ? GColorBlackARGB8 : pick == 1 ? GColorWhiteARGB8 : 0xC0 | (rand() & 0x3F)};
+}
+
+// per pixel palette map into framebuffer 0: lut of the pixel's color (on Aplite white when that is white)
+static void reference_map(const EffectPalette *palette, GRect rect) {
+  for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++)
+    for (int x = rect.origin.x; x < rect.origin.x + rect.size.w; x++) {
+      uint8_t mapped = palette->lut[test_pixel(0, x, y).argb];
+      #ifdef PBL_COLOR
+        test_data[0][y * TEST_ROW + x] = mapped;
+      #else
+        uint8_t bit = 1 << (x % 8);
+        if (mapped == GColorWhiteARGB8) test_data[0][y * TEST_ROW + x / 8] |= bit;
+        else test_data[0][y * TEST_ROW + x / 8] &= ~bit;
+      #endif
+    }
+}
+
+// the colour effects built on effect_palette_map against their per-pixel baselines, effect_palette_map with
+// random tables against a per-pixel lookup, and chains of colour effects merged into one palette against
+// running them one by one. Benchmarks with "bench"
+int main(int argc, char **argv) {
+  static const struct { effect_cb *effect, *baseline; const char *name; } effects[] = {
+    { effect_colorize, baseline_effect_colorize, "colorize" },
+    { effect_colorswap, baseline_effect_colorswap, "colorswap" },
+    { effect_invert_bw_only, baseline_effect_invert_bw_only, "invert_bw_only" },
+    { effect_invert_brightness, baseline_effect_invert_brightness, "invert_brightness" },
+  };
+  static const uint8_t palette[] = { GColorBlackARGB8, GColorWhiteARGB8, GColorRedARGB8, GColorBlueARGB8 };
+  for (int i = 0; i < 2000; i++) {
+    test_fill(i, 50, palette, i & 4 ? 4 : 0);
+    GRect rect = i < 4 ? GRect(0, 0, TEST_W, TEST_H) : test_rect();
+    EffectColorpair pair = { random_color(), random_color() };
+    if (i & 2) pair.firstColor = (GColor8){.argb = palette[rand() % 4]};
+    effects[i % 4].baseline(&test_ctx[0], rect, &pair);
+    effects[i % 4].effect(&test_ctx[1], rect, &pair);
+    CHECK(test_same(), "%s rect %d %d %d %d colors %02x %02x", effects[i % 4].name, rect.origin.x, rect.origin.y,
+          rect.size.w, rect.size.h, pair.firstColor.argb, pair.secondColor.argb);
+  }
+
+  // tables of random colors; on Aplite black and white map to one of four
+  for (int i = 0; i < 500; i++) {
+    EffectPalette map;
+    for (int c = 0; c < 256; c++) map.lut[c] = 0xC0 | (rand() & 0x3F);
+    map.lut[GColorBlackARGB8] = random_color().argb;
+    map.lut[GColorWhiteARGB8] = random_color().argb;
+    test_fill(1000 + i, 50, NULL, 0);
+    GRect rect = test_rect();
+    reference_map(&map, rect);
+    effect_palette_map(&test_ctx[1], rect, &map);
+    CHECK(test_same(), "map rect %d %d %d %d, black %02x white %02x", rect.origin.x, rect.origin.y, rect.size.w,
+          rect.size.h, map.lut[GColorBlackARGB8], map.lut[GColorWhiteARGB8]);
+  }
+
+  // a chain of up to 5 colour effects (random tables among them) as one palette
+  static EffectColorpair pairs[5];
+  static EffectPalette maps[5];
+  for (int i = 0; i < 500; i++) {
+    EffectPalette merged;
+    effect_palette_init(&merged);
+    test_fill(2000 + i, 50, palette, i & 1 ? 4 : 0);
+    GRect rect = test_rect();
+    int count = 1 + i % 5;
+    for (int k = 0; k < count; k++) {
+      pairs[k] = (EffectColorpair){ random_color(), random_color() };
+      for (int c = 0; c < 256; c++) maps[k].lut[c] = random_color().argb;
+      int pick = rand() % 6;
+      effect_cb *effect = pick == 4 ? effect_invert : pick == 5 ? effect_palette_map : effects[pick].effect;
+      void *param = pick == 5 ? (void*)&maps[k] : &pairs[k];
+      effect(&test_ctx[0], rect, param);
+      CHECK(effect_palette_add_effect(&merged, effect, param), "colour effect not merged");
+    }
+    effect_palette_map(&test_ctx[1], rect, &merged);
+    CHECK(test_same(), "chain of %d rect %d %d %d %d", count, rect.origin.x, rect.origin.y, rect.size.w, rect.size.h);
+  }
+  CHECK(!effect_palette_add_effect(&(EffectPalette){0}, effect_blur, (void*)1), "blur merged into a palette");
+
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    GRect screen = GRect(0, 0, TEST_W, TEST_H);
+    test_fill(1, 50, NULL, 0);
+    BENCH("baseline invert_brightness, screen", baseline_effect_invert_brightness(&test_ctx[0], screen, NULL), 200);
+    BENCH("effect_invert_brightness, screen", effect_invert_brightness(&test_ctx[1], screen, NULL), 200);
+    BENCH("baseline invert_bw_only, screen", baseline_effect_invert_bw_only(&test_ctx[0], screen, NULL), 200);
+    BENCH("effect_invert_bw_only, screen", effect_invert_bw_only(&test_ctx[1], screen, NULL), 200);
+  }
+  return test_done("palette");
+}
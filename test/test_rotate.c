@@ -0,0 +1,59 @@
+#include "test.h"
+
+// per pixel rotation of the part of rect on the screen into framebuffer 0: the rect rotated by 90 degrees
+// (h wide, w tall), centred on the rect and clipped to it; pixels it does not cover stay
+static void reference_rotate(GRect rect, bool right) {
+  static uint8_t before[TEST_SIZE];
+  memcpy(before, test_data[0], TEST_SIZE);
+  GRect screen = GRect(0, 0, TEST_W, TEST_H);
+  grect_clip(&rect, &screen);
+  int w = rect.size.w, h = rect.size.h, ox = (w - h) >> 1, oy = (h - w) >> 1;
+  // rotated pixel (i, j), row i of w, column j of h: right S(h-1-j, i), left S(j, w-1-i)
+  for (int i = 0; i < w; i++)
+    for (int j = 0; j < h; j++) {
+      int x = j + ox, y = i + oy;
+      if (x < 0 || y < 0 || x >= w || y >= h) continue;
+      int sx = rect.origin.x + (right ? i : w - 1 - i), sy = rect.origin.y + (right ? h - 1 - j : j);
+      #ifdef PBL_COLOR
+        GColor color = (GColor8){.argb = before[sy * TEST_ROW + sx]};
+      #else
+        GColor color = (before[sy * TEST_ROW + sx / 8] >> (sx % 8)) & 1 ? GColorWhite : GColorBlack;
+      #endif
+      test_set(0, rect.origin.x + x, rect.origin.y + y, color);
+    }
+}
+
+// effect_rotate_90_degrees against a per-pixel rotation on random rects (square or not, any alignment, partly
+// off the screen), both directions; against the original kernel inside odd squares, which it rotated except
+// for their outer row and column
+int main(int argc, char **argv) {
+  for (int i = 0; i < 2000; i++) {
+    test_fill(i, 50, NULL, 0);
+    GRect rect = i % 4 == 3 ? GRect(rand() % 200 - 40, rand() % 220 - 40, 1 + rand() % 120, 1 + rand() % 120) : test_rect();
+    if (i % 4 == 2) rect.size.h = rect.size.w < TEST_H - rect.origin.y ? rect.size.w : TEST_H - rect.origin.y;
+    bool right = i & 1;
+    reference_rotate(rect, right);
+    effect_rotate_90_degrees(&test_ctx[1], rect, (void*)right);
+    CHECK(test_same(), "rect %d %d %d %d %s", rect.origin.x, rect.origin.y, rect.size.w, rect.size.h, right ? "right" : "left");
+  }
+
+  for (int i = 0; i < 1000; i++) {
+    test_fill(3000 + i, 50, NULL, 0);
+    int n = 3 + 2 * (rand() % 60), x = rand() % (TEST_W - n + 1), y = rand() % (TEST_H - n + 1);
+    bool right = i & 1;
+    baseline_effect_rotate_90_degrees(&test_ctx[0], GRect(x, y, n, n), (void*)right);
+    effect_rotate_90_degrees(&test_ctx[1], GRect(x, y, n, n), (void*)right);
+    bool same = true;
+    for (int yy = y + 1; yy < y + n - 1; yy++)
+      for (int xx = x + 1; xx < x + n - 1; xx++) same = same && gcolor_equal(test_pixel(0, xx, yy), test_pixel(1, xx, yy));
+    CHECK(same, "baseline square %d at %d %d %s", n, x, y, right ? "right" : "left");
+  }
+
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    test_fill(1, 50, NULL, 0);
+    BENCH("baseline rotate 144x144", baseline_effect_rotate_90_degrees(&test_ctx[0], GRect(0, 0, 144, 144), (void*)1), 200);
+    BENCH("effect_rotate_90_degrees 144x144", effect_rotate_90_degrees(&test_ctx[1], GRect(0, 0, 144, 144), (void*)1), 200);
+    BENCH("effect_rotate_90_degrees 144x168", effect_rotate_90_degrees(&test_ctx[1], GRect(0, 0, 144, 168), (void*)1), 200);
+  }
+  return test_done("rotate");
+}
@@ -0,0 +1,48 @@
+#include "test.h"
+
+// effect_shadow against the per-pixel baseline: plain and long shadows with random offsets, including
+// offset_color == orig_color, where written pixels cast again. Benchmarks a long shadow with "bench"
+int main(int argc, char **argv) {
+  static const uint8_t palette[] = { GColorBlackARGB8, GColorWhiteARGB8, GColorRedARGB8, GColorBlueARGB8 };
+  for (int i = 0; i < 3000; i++) {
+    test_fill(i, 5 + i % 60, palette, 2 + i % 3);
+    EffectOffset shadow = {
+      .orig_color = (i & 2) ? GColorWhite : GColorBlack,
+      .offset_color = (i & 4) ? GColorWhite : GColorBlack,
+      .offset_x = rand() % 41 - 20,
+      .offset_y = rand() % 41 - 20,
+      .option = i & 1,
+    };
+    #ifdef PBL_COLOR
+      if (i & 8) shadow.offset_color = (GColor8){.argb = palette[2 + (i & 16 ? 1 : 0)]};
+    #endif
+    GRect rect = i % 10 == 0 ? GRect(0, 0, TEST_W, TEST_H) : test_rect();
+    baseline_effect_shadow(&test_ctx[0], rect, &shadow);
+    effect_shadow(&test_ctx[1], rect, &shadow);
+    CHECK(test_same(), "rect %d %d %d %d, orig %02x offset %02x (%d, %d) option %d", rect.origin.x, rect.origin.y,
+          rect.size.w, rect.size.h, shadow.orig_color.argb, shadow.offset_color.argb, shadow.offset_x,
+          shadow.offset_y, shadow.option);
+  }
+
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    // white block on black, shadow to the bottom right
+    memset(test_data[0], 0, TEST_SIZE);
+    for (int y = 50; y < 110; y++)
+      for (int x = 40; x < 100; x++) {
+        #ifdef PBL_COLOR
+          test_data[0][y * TEST_ROW + x] = GColorWhiteARGB8;
+        #else
+          test_data[0][y * TEST_ROW + x / 8] |= 1 << (x % 8);
+        #endif
+      }
+    #ifdef PBL_COLOR
+      for (int k = 0; k < TEST_SIZE; k++) if (!test_data[0][k]) test_data[0][k] = GColorBlackARGB8;
+    #endif
+    memcpy(test_data[1], test_data[0], TEST_SIZE);
+    GRect screen = GRect(0, 0, TEST_W, TEST_H);
+    EffectOffset shadow = { .orig_color = GColorWhite, .offset_color = GColorRed, .offset_x = 20, .offset_y = 20, .option = 1 };
+    BENCH("baseline long shadow (20, 20), screen", baseline_effect_shadow(&test_ctx[0], screen, &shadow), 20);
+    BENCH("effect_shadow long (20, 20), screen", effect_shadow(&test_ctx[1], screen, &shadow), 20);
+  }
+  return test_done("shadow");
+}
@@ -0,0 +1,64 @@
+#include "test.h"
+
+// true when screen pixel (x, y) is in a span of shape placed at origin
+static bool in_shape(const EffectShape *shape, GPoint origin, int x, int y) {
+  for (int i = 0; i < shape->count; i++) {
+    const EffectSpan *span = &shape->spans[i];
+    if (span->y + origin.y == y && x >= span->x0 + origin.x && x < span->x1 + origin.x) return true;
+  }
+  return false;
+}
+
+// reference: effect on the whole rect of framebuffer 0, then the pixels outside shape put back
+static void reference(effect_cb *effect, void *param, GRect rect, const EffectShape *shape) {
+  static uint8_t before[TEST_SIZE];
+  memcpy(before, test_data[0], TEST_SIZE);
+  effect(&test_ctx[0], rect, param);
+  for (int y = 0; y < TEST_H; y++)
+    for (int x = 0; x < TEST_W; x++) {
+      if (in_shape(shape, rect.origin, x, y)) continue;
+      #ifdef PBL_COLOR
+        test_data[0][y * TEST_ROW + x] = before[y * TEST_ROW + x];
+      #else
+        uint8_t bit = 1 << (x % 8);
+        test_data[0][y * TEST_ROW + x / 8] = (test_data[0][y * TEST_ROW + x / 8] & ~bit) | (before[y * TEST_ROW + x / 8] & bit);
+      #endif
+    }
+}
+
+static void invert_then_shaped(GContext *ctx, GRect position, void *param) {
+  effect_invert(ctx, position, NULL);
+  effect_shaped(ctx, position, param);
+}
+
+// effect_shaped only changes the pixels of its shape, for colour effects (spans) and others (saved rect), on
+// rects partly off screen and with a shaped effect running inside another
+int main(int argc, char **argv) {
+  EffectShape circle = {0}, annulus = {0};
+  CHECK(effect_shape_circle(&circle, GPoint(40, 40), 35), "circle");
+  CHECK(effect_shape_annulus(&annulus, GPoint(40, 40), 20, 45), "annulus");
+  static const GRect rects[] = { {{10, 20}, {80, 80}}, {{-13, -7}, {80, 80}}, {{90, 110}, {80, 80}}, {{37, 3}, {80, 80}} };
+
+  for (int i = 0; i < 40; i++) {
+    GRect rect = rects[i % 4];
+    EffectShaped shaped = { i & 4 ? &annulus : &circle, i & 8 ? effect_invert : effect_blur, (void*)2 };
+    test_fill(i, 50, NULL, 0);
+    reference(shaped.effect, shaped.param, rect, shaped.shape);
+    effect_shaped(&test_ctx[1], rect, &shaped);
+    CHECK(test_same(), "run %d rect %d %d", i, rect.origin.x, rect.origin.y);
+  }
+
+  // nested: the outer effect inverts its rect, then blurs the annulus with a shaped effect of its own
+  for (int i = 0; i < 8; i++) {
+    GRect rect = rects[i % 4];
+    EffectShaped inner = { &annulus, effect_blur, (void*)2 };
+    EffectShaped outer = { &circle, invert_then_shaped, &inner };
+    test_fill(100 + i, 50, NULL, 0);
+    reference(invert_then_shaped, &inner, rect, &circle);
+    effect_shaped(&test_ctx[1], rect, &outer);
+    CHECK(test_same(), "nested run %d rect %d %d", i, rect.origin.x, rect.origin.y);
+  }
+  effect_shape_destroy(&circle);
+  effect_shape_destroy(&annulus);
+  return test_done("shaped");
+}
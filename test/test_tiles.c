@@ -0,0 +1,56 @@
+#include "test.h"
+
+// black screen with a white 60x60 block: the mostly flat case tile summaries are meant for
+static void fill_block(void) {
+  for (int y = 0; y < TEST_H; y++)
+    for (int x = 0; x < TEST_W; x++) {
+      bool white = x >= 40 && x < 100 && y >= 50 && y < 110;
+      #ifdef PBL_COLOR
+        test_data[0][y * TEST_ROW + x] = white ? GColorWhiteARGB8 : GColorBlackARGB8;
+      #else
+        if (white) test_data[0][y * TEST_ROW + x / 8] |= 1 << (x % 8);
+        else test_data[0][y * TEST_ROW + x / 8] &= ~(1 << (x % 8));
+      #endif
+    }
+  memcpy(test_data[1], test_data[0], TEST_SIZE);
+}
+
+static bool s_print;
+
+static void report(const char *name, effect_cb *effect, uint32_t tiles, bool counted) {
+  EffectTileStats stats;
+  effect_get_tile_stats(effect, &stats);
+  #ifdef PBL_COLOR
+    if (counted) CHECK(stats.tiles == tiles && stats.skipped > 0 && stats.skipped < tiles, "%s: %u tiles, %u skipped",
+                       name, (unsigned)stats.tiles, (unsigned)stats.skipped);
+    else CHECK(stats.tiles == 0, "%s counts tiles", name);
+  #else
+    CHECK(stats.tiles == 0, "%s counts tiles on Aplite", name);
+  #endif
+  if (s_print) printf("  %-12s %3u tiles, %3u skipped\n", name, (unsigned)stats.tiles, (unsigned)stats.skipped);
+}
+
+// tile counters for one call of each effect on a full screen (99 tiles of 16x16 on Basalt), printed with "bench"
+int main(int argc, char **argv) {
+  s_print = argc > 1 && !strcmp(argv[1], "bench");
+  GRect screen = GRect(0, 0, TEST_W, TEST_H);
+  EffectOffset offset = { .orig_color = GColorWhite, .offset_color = GColorRed, .offset_x = 4, .offset_y = 4 };
+  EffectPalette palette;
+  effect_palette_init(&palette);
+  effect_palette_add_effect(&palette, effect_invert, NULL);
+
+  effect_reset_tile_stats();
+  fill_block();
+  effect_blur(&test_ctx[1], screen, (void*)3);
+  fill_block();
+  effect_shadow(&test_ctx[1], screen, &offset);
+  fill_block();
+  effect_outline(&test_ctx[1], screen, &offset);
+  fill_block();
+  effect_palette_map(&test_ctx[1], screen, &palette);
+  report("blur r3", effect_blur, 99, true);
+  report("shadow", effect_shadow, 99, true);
+  report("outline", effect_outline, 99, true);
+  report("palette_map", effect_palette_map, 0, false);
+  return test_done("tiles");
+}
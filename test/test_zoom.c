@@ -0,0 +1,98 @@
+#include "test.h"
+
+// source of destination i on one axis zooming by ratio/16 around centre, with the sources clamped to [lo, hi]
+// (the rect on the screen): the nearest pixel, the next one outwards and the weight (1/16) of that one
+typedef struct { int s0, s1, w; } Sample;
+
+static Sample sample(int i, int centre, int lo, int hi, int ratio) {
+  int d = i < centre ? centre - i : i - centre, n = i < centre ? centre - lo : hi - centre;
+  int q = 16 * d / ratio, w = (16 * d % ratio * 16 + ratio / 2) / ratio, out = i < centre ? -1 : 1;
+  if (q >= n) { q = n; w = 0; out = 0; }
+  Sample s = { centre + (i < centre ? -q : q), centre + (i < centre ? -q : q) + out, w };
+  s.s0 = s.s0 < lo ? lo : s.s0 > hi ? hi : s.s0;
+  s.s1 = s.s1 < lo ? lo : s.s1 > hi ? hi : s.s1;
+  return s;
+}
+
+#ifdef PBL_COLOR
+// 2bit channels of a and b mixed by w/16
+static uint8_t mix(uint8_t a, uint8_t b, int w) {
+  uint8_t mixed = 0xC0;
+  for (int shift = 0; shift < 6; shift += 2)
+    mixed |= (((a >> shift & 3) * (16 - w) + (b >> shift & 3) * w + 8) >> 4) << shift;
+  return mixed;
+}
+#endif
+
+// per pixel zoom of the part of rect on the screen into framebuffer 0, read from the pixels before the zoom
+static void reference_zoom(GRect rect, int ratio_x, int ratio_y, bool bilinear) {
+  static uint8_t before[TEST_SIZE];
+  memcpy(before, test_data[0], TEST_SIZE);
+  int xCn = rect.origin.x + rect.size.w / 2, yCn = rect.origin.y + rect.size.h / 2;
+  int x0 = rect.origin.x > 0 ? rect.origin.x : 0, y0 = rect.origin.y > 0 ? rect.origin.y : 0;
+  int x1 = rect.origin.x + rect.size.w < TEST_W ? rect.origin.x + rect.size.w - 1 : TEST_W - 1;
+  int y1 = rect.origin.y + rect.size.h < TEST_H ? rect.origin.y + rect.size.h - 1 : TEST_H - 1;
+  for (int y = y0; y <= y1; y++)
+    for (int x = x0; x <= x1; x++) {
+      Sample sx = sample(x, xCn, x0, x1, ratio_x), sy = sample(y, yCn, y0, y1, ratio_y);
+      #ifdef PBL_COLOR
+        const uint8_t *row0 = before + sy.s0 * TEST_ROW, *row1 = before + sy.s1 * TEST_ROW;
+        test_data[0][y * TEST_ROW + x] = bilinear ?
+          mix(mix(row0[sx.s0], row0[sx.s1], sx.w), mix(row1[sx.s0], row1[sx.s1], sx.w), sy.w) : row0[sx.s0];
+      #else
+        bool white = (before[sy.s0 * TEST_ROW + sx.s0 / 8] >> (sx.s0 % 8)) & 1;
+        test_set(0, x, y, white ? GColorWhite : GColorBlack);
+      #endif
+    }
+}
+
+// effect_zoom against a per-pixel reference (sources clamped to the rect, bilinear on Basalt) on random rects,
+// also partly off the screen, zooming in and out on each axis; against the original kernel inside odd sized
+// rects zooming in, where it stayed inside the rect. The typed zoom gives the same pixels as EL_ZOOM
+int main(int argc, char **argv) {
+  for (int i = 0; i < 2000; i++) {
+    test_fill(i, 50, NULL, 0);
+    GRect rect = i % 4 == 3 ? GRect(rand() % 200 - 40, rand() % 220 - 40, 1 + rand() % 120, 1 + rand() % 120) : test_rect();
+    int ratio_x = 1 + rand() % 60, ratio_y = 1 + rand() % 60;
+    bool bilinear = i & 1;
+    reference_zoom(rect, ratio_x, ratio_y, bilinear);
+    effect_zoom(&test_ctx[1], rect, (void*)(ratio_x | ratio_y << 8 | (bilinear ? EL_ZOOM_BILINEAR_FLAG : 0)));
+    CHECK(test_same(), "rect %d %d %d %d ratio %d %d%s", rect.origin.x, rect.origin.y, rect.size.w, rect.size.h,
+          ratio_x, ratio_y, bilinear ? " bilinear" : "");
+  }
+
+  for (int i = 0; i < 1000; i++) {
+    test_fill(3000 + i, 50, NULL, 0);
+    int w = 1 + 2 * (rand() % 50), h = 1 + 2 * (rand() % 60);
+    GRect rect = GRect(rand() % (TEST_W - w + 1), rand() % (TEST_H - h + 1), w, h);
+    int ratio_x = 16 + rand() % 40, ratio_y = 16 + rand() % 40;
+    baseline_effect_zoom(&test_ctx[0], rect, (void*)(ratio_x | ratio_y << 8));
+    effect_zoom(&test_ctx[1], rect, (void*)(ratio_x | ratio_y << 8));
+    bool same = true;
+    for (int y = rect.origin.y; y < rect.origin.y + h; y++)
+      for (int x = rect.origin.x; x < rect.origin.x + w; x++)
+        same = same && gcolor_equal(test_pixel(0, x, y), test_pixel(1, x, y));
+    CHECK(same, "baseline rect %d %d %d %d ratio %d %d", rect.origin.x, rect.origin.y, w, h, ratio_x, ratio_y);
+  }
+
+  for (int i = 0; i < 50; i++) {
+    EffectZoomParams params = { .ratio_x = 1 + rand() % 60, .ratio_y = 1 + rand() % 60, .bilinear = i & 1 };
+    EffectInstance zoom;
+    effect_instance_init(&zoom, &effect_type_zoom, &params);
+    test_fill(5000 + i, 50, NULL, 0);
+    GRect rect = test_rect();
+    effect_zoom(&test_ctx[0], rect, (void*)(params.ratio_x | params.ratio_y << 8 | (params.bilinear ? EL_ZOOM_BILINEAR_FLAG : 0)));
+    effect_run(&test_ctx[1], rect, &zoom);
+    CHECK(test_same(), "typed zoom ratio %d %d", params.ratio_x, params.ratio_y);
+    effect_instance_destroy(&zoom);
+  }
+
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    GRect screen = GRect(0, 0, TEST_W - 1, TEST_H - 1);
+    test_fill(1, 50, NULL, 0);
+    BENCH("baseline effect_zoom 200%, screen", baseline_effect_zoom(&test_ctx[0], screen, EL_ZOOM(200, 200)), 200);
+    BENCH("effect_zoom 200%, screen", effect_zoom(&test_ctx[1], screen, EL_ZOOM(200, 200)), 200);
+    BENCH("effect_zoom 200% bilinear, screen", effect_zoom(&test_ctx[1], screen, EL_ZOOM_BILINEAR(200, 200)), 200);
+  }
+  return test_done("zoom");
+}